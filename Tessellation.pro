@@ -1,5 +1,8 @@
-QMAKE_CXXFLAGS += -std=gnu++0x
+QMAKE_CXXFLAGS += -std=gnu++0x -fopenmp
 QT += core gui opengl xml
+#the upload worker shares the viewer's context through QOpenGLContext and QOffscreenSurface
+lessThan(QT_MAJOR_VERSION, 5): error("Qt 5.1 or newer is required")
+equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 1): error("Qt 5.1 or newer is required")
 TARGET = Tessellation
 TEMPLATE = app
 
@@ -11,6 +14,7 @@ OTHER_FILES += shaders/render.*
 INCLUDEPATH += include
 LIBS += -L/usr/lib/x86_64-linux-gnu -lGL -lGLU -lGLEW
 LIBS += -lQGLViewer
+LIBS += -fopenmp
 
 DESTDIR = .
 OBJECTS_DIR = build
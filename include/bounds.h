@@ -0,0 +1,60 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <glm/glm.hpp>
+#include <limits>
+#include <vector>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct BoundingBox
+    {
+        BoundingBox(): min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max()) {}
+        BoundingBox(const std::vector<glm::vec3> &points);
+
+        void extend(const glm::vec3 &point) {min = glm::min(min, point); max = glm::max(max, point);}
+        bool isEmpty() const {return min.x > max.x;}
+        glm::vec3 getCenter() const {return 0.5f * (min + max);}
+        glm::vec3 getExtent() const {return 0.5f * (max - min);}
+        //box around the transformed box, from the center and the absolute linear part
+        BoundingBox transform(const glm::mat4 &matrix) const;
+
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    //center in xyz, radius in w, centered on the box but only as large as the farthest point
+    glm::vec4 computeBoundingSphere(const std::vector<glm::vec3> &points, const BoundingBox &box);
+    glm::vec4 transformBoundingSphere(const glm::vec4 &sphere, const glm::mat4 &matrix);
+
+    struct CullStats
+    {
+        CullStats(): objects(0), culled(0) {}
+
+        uint objects;
+        uint culled;
+    };
+
+    class Frustum
+    {
+    public:
+        Frustum();
+
+        //a*x + b*y + c*z = d with outward normals, as returned by Camera::getFrustumPlanesCoefficients
+        void setPlanes(const double coefficients[6][4]);
+        //the same frustum in the local space of a model matrix
+        Frustum transform(const glm::mat4 &matrix) const;
+
+        bool isOutside(const glm::vec4 &sphere) const;
+        bool isOutside(const BoundingBox &box) const;
+
+    private:
+        glm::vec4 _planes[6];
+    };
+
+}
+
+#endif // BOUNDS_H
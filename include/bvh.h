@@ -0,0 +1,64 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+#include <limits>
+#include <glm/glm.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct ClosestHit
+    {
+        ClosestHit():
+            triangle(-1), distance(std::numeric_limits<float>::max()), triangleTests(0) {}
+
+        int triangle;
+        float distance;
+        glm::vec3 position;
+        glm::vec3 barycentric;
+        uint triangleTests;
+    };
+
+    //bounding volume hierarchy over triangles for closest point queries
+    class BVH
+    {
+    public:
+        BVH() {}
+        BVH(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        ~BVH() {}
+
+        void build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        bool getClosest(const glm::vec3 &point, ClosestHit &hit);
+        bool isEmpty() {return _nodes.empty();}
+
+        uint getTriangleCount() {return _triangleIds.size();}
+        uint getNodeCount() {return _nodes.size();}
+        glm::vec3 getMin() {return _nodes.empty() ? glm::vec3(0.0f) : _nodes[0].min;}
+        glm::vec3 getMax() {return _nodes.empty() ? glm::vec3(0.0f) : _nodes[0].max;}
+
+    private:
+        struct Node
+        {
+            glm::vec3 min;
+            glm::vec3 max;
+            uint first;
+            uint count;
+            uint right;
+        };
+
+        uint subdivide(const uint first, const uint count, std::vector<glm::vec3> &centroids);
+        float getBoxDistance(const Node &node, const glm::vec3 &point);
+
+        std::vector<Node> _nodes;
+        std::vector<uint> _triangleIds;
+        std::vector<glm::vec3> _triangles;
+
+        static const uint _leafSize = 4;
+    };
+
+}
+
+#endif // BVH_H
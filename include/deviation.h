@@ -0,0 +1,65 @@
+#ifndef DEVIATION_H
+#define DEVIATION_H
+
+#include <QString>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct DeviationReport
+    {
+        DeviationReport():
+            cloud(0), points(0), vertices(0), rms(0.0f), mean(0.0f), minSigned(0.0f), maxSigned(0.0f),
+            cloudToMesh(0.0f), meshToCloud(0.0f), hausdorff(0.0f), histogramRange(0.0f), milliseconds(0.0) {}
+
+        //id of the measured cloud, 0 for all the clouds together
+        uint cloud;
+        uint points;
+        uint vertices;
+        float rms;
+        float mean;
+        float minSigned;
+        float maxSigned;
+        //one-sided Hausdorff distances and their maximum
+        float cloudToMesh;
+        float meshToCloud;
+        float hausdorff;
+        //bins of the signed distance over [-histogramRange, histogramRange]
+        std::vector<uint> histogram;
+        float histogramRange;
+        //of the whole analysis, every report of a frame shares it
+        double milliseconds;
+    };
+
+    class DeviationAnalysis
+    {
+    public:
+        DeviationAnalysis(const uint bins = 32): _bins(bins) {}
+        ~DeviationAnalysis() {}
+
+        //one report per cloud, followed by one over all of them when there are several
+        std::vector<DeviationReport> analyze(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                                             const std::vector<std::vector<glm::vec3> > &clouds);
+
+        //of the clouds one after the other
+        std::vector<float>& getSignedDistances() {return _signedDistances;}
+        std::vector<glm::vec4> getColors(const float range);
+
+        //one row per report, the reports of a frame together
+        static bool writeReport(QString filename, const std::vector<std::vector<DeviationReport> > &frames);
+
+    private:
+        //statistics of the points from first on, whose signed distances are already computed
+        DeviationReport getReport(const std::vector<glm::vec3> &vertices, const std::vector<glm::vec3> &points, const size_t first);
+
+        uint _bins;
+        std::vector<float> _signedDistances;
+    };
+
+}
+
+#endif // DEVIATION_H
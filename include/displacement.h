@@ -0,0 +1,66 @@
+#ifndef DISPLACEMENT_H
+#define DISPLACEMENT_H
+
+#include <vector>
+
+#include "geometry.h"
+#include "meshTopology.h"
+#include "bvh.h"
+
+namespace Tessellation
+{
+
+    struct DisplacementStats
+    {
+        DisplacementStats():
+            queries(0), hits(0), fallbacks(0), triangleTests(0), milliseconds(0.0) {}
+
+        float getHitRate() {return (queries > 0) ? static_cast<float>(hits)/queries : 0.0f;}
+        float getTestsPerQuery() {return (queries > 0) ? static_cast<float>(triangleTests)/queries : 0.0f;}
+
+        uint queries;
+        uint hits;
+        uint fallbacks;
+        uint triangleTests;
+        double milliseconds;
+    };
+
+    //displaces a cloud against an animated mesh, seeding each point with the
+    //triangle it matched on the previous frame
+    class TemporalDisplacement
+    {
+    public:
+        //the tolerance is a fraction of the mesh bounding box diagonal, whatever the scale of the scene
+        TemporalDisplacement(const uint maxSteps = 8, const float motionTolerance = 0.005f);
+        ~TemporalDisplacement() {}
+
+        DisplacementStats update(Geometry *mesh, Geometry *cloud);
+        void reset();
+
+        DisplacementStats getStats() {return _stats;}
+        void setMaxSteps(const uint maxSteps) {_maxSteps = maxSteps;}
+        void setMotionTolerance(const float motionTolerance) {_motionTolerance = motionTolerance;}
+
+    private:
+        bool walk(const glm::vec3 &point, const int seed, ClosestHit &hit);
+        float getDistance(const uint triangle, const glm::vec3 &point, ClosestHit &hit);
+
+        uint _maxSteps;
+        float _motionTolerance;
+
+        //triangle adjacency is shared by every frame of the sequence
+        MeshTopology _topology;
+        BVH _bvh;
+        bool _bvhReady;
+
+        std::vector<glm::vec3> _positions;
+        std::vector<uint> _indices;
+        std::vector<int> _previousTriangles;
+        std::vector<float> _previousDistances;
+
+        DisplacementStats _stats;
+    };
+
+}
+
+#endif // DISPLACEMENT_H
@@ -0,0 +1,44 @@
+#ifndef DISPLACEMENT_MAP_H
+#define DISPLACEMENT_MAP_H
+
+#include <GL/glew.h>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    //point cloud displacements resampled into a texture over the mesh parameterization
+    class DisplacementMap
+    {
+    public:
+        DisplacementMap(const uint resolution = 1024);
+        ~DisplacementMap();
+
+        static bool hasParameterization(const std::vector<glm::vec2> &textureCoordinates, const std::vector<uint> &indices);
+        static std::vector<glm::vec2> getAtlas(const uint triangleCount, const uint resolution);
+
+        void bake(const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &textureCoordinates,
+                  const std::vector<uint> &indices, const std::vector<glm::vec3> &points,
+                  const std::vector<glm::vec3> &displacements, const uint neighborCount = 8);
+        void upload();
+
+        uint getResolution() {return _resolution;}
+        GLuint getTextureId() {return _textureId;}
+        std::vector<glm::vec3>& getTexels() {return _texels;}
+
+    private:
+        void dilate(std::vector<int> &coverage, const int iterations);
+
+        uint _resolution;
+        std::vector<glm::vec3> _texels;
+        GLuint _textureId;
+
+        static const int _gutter = 2;
+    };
+
+}
+
+#endif // DISPLACEMENT_MAP_H
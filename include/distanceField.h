@@ -0,0 +1,85 @@
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <QString>
+#include <QByteArray>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bvh.h"
+#include "meshTopology.h"
+
+namespace Tessellation
+{
+
+    struct DistanceFieldError
+    {
+        DistanceFieldError():
+            samples(0), outside(0), maxError(0.0f), meanError(0.0f), rmsError(0.0f) {}
+
+        uint samples;
+        uint outside;
+        float maxError;
+        float meanError;
+        float rmsError;
+    };
+
+    //narrow band signed distance field stored in sparse bricks of 8x8x8 samples
+    class DistanceField
+    {
+    public:
+        DistanceField();
+        ~DistanceField() {}
+
+        void build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                   const float voxelSize, const float bandWidth);
+        bool save(QString filename);
+        //false when the file was baked from other positions or indices than these
+        bool load(QString filename, const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        bool isEmpty() {return _brickIds.empty();}
+
+        bool getDistance(const glm::vec3 &point, float &distance, glm::vec3 &gradient);
+        bool getDisplacement(const glm::vec3 &point, glm::vec3 &displacement);
+        int getClosestTriangle(const glm::vec3 &point);
+        DistanceFieldError validate(const std::vector<glm::vec3> &points,
+                                    const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+
+        float getVoxelSize() {return _voxelSize;}
+        float getBandWidth() {return _bandWidth;}
+        uint getBrickCount() {return _distances.size() / _brickVolume;}
+
+    private:
+        int getSampleIndex(const int x, const int y, const int z);
+        void prepareExact(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        void releaseExact();
+        float getExactDistance(const glm::vec3 &point, int &triangle);
+
+        glm::vec3 _origin;
+        float _voxelSize;
+        float _bandWidth;
+        glm::ivec3 _resolution;
+        glm::ivec3 _brickResolution;
+
+        std::vector<int> _brickIds;
+        std::vector<float> _distances;
+        std::vector<int> _triangles;
+
+        //the mesh the field was baked from, saved with it
+        quint32 _vertexCount;
+        quint32 _triangleCount;
+        QByteArray _meshHash;
+
+        //exact queries with angle weighted pseudo normals for the sign
+        BVH _bvh;
+        MeshTopology _topology;
+        std::vector<glm::vec3> _faceNormals;
+        std::vector<glm::vec3> _vertexNormals;
+        std::vector<glm::vec3> _edgeNormals;
+
+        static const int _brickSize = 8;
+        static const int _brickVolume = _brickSize*_brickSize*_brickSize;
+    };
+
+}
+
+#endif // DISTANCE_FIELD_H
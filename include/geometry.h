@@ -7,9 +7,22 @@
 
 #include <QString>
 #include <QStringList>
+#include <QMutex>
 #include <boost/unordered_map.hpp>
 #include "glm/ext.hpp"
 #include "material.h"
+#include "displacementMap.h"
+#include "meshSimplifier.h"
+#include "uniformBuffer.h"
+#include "bounds.h"
+#include "meshlet.h"
+#include "pointOctree.h"
+#include "meshOptimizer.h"
+#include "vertexFormat.h"
+#include "streamBuffer.h"
+
+#include <map>
+#include <memory>
 
 namespace Tessellation
 {
@@ -19,6 +32,26 @@ namespace Tessellation
         Cloud
     };
 
+    //evaluation of the tessellated patch (surfaceMode in render.es)
+    enum SurfaceMode
+    {
+        LinearSurface = 0,
+        PNTriangleSurface,
+        PhongSurface
+    };
+
+    //GPU copy of one simplified level, expanded like the base geometry
+    struct LodBuffers
+    {
+        GLuint vertexBuffer;
+        GLuint normalBuffer;
+        GLuint textureBuffer;
+        GLuint displacementBuffer;
+        GLuint indexBuffer;
+        GLuint vertexArray;
+        uint count;
+    };
+
     struct OBJVertex {
         uint32_t p, n, uv;
 
@@ -121,23 +154,85 @@ namespace Tessellation
 
         std::vector<Vertex> getVertices() {return _vertices;}
         std::vector<uint> getIndices() {return _indices;}
+        //first corner of every welded vertex, in drawing order
+        std::vector<uint> getDrawIndices() {return _drawIndices.empty() ? _indices : _drawIndices;}
         std::vector<glm::vec3> getPositions() {return _positions;}
         std::vector<glm::vec3> getNormals() {return _normals;}
         std::vector<glm::vec2> getTextureCoordinates() {return _textureCoordinates;}
+        std::vector<glm::vec3> getDisplacements() {return _displacements;}
         void setMVP(glm::mat4 matrix);
         void setPosition(const int index, glm::vec3 position);
         void setDisplacement(const int index, glm::vec3 displacement);
-
-        void translate(glm::vec3 vector){_translation = glm::translate(_translation, vector);}
-        void rotate(float angle, glm::vec3 vector) {_rotation = glm::rotate(_rotation, angle, vector);}
-        void scale(glm::vec3 vector) {_scaling = glm::scale(_scaling, vector);}
-        glm::mat4 getModelMatrix() {return _translation * _rotation * _scaling;}
+        void setTextureCoordinates(const std::vector<glm::vec2> &textureCoordinates);
+        void setColors(const std::vector<glm::vec4> &colors);
+        void clearColors() {_colors.clear();}
+        void setDisplacementMap(DisplacementMap *displacementMap);
+        DisplacementMap* getDisplacementMap() {return _displacementMap;}
+
+        void translate(glm::vec3 vector){_translation = glm::translate(_translation, vector); _isTransformDirty = true;}
+        void rotate(float angle, glm::vec3 vector) {_rotation = glm::rotate(_rotation, angle, vector); _isTransformDirty = true;}
+        void scale(glm::vec3 vector) {_scaling = glm::scale(_scaling, vector); _isTransformDirty = true;}
+        glm::mat4 getModelMatrix() {updateTransform(); return _modelMatrix;}
+
+        //local bounds, recomputed when the positions change
+        void computeBounds();
+        BoundingBox getBoundingBox() {return _boundingBox;}
+        glm::vec4 getBoundingSphere() {return _boundingSphere;}
+        //world bounds, cached until the next transform
+        BoundingBox getWorldBoundingBox() {updateTransform(); return _worldBoundingBox;}
+        glm::vec4 getWorldBoundingSphere() {updateTransform(); return _worldBoundingSphere;}
+
+        //clusters are taken from the flat base level, anything that moves or reorders the surface draws whole
+        bool isMeshletUsable() {return _type == GeometryType::Mesh && _importance.empty() && !_addDisplacement &&
+                                       _displacementMap == NULL && _surfaceMode == LinearSurface && (!isLodUsable() || _lod == 0);}
+        void buildMeshlets();
+        //frustum and viewpoint in world space, the next draw only covers the surviving meshlets
+        MeshletStats cullMeshlets(const Frustum &frustum, const glm::vec4 &viewpoint, const bool cullBackfaces);
+
+        PointOctree& getOctree() {return _octree;}
+        void uploadOctree();
+        //buffer half of uploadOctree, like createBuffers
+        void createOctreeBuffers();
+        bool isOctreeUsable() {return _type == GeometryType::Cloud && _octreeIndexBuffer != 0;}
+        //frustum and viewpoint in world space, the next draw only covers the selected nodes
+        OctreeStats selectOctreeNodes(const Frustum &frustum, const glm::vec4 &viewpoint, const float pixelsPerUnit, const uint budget);
+
+        //one interleaved quantized buffer instead of the float ones, for meshes and before initialize
+        void setCompactVertices(bool value) {_compactVertices = value && _type == GeometryType::Mesh;}
+        bool isCompact() {return _compactBuffer != 0;}
+
+        //before initialize, the index, uv and delta buffers of an initialized frame are reused wherever the data is equal
+        void shareBuffers(Geometry *geometry) {_sharedSource = geometry;}
+        bool isSharingBuffers() {return _sharesIndices || _sharesTextureCoordinates || _sharesDisplacements;}
+        //positions and normals of the next frame are bound next to these, for FRAME_BLEND
+        void linkNextFrame(Geometry *geometry);
+        //fraction of the way to the next frame, for the next draw only
+        void setFrameBlend(float value) {_frameBlend = value;}
+        bool isFrameBlendUsable() {return _nextFrame != NULL && _compactBuffer == 0 && !(isLodUsable() && _lod > 0);}
 
         void initialize();
+        //buffer half of initialize, callable on any context sharing objects with the one drawing;
+        //touches neither Shaders nor RenderState, both belong to the drawing thread
+        void createBuffers();
+        //vertex arrays are never shared, on the context drawing once the buffers are complete
+        void createVertexArray();
+        //deltas rewritten every frame go through a fenced ring instead of the static buffer
+        void setDynamicDisplacements(bool value);
+        bool hasDynamicDisplacements() {return _displacementStream != NULL;}
+        void updateDisplacementBuffer();
+        void updatePositionBuffer();
+        QStringList getShaderDefines();
+        //selects the program variant, before preDraw and before sorting draws by program
+        void updateShader();
+        GLuint getVertexArray();
+        //drawn by the scene batch: untessellated and without per-corner data or texture of its own
+        bool isBatchable() {return _type == GeometryType::Mesh && !_material->doTessellation() && _colors.empty() &&
+                                   !_addDisplacement && _displacementMap == NULL;}
         void preDraw();
         void draw();
 
         Shader* getShader() {return _material->getShader();}
+        bool isShaderReady() {return _material->isShaderReady();}
         Material* getMaterial() {return _material;}
 
         bool isQuads() {return _indices.size()%3 == 0;}
@@ -146,46 +241,128 @@ namespace Tessellation
         bool addDisplacement(bool value)
         {
             _addDisplacement = value;
-            _material->getShader()->addDisplacement(_addDisplacement);
         }
+        bool isDisplacementAdded() {return _addDisplacement;}
 
         void setInnerTL(int value) {_innerTL = value;}
         void setOuterTL(int value) {_outerTL = value;}
+        int getInnerTL() {return _innerTL;}
+        int getOuterTL() {return _outerTL;}
+        void setAdaptiveTL(bool value) {_adaptiveTL = value;}
+        bool isAdaptiveTL() {return _adaptiveTL;}
+        void setPixelsPerEdge(float value) {_pixelsPerEdge = value;}
+        float getPixelsPerEdge() {return _pixelsPerEdge;}
+        void setImportance(const std::vector<glm::vec4> &importance, const float scale);
+        void setImportanceScale(const float scale) {_importanceScale = scale;}
+        void clearImportance() {_importance.clear();}
+        void setSurfaceMode(int mode) {_surfaceMode = mode;}
+        void setPhongShape(float value) {_phongShape = value;}
+        void computeNormals();
+
+        LodChain& getLodChain() {return _lodChain;}
+        void uploadLodChain();
+        //buffer half of uploadLodChain, like createBuffers
+        void createLodBuffers();
+        void createLodVertexArrays();
+        void setLod(uint level) {_lod = std::min(level, static_cast<uint>(_lodBuffers.size()));}
+        uint getLod() {return _lod;}
+        //simplified levels drop the per-corner attributes (deltas, colors, patch importance)
+        bool isLodUsable() {return !_lodBuffers.empty() && _colors.empty() && _importance.empty() && !_addDisplacement;}
+
+        //triangles reordered for the post-transform cache, then by cluster against overdraw
+        OptimizerStats optimizeTriangleOrder();
+        //order of the file's triangles, frames of an animation share the one of the first
+        void setTriangleOrder(const std::vector<uint> &order);
+        const std::vector<uint>& getTriangleOrder() {return _triangleOrder;}
+        bool hasSameConnectivity(Geometry *geometry);
 
         uint getTriangleCount() {return _triangleCount;}
         uint getVertexCount() {return _vertexCount;}
         uint getId() {return _id;}
+        void setId(uint id) {_id = id;}
+        //bumped whenever the vertices or the draw indices are rewritten
+        uint getRevision() {return _revision;}
+        QString getFilename() {return _filename;}
 
         uint getType() {return _type;}
 
     protected:
         std::vector<uint> _indices;
+        std::vector<uint> _drawIndices;
+        std::vector<uint> _triangleOrder;
         std::vector<IndicePolygon> _indicePolygons;
         std::vector<glm::vec3> _positions;
         std::vector<glm::vec3> _normals;
         std::vector<glm::vec2> _textureCoordinates;
         std::vector<glm::vec3> _displacements;
+        std::vector<glm::vec4> _colors;
 
         uint *_indiceArray;
         int _innerTL;
         int _outerTL;
+        bool _adaptiveTL;
+        float _pixelsPerEdge;
+        //last program the sampler units were set on
+        Shader *_boundShader;
+        std::vector<glm::vec4> _importance;
+        float _importanceScale;
+        int _surfaceMode;
+        float _phongShape;
+
+        LodChain _lodChain;
+        std::vector<LodBuffers> _lodBuffers;
+        uint _lod;
+
+        BoundingBox _boundingBox;
+        glm::vec4 _boundingSphere;
+
+        MeshletSet _meshlets;
+        GLuint _meshletIndexBuffer;
+        uint _meshletIndexCount;
+        bool _drawMeshlets;
+
+        PointOctree _octree;
+        GLuint _octreeIndexBuffer;
+        GLuint _spacingBuffer;
+        std::vector<GLsizei> _nodeCounts;
+        std::vector<const GLvoid*> _nodeOffsets;
+        bool _drawOctree;
 
         std::vector<Polygon> _polygons;
         std::vector<Vertex> _vertices;
 
         Material *_material;
+        DisplacementMap *_displacementMap;
         uint _type;
 
     private:
+        void updateTransform();
+        void updateDrawIndices();
+        void uploadCompactVertices();
+        //a buffer used by other frames gets a name of its own before this frame writes to it, true if it did
+        bool detachSharedBuffer(GLuint &buffer, bool &isShared);
+        //frames holding each index, uv and delta buffer, the last one to let go deletes it
+        static void retainBuffer(const GLuint buffer);
+        static void releaseBuffer(const GLuint buffer);
+        static bool isBufferShared(const GLuint buffer);
+        void resolveAttributeLocations();
+        void updateVertexArray(GLuint &vertexArray, const GLuint vertexBuffer, const GLuint textureBuffer,
+                               const GLuint normalBuffer, const GLuint displacementBuffer);
+
         bool _hasNormals;
         bool _isTessellable;
         bool _addDisplacement;
         uint _id;
+        QString _filename;
 
         uint _locationVertices;
         uint _locationTextureCoordinates;
         uint _locationNormals;
         uint _locationDisplacement;
+        uint _locationColors;
+        uint _locationPointSpacing;
+        uint _locationNextPosition;
+        uint _locationNextNormal;
 
         uint _triangleCount;
         uint _vertexCount;
@@ -193,6 +370,10 @@ namespace Tessellation
         glm::mat4 _translation;
         glm::mat4 _rotation;
         glm::mat4 _scaling;
+        glm::mat4 _modelMatrix;
+        BoundingBox _worldBoundingBox;
+        glm::vec4 _worldBoundingSphere;
+        bool _isTransformDirty;
 
         glm::mat4 _mvp;
 
@@ -203,6 +384,26 @@ namespace Tessellation
         GLuint _textureBuffer;
         GLuint _normalBuffer;
         GLuint _displacementBuffer;
+        GLuint _importanceBuffer;
+        GLuint _importanceTexture;
+
+        bool _compactVertices;
+        VertexQuantization _quantization;
+        GLuint _compactBuffer;
+
+        Geometry *_sharedSource;
+        bool _sharesIndices;
+        bool _sharesTextureCoordinates;
+        bool _sharesDisplacements;
+        static std::map<GLuint, uint> _bufferUsers;
+        static QMutex _bufferUsersMutex;
+        Geometry *_nextFrame;
+        float _frameBlend;
+        uint _revision;
+        //derived from the positions rather than read from the file, so a fit may recompute them
+        bool _hasComputedNormals;
+
+        std::shared_ptr<StreamBuffer> _displacementStream;
 
         bool _invertNormals;
     };
@@ -214,6 +415,11 @@ namespace Tessellation
         static float getDistance(glm::vec3 polygon[3], glm::vec3 point);
         static glm::vec3 getProjection(glm::vec3 polygon[3], glm::vec3 point);
         static glm::vec3 getDisplacement(glm::vec3 polygon[3], glm::vec3 point);
+        static glm::vec3 getClosestPoint(glm::vec3 polygon[3], glm::vec3 point, glm::vec3 &barycentric);
+        static std::vector<glm::vec3> getSmoothNormals(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        //SHA-1 of the mesh data a cache was built from
+        static QByteArray getMeshHash(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                                      const std::vector<glm::vec2> &textureCoordinates = std::vector<glm::vec2>());
     };
 
 }
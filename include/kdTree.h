@@ -0,0 +1,53 @@
+#ifndef KD_TREE_H
+#define KD_TREE_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct Neighbor
+    {
+        Neighbor(): id(0), distance(0.0f) {}
+        Neighbor(const uint id, const float distance): id(id), distance(distance) {}
+
+        bool operator<(const Neighbor &neighbor) const {return distance < neighbor.distance;}
+
+        uint id;
+        float distance;
+    };
+
+    //balanced kd-tree over points for nearest neighbor queries
+    class KdTree
+    {
+    public:
+        KdTree() {}
+        KdTree(const std::vector<glm::vec3> &points);
+        ~KdTree() {}
+
+        void build(const std::vector<glm::vec3> &points);
+        bool isEmpty() {return _points.empty();}
+        uint getSize() {return _points.size();}
+
+        bool getNearest(const glm::vec3 &point, Neighbor &nearest);
+        void getNearest(const glm::vec3 &point, const uint k, std::vector<Neighbor> &neighbors);
+        void getNeighbors(const glm::vec3 &point, const float radius, std::vector<Neighbor> &neighbors);
+
+    private:
+        void subdivide(const uint first, const uint last, const int depth);
+        void search(const uint first, const uint last, const int depth, const glm::vec3 &point,
+                    const uint k, std::vector<Neighbor> &neighbors, float &bound);
+        void searchRadius(const uint first, const uint last, const int depth, const glm::vec3 &point,
+                          const float radius, std::vector<Neighbor> &neighbors);
+
+        //points reordered so that each subtree is a contiguous range split at its median
+        std::vector<glm::vec3> _points;
+        std::vector<uint> _ids;
+    };
+
+}
+
+#endif // KD_TREE_H
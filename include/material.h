@@ -2,6 +2,7 @@
 #define MATERIAL_H
 
 #include "shader.h"
+#include "renderState.h"
 #include <iostream>
 #include <cassert>
 
@@ -11,17 +12,37 @@ namespace Tessellation
     class Material
     {
     public:
-        Material(QString value) {_shader = Shaders::getShader(value);}
+        Material(QString value): _shader(NULL), _value(value) {}
         ~Material() {}
 
         void initialize();
-        void setShader(QString value) {_shader = Shaders::getShader(value);}
-        bool equals(QString value) {return _shader->getValue() == value;}
-        Shader* getShader() {return _shader;}
+        void setShader(QString value) {_value = value; _shader = NULL;}
+        //selects the variant of the shader compiled with these defines
+        void setDefines(const QStringList &defines)
+        {
+            if (defines != _defines)
+            {
+                _defines = defines;
+                _shader = NULL;
+            }
+        }
+        bool equals(QString value) {return _value == value;}
+        QString getValue() {return _value;}
+        bool doTessellation() {return Shaders::doTessellation(_value);}
+        Shader* getShader()
+        {
+            if (_shader == NULL)
+                _shader = Shaders::getShader(_value, _defines);
+            return _shader;
+        }
+        //a variant still linking in the background is not waited for
+        bool isShaderReady() {return _shader != NULL || Shaders::isReady(_value, _defines);}
         virtual void bind() {}
 
     protected:
         Shader* _shader;
+        QString _value;
+        QStringList _defines;
 
     private:
         virtual void configShader() {}
@@ -36,16 +57,16 @@ namespace Tessellation
 
         void bind()
         {
-            glEnable(GL_DEPTH_TEST);
-            glDisable(GL_CULL_FACE);
-            glDisable(GL_BLEND);
+            RenderState::setCapability(GL_DEPTH_TEST, true);
+            RenderState::setCapability(GL_CULL_FACE, false);
+            RenderState::setCapability(GL_BLEND, false);
 
             configShader();
         }
 
         void configShader()
         {
-            _shader->bind();
+            getShader()->bind();
         }
 
         glm::vec4 getColor() {return _color;}
@@ -32,6 +32,7 @@ namespace Tessellation
         void defaultValues();
         void resetScene();
         void saveSnapshot();
+        void exportTessellation();
         void about();
 
         //tessellation
@@ -39,14 +40,32 @@ namespace Tessellation
         void setInnerLevel(int level);
         void setOuterLevel(int level);
         void setUniform(bool value);
+        void setAdaptive(bool value);
+        void setPixelsPerEdge(int value);
+        void setImportance(bool value);
+        void setBudget(int value);
+        void updateImportance();
+        void setSurfaceMode(int mode);
+        void setLevelOfDetail(bool value);
+        void buildLodChains();
+        void setSortedSubmission(bool value);
+        void setBatching(bool value);
+        void setFrustumCulling(bool value);
+        void setMeshletCulling(bool value);
+        void setCompactVertices(bool value);
 
         //displacement
         void toggleDisplacement(bool value);
         void setDensity(int value);
+        void setPointBudget(int value);
         void setDistanceEpsilon(int value);
         void browseInputPoints();
         void showInputPoints(bool value);
         void updateInputPoints();
+        void updateInputPointsField();
+        void bakeDisplacementMap();
+        void fitMesh();
+        void analyzeDeviation();
 
         //player
         void changeCurrentFrame(int currentFrame);
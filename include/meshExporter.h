@@ -0,0 +1,34 @@
+#ifndef MESH_EXPORTER_H
+#define MESH_EXPORTER_H
+
+#include <QString>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct IndexedMesh
+    {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec2> textureCoordinates;
+        std::vector<uint> indices;
+
+        size_t getVertexCount() {return positions.size();}
+        size_t getTriangleCount() {return indices.size() / 3;}
+    };
+
+    class MeshExporter
+    {
+    public:
+        static bool write(QString filename, IndexedMesh &mesh);
+        static bool writeOBJ(QString filename, IndexedMesh &mesh);
+        static bool writePLY(QString filename, IndexedMesh &mesh);
+    };
+
+}
+
+#endif // MESH_EXPORTER_H
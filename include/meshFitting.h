@@ -0,0 +1,55 @@
+#ifndef MESH_FITTING_H
+#define MESH_FITTING_H
+
+#include <vector>
+#include <limits>
+
+#include "geometry.h"
+#include "meshTopology.h"
+#include "sparseMatrix.h"
+
+namespace Tessellation
+{
+
+    struct FittingStats
+    {
+        FittingStats():
+            vertices(0), correspondences(0), iterations(0), residual(0.0f), milliseconds(0.0) {}
+
+        uint vertices;
+        uint correspondences;
+        uint iterations;
+        float residual;
+        double milliseconds;
+    };
+
+    //moves mesh vertices toward their closest cloud points under a Laplacian
+    //smoothness term on the displacement field:
+    //  min sum w_i |x_i - c_i|^2 + smoothness * (x - x0)^T L (x - x0)
+    class MeshFitting
+    {
+    public:
+        MeshFitting(const float smoothness = 1.0f, const float maxDistance = std::numeric_limits<float>::max());
+        ~MeshFitting() {}
+
+        FittingStats fit(Geometry *mesh, const std::vector<glm::vec3> &points);
+        void reset();
+
+        void setSmoothness(const float smoothness) {_smoothness = smoothness;}
+        void setMaxDistance(const float maxDistance) {_maxDistance = maxDistance;}
+
+    private:
+        float _smoothness;
+        float _maxDistance;
+
+        MeshTopology _topology;
+        ConjugateGradient _solver;
+
+        //solution of the previous frame to warm start the next one, for the same welded connectivity only
+        std::vector<float> _previousSolution[3];
+        std::vector<uint> _previousCornerVertices;
+    };
+
+}
+
+#endif // MESH_FITTING_H
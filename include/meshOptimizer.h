@@ -0,0 +1,65 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    //post-transform cache behaviour of an index list
+    struct CacheStats
+    {
+        CacheStats(): triangles(0), vertices(0), transforms(0) {}
+
+        //vertex shader runs per triangle, 3 without any reuse, 0.5 at best
+        float getACMR() const {return (triangles > 0) ? static_cast<float>(transforms) / triangles : 0.0f;}
+        //vertex shader runs per vertex, 1 at best
+        float getATVR() const {return (vertices > 0) ? static_cast<float>(transforms) / vertices : 0.0f;}
+
+        uint triangles;
+        uint vertices;
+        uint transforms;
+    };
+
+    struct OptimizerStats
+    {
+        OptimizerStats(): clusters(0), milliseconds(0.0) {}
+
+        CacheStats original;
+        CacheStats optimized;
+        uint clusters;
+        double milliseconds;
+    };
+
+    //triangle reordering of Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+    class MeshOptimizer
+    {
+    public:
+        MeshOptimizer(const uint cacheSize = 16): _cacheSize(cacheSize) {}
+        ~MeshOptimizer() {}
+
+        //vertexIds holds three welded vertices per triangle, positions one per corner;
+        //returns the triangles in drawing order
+        std::vector<uint> optimize(const std::vector<glm::vec3> &positions, const std::vector<uint> &vertexIds, OptimizerStats &stats);
+
+        //FIFO cache simulation
+        static CacheStats simulateCache(const std::vector<uint> &vertexIds, const uint cacheSize);
+        //first corner with the same attributes for every corner, missing attributes are left empty
+        static std::vector<uint> weldCorners(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals,
+                                             const std::vector<glm::vec2> &textureCoordinates, const std::vector<glm::vec4> &colors);
+
+    private:
+        //vertex cache order, clusterStarts receives the first triangle after each cache flush
+        std::vector<uint> tipsify(const std::vector<uint> &vertexIds, const uint vertexCount, std::vector<uint> &clusterStarts);
+        //clusters facing away from the center first, as they are the likeliest occluders
+        void sortClusters(const std::vector<glm::vec3> &positions, std::vector<uint> &order, const std::vector<uint> &clusterStarts);
+
+        uint _cacheSize;
+    };
+
+}
+
+#endif // MESH_OPTIMIZER_H
@@ -0,0 +1,108 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <QString>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    //symmetric 4x4 error quadric of Garland and Heckbert
+    struct Quadric
+    {
+        Quadric() {for (int i = 0; i < 10; i++) q[i] = 0.0;}
+        Quadric(const glm::dvec4 &plane, const double weight = 1.0);
+
+        Quadric& operator+=(const Quadric &quadric)
+        {
+            for (int i = 0; i < 10; i++)
+                q[i] += quadric.q[i];
+            return *this;
+        }
+
+        double evaluate(const glm::dvec3 &point) const;
+        bool getMinimum(glm::dvec3 &point) const;
+
+        //xx xy xz xw yy yz yw zz zw ww
+        double q[10];
+    };
+
+    struct LodLevel
+    {
+        LodLevel(): error(0.0f) {}
+
+        uint getTriangleCount() const {return indices.size() / 3;}
+
+        //indexed level, error is the largest collapse distance in object space
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> textureCoordinates;
+        std::vector<uint> indices;
+        float error;
+    };
+
+    struct SimplifierStats
+    {
+        SimplifierStats(): levels(0), triangles(0), collapses(0), rejected(0), milliseconds(0.0) {}
+
+        uint levels;
+        uint triangles;
+        uint collapses;
+        //collapses skipped because they would flip a triangle
+        uint rejected;
+        double milliseconds;
+    };
+
+    class MeshSimplifier
+    {
+    public:
+        MeshSimplifier(const float boundaryWeight = 1000.0f): _boundaryWeight(boundaryWeight) {}
+        ~MeshSimplifier() {}
+
+        //collapses edges by increasing quadric error until targetTriangles remain
+        bool simplify(const LodLevel &input, const uint targetTriangles, LodLevel &output, SimplifierStats &stats);
+
+    private:
+        float _boundaryWeight;
+    };
+
+    //successively halved versions of a mesh, level 0 being the geometry itself
+    class LodChain
+    {
+    public:
+        LodChain(): _sourceTriangles(0), _sourceVertices(0) {}
+        ~LodChain() {}
+
+        SimplifierStats build(const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &textureCoordinates,
+                              const std::vector<uint> &indices, const float ratio = 0.5f, const uint minTriangles = 64,
+                              const uint maxLevels = 6);
+        void clear() {_levels.clear(); _sourceTriangles = 0; _sourceVertices = 0; _sourceHash.clear();}
+
+        bool save(QString filename);
+        //false unless the file was built from exactly this mesh and every index is in range
+        bool load(QString filename, const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &textureCoordinates,
+                  const std::vector<uint> &indices);
+
+        //coarsest level whose error covers at most maxPixelError pixels
+        uint selectLevel(const float unitsPerPixel, const float maxPixelError = 1.0f);
+
+        uint getLevelCount() {return _levels.size();}
+        LodLevel& getLevel(const uint level) {return _levels[level];}
+        bool isEmpty() {return _levels.empty();}
+
+    private:
+        //triangles in vertex cache and overdraw order, vertices renumbered by first use
+        static void optimizeLevel(LodLevel &level);
+
+        //the mesh the chain was built from, saved with it
+        uint _sourceTriangles;
+        uint _sourceVertices;
+        QByteArray _sourceHash;
+        std::vector<LodLevel> _levels;
+    };
+
+}
+
+#endif // MESH_SIMPLIFIER_H
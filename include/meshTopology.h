@@ -0,0 +1,70 @@
+#ifndef MESH_TOPOLOGY_H
+#define MESH_TOPOLOGY_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct PositionHash : std::unary_function<glm::vec3, size_t> {
+        std::size_t operator()(const glm::vec3 &p) const {
+            size_t hash = 0;
+            boost::hash_combine(hash, p.x);
+            boost::hash_combine(hash, p.y);
+            boost::hash_combine(hash, p.z);
+            return hash;
+        }
+    };
+
+    //welded connectivity of a triangle soup (corners sharing a position share a vertex)
+    class MeshTopology
+    {
+    public:
+        MeshTopology() {}
+        MeshTopology(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        ~MeshTopology() {}
+
+        void build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        void clear();
+
+        uint getTriangleCount() {return _triangles.size();}
+        uint getVertexCount() {return _vertices.size();}
+        uint getEdgeCount() {return _edges.size();}
+        bool isEmpty() {return _triangles.empty();}
+
+        glm::vec3 getVertex(const uint vertex) {return _vertices[vertex];}
+        std::vector<glm::vec3>& getVertices() {return _vertices;}
+        glm::uvec3 getTriangle(const uint triangle) {return _triangles[triangle];}
+        void getTriangleVertices(const uint triangle, glm::vec3 polygon[3]);
+
+        //corner (index into the geometry's index buffer) to welded vertex
+        uint getVertexId(const uint corner) {return _cornerVertices[corner];}
+        std::vector<uint>& getCornerVertices() {return _cornerVertices;}
+
+        //neighbor across edge k (corner k to corner k+1), -1 on a border
+        glm::ivec3 getTriangleNeighbors(const uint triangle) {return _triangleNeighbors[triangle];}
+        //unique edge id of edge k of a triangle
+        glm::uvec3 getTriangleEdges(const uint triangle) {return _triangleEdges[triangle];}
+        glm::uvec2 getEdge(const uint edge) {return _edges[edge];}
+
+        std::vector<uint>& getVertexTriangles(const uint vertex) {return _vertexTriangles[vertex];}
+        std::vector<uint>& getVertexNeighbors(const uint vertex) {return _vertexNeighbors[vertex];}
+
+    private:
+        std::vector<glm::vec3> _vertices;
+        std::vector<uint> _cornerVertices;
+        std::vector<glm::uvec3> _triangles;
+        std::vector<glm::ivec3> _triangleNeighbors;
+        std::vector<glm::uvec3> _triangleEdges;
+        std::vector<glm::uvec2> _edges;
+        std::vector<std::vector<uint> > _vertexTriangles;
+        std::vector<std::vector<uint> > _vertexNeighbors;
+    };
+
+}
+
+#endif // MESH_TOPOLOGY_H
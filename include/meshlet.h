@@ -0,0 +1,75 @@
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    //cluster of neighboring triangles, a range of MeshletSet's corner indices
+    struct Meshlet
+    {
+        uint firstIndex;
+        uint indexCount;
+        glm::vec4 sphere;
+        //every face normal is within the cone, cutoff is the sine of its half angle (above 1 when it can not be culled)
+        glm::vec3 coneAxis;
+        float coneCutoff;
+    };
+
+    struct MeshletStats
+    {
+        MeshletStats(): meshlets(0), culled(0), backfacing(0), triangles(0), visibleTriangles(0) {}
+
+        MeshletStats& operator+=(const MeshletStats &stats)
+        {
+            meshlets += stats.meshlets;
+            culled += stats.culled;
+            backfacing += stats.backfacing;
+            triangles += stats.triangles;
+            visibleTriangles += stats.visibleTriangles;
+            return *this;
+        }
+
+        uint meshlets;
+        //outside the frustum, and facing away from the viewpoint
+        uint culled;
+        uint backfacing;
+        uint triangles;
+        uint visibleTriangles;
+    };
+
+    class MeshletSet
+    {
+    public:
+        static const uint MAX_VERTICES = 64;
+        static const uint MAX_TRIANGLES = 126;
+
+        MeshletSet() {}
+
+        //greedy growth over the welded adjacency of a triangle soup
+        void build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices);
+        void clear() {_meshlets.clear(); _indices.clear();}
+        bool isEmpty() {return _meshlets.empty();}
+
+        //viewpoint is a position (w = 1) or, for an orthographic camera, the view direction (w = 0),
+        //everything in the space of the positions; writes the corner indices of the surviving meshlets
+        MeshletStats cull(const Frustum &frustum, const glm::vec4 &viewpoint, const bool cullBackfaces,
+                          std::vector<uint> &indices) const;
+
+        uint getMeshletCount() {return _meshlets.size();}
+        const Meshlet& getMeshlet(const uint meshlet) {return _meshlets[meshlet];}
+
+    private:
+        std::vector<Meshlet> _meshlets;
+        std::vector<uint> _indices;
+    };
+
+}
+
+#endif // MESHLET_H
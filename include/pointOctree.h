@@ -0,0 +1,93 @@
+#ifndef POINT_OCTREE_H
+#define POINT_OCTREE_H
+
+#include <QString>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    //cube holding a subsample of the points left by its ancestors, a range of PointOctree's indices
+    struct OctreeNode
+    {
+        glm::vec3 center;
+        float halfSize;
+        uint depth;
+        uint firstIndex;
+        uint count;
+        int children[8];
+    };
+
+    struct OctreeStats
+    {
+        OctreeStats(): nodes(0), levels(0), points(0), selectedNodes(0), selectedPoints(0), milliseconds(0.0) {}
+
+        OctreeStats& operator+=(const OctreeStats &stats)
+        {
+            nodes += stats.nodes;
+            levels = std::max(levels, stats.levels);
+            points += stats.points;
+            selectedNodes += stats.selectedNodes;
+            selectedPoints += stats.selectedPoints;
+            milliseconds += stats.milliseconds;
+            return *this;
+        }
+
+        uint nodes;
+        uint levels;
+        uint points;
+        uint selectedNodes;
+        uint selectedPoints;
+        double milliseconds;
+    };
+
+    //hierarchical point LOD: drawing a node and its ancestors gives a uniform subsample of the cloud
+    class PointOctree
+    {
+    public:
+        //subsampling grid of a node, one point is kept per cell
+        static const uint NODE_GRID = 32;
+        static const uint LEAF_POINTS = 4096;
+        static const uint MAX_DEPTH = 16;
+
+        PointOctree(): _sourcePoints(0) {}
+        ~PointOctree() {}
+
+        OctreeStats build(const std::vector<glm::vec3> &positions);
+        void clear() {_nodes.clear(); _indices.clear(); _sourcePoints = 0; _sourceHash.clear();}
+
+        bool save(QString filename);
+        //false unless the file was built from exactly these points and every node and index is in range
+        bool load(QString filename, const std::vector<glm::vec3> &positions);
+
+        //nodes by decreasing projected size until the budget is spent, parents always before their children;
+        //viewpoint as in MeshletSet::cull, pixelsPerUnit at a distance of one in front of the camera
+        OctreeStats select(const Frustum &frustum, const glm::mat4 &model, const glm::vec4 &viewpoint,
+                           const float pixelsPerUnit, const uint budget, std::vector<uint> &nodes) const;
+
+        //point ids in node order
+        const std::vector<uint>& getIndices() {return _indices;}
+        //object space distance between the points of the node holding each point
+        std::vector<float> getPointSpacings();
+
+        const OctreeNode& getNode(const uint node) {return _nodes[node];}
+        uint getNodeCount() {return _nodes.size();}
+        bool isEmpty() {return _nodes.empty();}
+
+    private:
+        //the cloud the tree was built from, saved with it
+        uint _sourcePoints;
+        QByteArray _sourceHash;
+        std::vector<OctreeNode> _nodes;
+        std::vector<uint> _indices;
+    };
+
+}
+
+#endif // POINT_OCTREE_H
@@ -0,0 +1,57 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <GL/glew.h>
+#include <map>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    static const uint MAX_TEXTURE_UNITS = 8;
+
+    struct RenderStats
+    {
+        RenderStats(): submissions(0), calls(0), skipped(0), programs(0), vertexArrays(0) {}
+
+        uint submissions;
+        //GL calls issued while drawing, and state changes dropped because the state was already set
+        uint calls;
+        uint skipped;
+        uint programs;
+        uint vertexArrays;
+    };
+
+    //last GL state set while drawing, so that redundant changes are never issued
+    class RenderState
+    {
+    public:
+        //forgets the cached state, for when something else may have touched the context
+        static void invalidate();
+        static void setCaching(const bool value) {_caching = value; invalidate();}
+        static bool isCaching() {return _caching;}
+
+        static void useProgram(const GLuint program);
+        static void bindVertexArray(const GLuint vertexArray);
+        static void bindTexture(const uint unit, const GLenum target, const GLuint texture);
+        static void setCapability(const GLenum capability, const bool enabled);
+
+        static void countCalls(const uint calls) {_stats.calls += calls;}
+        static void countDraw() {_stats.submissions++; _stats.calls++;}
+        static RenderStats getStats() {return _stats;}
+        static void resetStats() {_stats = RenderStats();}
+
+    private:
+        static bool _caching;
+        static GLuint _program;
+        static GLuint _vertexArray;
+        static uint _activeUnit;
+        static GLuint _textures[MAX_TEXTURE_UNITS];
+        static std::map<GLenum, bool> _capabilities;
+        static RenderStats _stats;
+    };
+
+}
+
+#endif // RENDER_STATE_H
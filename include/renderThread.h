@@ -0,0 +1,64 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <QThread>
+#include <QSemaphore>
+#include <QString>
+
+#include <atomic>
+#include <functional>
+
+#include "spscQueue.h"
+#include "viewSnapshot.h"
+
+namespace Tessellation
+{
+
+    class SceneViewer;
+
+    //everything a frame reads that the GUI thread keeps changing, copied when the frame is requested;
+    //plain data only, the ring hands it to another thread
+    struct FrameSnapshot
+    {
+        FrameSnapshot(): currentFrame(1), animation(false), frameBlend(0.0f) {}
+
+        ViewSnapshot view;
+        int currentFrame;
+        bool animation;
+        float frameBlend;
+    };
+
+    //a change of scene state, run on the render thread before the next frame
+    typedef std::function<void()> RenderCommand;
+
+    //milliseconds between two looks at pending uploads and linking programs when nothing else is posted
+    static const int UPLOAD_POLL_INTERVAL = 16;
+
+    //owns the viewer's context, the GUI thread only sends commands and snapshots
+    class RenderThread : public QThread
+    {
+    public:
+        RenderThread(SceneViewer *viewer);
+        ~RenderThread();
+
+        //GUI thread only, commands run in the order they are posted
+        void post(const RenderCommand &command);
+        //GUI thread only, false when the render thread is still behind on earlier frames
+        bool requestFrame(const FrameSnapshot &snapshot);
+        void stop();
+
+    protected:
+        void run();
+
+    private:
+        SceneViewer *_viewer;
+        SpscQueue<RenderCommand, 256> _commands;
+        SpscQueue<FrameSnapshot, 4> _snapshots;
+        //counts posted work, the queues themselves never wait
+        QSemaphore _work;
+        std::atomic<bool> _isStopping;
+    };
+
+}
+
+#endif // RENDER_THREAD_H
@@ -30,7 +30,6 @@ namespace Tessellation
         bool _initialized;
         bool _doTessellation;
 
-        qglviewer::Camera *_camera;
         Scene *_scene;
     };
 
@@ -2,11 +2,23 @@
 #define SCENE_H
 
 #include <QProgressBar>
+#include <QMutex>
 #include <vector>
+#include <map>
 
 #include "geometry.h"
 #include "light.h"
 #include "spatialGrid.h"
+#include "displacement.h"
+#include "distanceField.h"
+#include "meshFitting.h"
+#include "deviation.h"
+#include "tessellationImportance.h"
+#include "tessellationCapture.h"
+#include "renderState.h"
+#include "sceneBatch.h"
+#include "uploadWorker.h"
+#include "viewSnapshot.h"
 
 #include <QGLViewer/qglviewer.h>
 
@@ -17,6 +29,24 @@ namespace Tessellation
 
     using namespace qglviewer;
 
+    //one submission of the draw list, ordered to minimize state changes
+    struct DrawItem
+    {
+        GLuint program;
+        Material *material;
+        GLuint vertexArray;
+        Geometry *geometry;
+
+        bool operator<(const DrawItem &item) const
+        {
+            if (program != item.program)
+                return program < item.program;
+            if (material != item.material)
+                return material < item.material;
+            return vertexArray < item.vertexArray;
+        }
+    };
+
     class Scene
     {
     public:
@@ -32,8 +62,16 @@ namespace Tessellation
         void resize(uint width, uint height);
 
         Camera* getCamera() {return _camera.get();}
+        //view taken from the viewer's camera for the frame, drawing never reads the camera the viewer moves;
+        //without one the camera is read directly
+        void setView(const ViewSnapshot &view) {_view = view; _hasViewSnapshot = true;}
+        //view projection of the frame being drawn
+        glm::mat4 getMVP() {return _mvp;}
         void addGeometry(Geometry* geometry)
         {
+            //the field is baked from the meshes of the scene, it is looked up again on next use
+            if (geometry->getType() == GeometryType::Mesh)
+                _distanceField.reset();
             _geometries.push_back(geometry);
         }
         std::vector<Geometry*> getGeometries() {return _geometries;}
@@ -47,12 +85,23 @@ namespace Tessellation
         glm::mat4 getCurrentMVP();
         void loadModel(std::string path, const bool isTessellable = true);
         void loadLight();
+        //with an upload worker, the model shows up in the first draw after its buffers are complete
         void loadScene(std::string path, const bool isTessellable = true);
+        void setUploadWorker(std::shared_ptr<UploadWorker> worker);
+        bool hasPendingUploads();
+        //objects of the last frame were left out while their program finished linking
+        bool hasPendingShaders() {return _hasPendingShaders;}
         void loadAnimation(std::string path, const int frameCount, QProgressBar &progress);
         void reset()
         {
             _loaded = false;
             _geometries.clear();
+            _temporalDisplacements.clear();
+            _distanceField.reset();
+            _meshFitting.reset();
+            _importance.reset();
+            _importanceMesh = NULL;
+            _batch.reset();
         }
 
         uint getWidth() {return _width;}
@@ -62,23 +111,83 @@ namespace Tessellation
         Light* getLight() {return _light.get();}
 
         void updateObjectShaders(const bool doTessellation);
+        void setAdaptiveTessellation(const bool adaptive, const float pixelsPerEdge);
+        void setSurfaceMode(const int mode);
+        CaptureStats captureTessellation(const int currentFrame, IndexedMesh &mesh);
+        ImportanceStats updateTessellationImportance(const int currentFrame, const bool enabled, const uint budget);
+        void setLevelOfDetail(const bool enabled, const float pixelError);
+        void setSortedSubmission(const bool sorted);
+        BatchStats setBatching(const bool enabled);
+        RenderStats getRenderStats() {return _renderStats;}
+        void setFrustumCulling(const bool enabled);
+        CullStats getCullStats() {return _cullStats;}
+        //clusters facing away are dropped too, which assumes closed surfaces
+        void setMeshletCulling(const bool enabled);
+        MeshletStats getMeshletStats() {return _meshletStats;}
+        void setPointBudget(const uint budget);
+        //quantized interleaved vertices for the next meshes loaded
+        void setCompactVertices(const bool enabled);
+        //position between the current animation frame and the next, from the player
+        void setFrameBlend(const float blend) {_frameBlend = blend;}
+        OctreeStats getPointStats() {return _pointStats;}
+        SimplifierStats buildLodChains();
         void updateGrid(Geometry *geometry);
         void showInputPoints(bool value) {_showInputPoints = value;}
         void addDisplacement(bool value);
+        DisplacementStats updateAnimationDisplacement(const int currentFrame);
+        void bakeDisplacementMap(const uint resolution = 1024);
+        FittingStats fitMesh(const int currentFrame);
+        //one report per cloud, then one over all of them when there are several
+        std::vector<DeviationReport> analyzeDeviation(const int currentFrame, const bool colorize = true);
+        std::vector<std::vector<DeviationReport> > analyzeSequence(QString reportFilename);
 
         void frontCameraView();
         void rightCameraView();
         void topCameraView();
         bool toggleCameraProjectionType();
 
+    private:
+        void updateFrameUniforms();
+        void submit(Geometry *geometry);
+        void updateFrustum();
+        bool isCulled(Geometry *geometry);
+        bool loadLodChain(Geometry *geometry);
+        bool loadOctree(Geometry *geometry);
+        //file and CPU halves of the two above, without any GL call
+        bool readLodChain(Geometry *geometry);
+        bool readOctree(Geometry *geometry);
+        //parsed, scaled and reordered, without any buffer; reads no scene member, the upload worker calls it
+        Geometry* createGeometry(std::string path, const uint geometryId, const bool isTessellable, const bool compactVertices,
+                                 Geometry *previous);
+        void finishUploads();
+        void selectLod(Geometry *geometry);
+        //an empty grid refilled from every geometry, once their positions moved
+        void rebuildGrid();
+        //simplified again from the current mesh, cached and uploaded
+        SimplifierStats rebuildLodChain(Geometry *geometry);
+        //against the levels the control shader of the mesh uses, the panel ones or the adaptive ones of the current view
+        ImportanceStats fitImportance(Geometry *mesh);
+
     public slots:
         void updateInputPoints();
+        void updateInputPointsField();
 
     private:
         std::shared_ptr<Camera> _camera;
+        ViewSnapshot _view;
+        bool _hasViewSnapshot;
         std::vector<Geometry*> _geometries;
         std::shared_ptr<Light> _light;
         std::shared_ptr<SpatialGrid> _grid;
+        QMutex _gridMutex;
+        std::map<uint, std::shared_ptr<TemporalDisplacement> > _temporalDisplacements;
+        std::shared_ptr<DistanceField> _distanceField;
+        std::shared_ptr<MeshFitting> _meshFitting;
+        //kept with its mesh and budget, adaptive levels follow the view so the scale is refitted as it moves
+        std::shared_ptr<TessellationImportance> _importance;
+        Geometry *_importanceMesh;
+        uint _importanceBudget;
+        glm::mat4 _importanceMVP;
 
         glm::mat4 _modelView;
         glm::mat4 _projection;
@@ -89,8 +198,28 @@ namespace Tessellation
         Vec _initialCameraUpVector;
 
         bool _loaded;
+        bool _hasPendingShaders;
         float _moveSpeed;
         bool _showInputPoints;
+        bool _doLod;
+        float _lodPixelError;
+
+        std::vector<DrawItem> _drawList;
+        std::shared_ptr<SceneBatch> _batch;
+        RenderStats _renderStats;
+
+        bool _doCulling;
+        Frustum _frustum;
+        CullStats _cullStats;
+        bool _doMeshletCulling;
+        glm::vec4 _viewpoint;
+        MeshletStats _meshletStats;
+        float _pixelsPerUnit;
+        uint _pointBudget;
+        OctreeStats _pointStats;
+        bool _compactVertices;
+        float _frameBlend;
+        std::shared_ptr<UploadWorker> _uploadWorker;
 
         uint _width;
         uint _height;
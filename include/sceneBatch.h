@@ -0,0 +1,82 @@
+#ifndef SCENE_BATCH_H
+#define SCENE_BATCH_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <map>
+#include <vector>
+
+#include "geometry.h"
+
+namespace Tessellation
+{
+
+    //layout read by glMultiDrawElementsIndirect
+    struct DrawElementsIndirectCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    //std430 layout of one entry of BatchBlock
+    struct BatchObject
+    {
+        glm::mat4 model;
+        glm::vec4 color;
+    };
+
+    struct BatchStats
+    {
+        BatchStats(): objects(0), vertices(0), indices(0) {}
+
+        uint objects;
+        uint vertices;
+        uint indices;
+    };
+
+    //static meshes sub-allocated in shared buffers and drawn with one multi-draw
+    class SceneBatch
+    {
+    public:
+        SceneBatch();
+        ~SceneBatch();
+
+        static bool isSupported();
+
+        //takes every batchable geometry, the others keep being drawn on their own
+        BatchStats build(const std::vector<Geometry*> &geometries);
+        void clear();
+
+        //hides every object until it is submitted again
+        void begin();
+        //false when the geometry has to be drawn on its own this frame
+        bool submit(Geometry *geometry);
+        void draw();
+
+        bool isEmpty() {return _geometries.empty();}
+        //true once a batched geometry rewrote the data copied into the shared buffers
+        bool isStale();
+
+    private:
+        std::vector<Geometry*> _geometries;
+        std::vector<uint> _revisions;
+        std::map<Geometry*, uint> _objectIds;
+        std::vector<DrawElementsIndirectCommand> _commands;
+        std::vector<BatchObject> _objects;
+
+        GLuint _vertexArrayId;
+        GLuint _positionBuffer;
+        GLuint _textureBuffer;
+        GLuint _normalBuffer;
+        GLuint _indexBuffer;
+        GLuint _commandBuffer;
+        GLuint _objectBuffer;
+    };
+
+}
+
+#endif // SCENE_BATCH_H
@@ -1,34 +1,62 @@
 #ifndef SCENEPLAYER_H
 #define SCENEPLAYER_H
 
+#include <QElapsedTimer>
+#include <cmath>
+
 namespace Tessellation
 {
 
+    //plays a capture at its own rate whatever the display rate, positions are fractional frames from 1
     class ScenePlayer
     {
     public:
-        ScenePlayer(int frameCount = -1):
-            _play(false), _currentFrame(1), _frameCount(frameCount) {}
+        ScenePlayer(int frameCount = -1, float frameRate = 30.0f):
+            _play(false), _frameCount(frameCount), _frameRate(frameRate), _origin(0.0) {}
         ~ScenePlayer() {}
 
-        void playPause() {_play = !_play;}
+        void playPause()
+        {
+            //the clock restarts from the position shown when paused
+            _origin = getPosition() - 1.0;
+            _play = !_play;
+            if (_play)
+                _clock.start();
+        }
         bool isPaused() {return (_play==false);}
 
-        int getNextFrame()
+        void seek(int frame)
+        {
+            _origin = frame - 1;
+            if (_play)
+                _clock.start();
+        }
+
+        double getPosition()
+        {
+            double position = _origin;
+            if (_play)
+                position += _clock.elapsed() * _frameRate / 1000.0;
+            if (_frameCount > 0)
+                position = fmod(position, static_cast<double>(_frameCount));
+
+            return position + 1.0;
+        }
+
+        void setFrameRate(float frameRate)
         {
-            int nextFrame = _currentFrame++;
-            if (nextFrame > _frameCount)
-            {
-                nextFrame = 1;
-                _currentFrame = nextFrame;
-            }
-
-            return nextFrame;
+            _origin = getPosition() - 1.0;
+            _frameRate = frameRate;
+            if (_play)
+                _clock.start();
         }
+        float getFrameRate() {return _frameRate;}
 
     private:
-        int _currentFrame;
         int _frameCount;
+        float _frameRate;
+        double _origin;
+        QElapsedTimer _clock;
         bool _play;
     };
 
@@ -3,6 +3,7 @@
 
 #include "renderer.h"
 #include "scenePlayer.h"
+#include "renderThread.h"
 
 #include <QGLViewer/qglviewer.h>
 
@@ -26,11 +27,7 @@ namespace Tessellation
         void drawCube();
         void drawPlane();
         bool isReady();
-        void reset()
-        {
-            _scene->reset();
-            update();
-        }
+        void reset();
 
         void toggleTessellation(bool value);
         void toggleDisplacement(bool value);
@@ -43,30 +40,69 @@ namespace Tessellation
         void loadInputPoints(std::string path);
         void showInputPoints(bool value);
         void updateInputPoints();
+        void updateInputPointsField();
+        void bakeDisplacementMap();
+        void fitMesh();
+        void analyzeDeviation();
 
         void setInnerTL(int value);
         void setOuterTL(int value);
+        void setAdaptiveTL(bool adaptive, float pixelsPerEdge);
+        void updateTessellationImportance(bool enabled, uint budget);
+        void setSurfaceMode(int mode);
+        void exportTessellation(QString filename);
+        void setLevelOfDetail(bool enabled);
+        void buildLodChains();
+        void setSortedSubmission(bool sorted);
+        void setBatching(bool enabled);
+        void setFrustumCulling(bool enabled);
+        void setMeshletCulling(bool enabled);
+        void setCompactVertices(bool enabled);
+        void setPointBudget(uint budget);
         bool isTessellated() {return _isTessellated;}
 
         Scene* getScene() {return _scene.get();}
 
+        //render thread only, true while another frame is needed with the same snapshot
+        bool renderFrame(const FrameSnapshot &snapshot);
+        void saveSnapshot(const QString &filename);
+        void updateGL();
+
     protected:
         void init();
         void draw();
         void animate();
         void resizeGL(int width, int height);
+        void resizeEvent(QResizeEvent *event);
+        void paintEvent(QPaintEvent *event);
         void keyPressEvent(QKeyEvent* event);
 
     private:
+        void startRenderThread();
+        //runs the command where the context is current, at once without a render thread
+        void post(const RenderCommand &command);
+        void requestFrame();
+        void drawScene(const int currentFrame, const bool animation, const float frameBlend);
+        bool isAnimationShown();
+        void showMessage(QString message, int timeout);
+
         bool _isInitialized;
         bool _isWireframe;
         std::string _animationPath;
         int _currentFrame;
         bool _isTessellated;
+        bool _isDisplaced;
+        //the GL call count of the next frame goes to the status bar
+        bool _reportRenderStats;
+        float _frameBlend;
+        GLint _maxTessellationLevel;
+        //saved by the render thread after its next frame
+        QString _snapshotFilename;
 
         std::shared_ptr<Scene> _scene;
         std::shared_ptr<Renderer> _renderer;
         std::shared_ptr<ScenePlayer> _player;
+        std::shared_ptr<RenderThread> _renderThread;
 
         qglviewer::Vec _cameraOrigin;
         qglviewer::Vec _cameraDirection;
@@ -2,31 +2,78 @@
 #define SHADER_H
 
 #include <GL/glew.h>
+#include <QByteArray>
 #include <QHash>
 #include <QStringList>
 
+//GL_KHR_parallel_shader_compile, missing from older GLEW headers
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
 #include <string>
 #include <vector>
+#include <iostream>
 
 #include <glm/glm.hpp>
 
 namespace Tessellation
 {
 
+    //location resolved once when the program is linked, inactive (-1) when the variant does not use it
+    template <typename T>
+    class Uniform
+    {
+    public:
+        Uniform(): _location(-1) {}
+        explicit Uniform(GLint location): _location(location) {}
+
+        bool isActive() const {return _location >= 0;}
+        GLint getLocation() const {return _location;}
+        void set(const T &value) const;
+
+    private:
+        GLint _location;
+    };
+
+    template <> inline void Uniform<int>::set(const int &value) const {glUniform1i(_location, value);}
+    template <> inline void Uniform<bool>::set(const bool &value) const {glUniform1i(_location, value?1:0);}
+    template <> inline void Uniform<float>::set(const float &value) const {glUniform1f(_location, value);}
+    template <> inline void Uniform<glm::vec2>::set(const glm::vec2 &value) const {glUniform2f(_location, value.x, value.y);}
+    template <> inline void Uniform<glm::vec3>::set(const glm::vec3 &value) const {glUniform3f(_location, value.x, value.y, value.z);}
+    template <> inline void Uniform<glm::vec4>::set(const glm::vec4 &value) const {glUniform4f(_location, value.x, value.y, value.z, value.w);}
+    template <> inline void Uniform<glm::mat4>::set(const glm::mat4 &value) const {glUniformMatrix4fv(_location, 1, GL_FALSE, &value[0][0]);}
+
     class Shader
     {
     public:
-        Shader(QString value, QString filename, bool doTessellation = false);
+        Shader(QString value, QString filename, bool doTessellation = false, QStringList defines = QStringList());
         ~Shader();
 
         void initialize();
+        //issues the program binary or the compilation without waiting for it
+        void compile(QStringList attributes);
+        //completes what compile issued, compiling first if needed
         void load(QStringList attributes, QStringList uniforms);
+        //false while the driver is still compiling in the background
+        bool isReady();
+        bool isCached() {return _isCached;}
+        void setFeedbackVaryings(QStringList varyings) {_feedbackVaryings = varyings;}
         void bind();
 
         GLint getVariable(std::string strVariable);
         GLuint getProgramId() {return _programId;}
         uint getAttribute(QString name);
-        uint getUniform(QString name);
+        template <typename T>
+        Uniform<T> getUniform(QString name)
+        {
+            if (!_uniforms.contains(name))
+            {
+                std::clog << __FUNCTION__ << ": " << name.toStdString() << " is not registered in " << _value.toStdString() << ".\n";
+                return Uniform<T>();
+            }
+            return Uniform<T>(_uniforms.value(name));
+        }
         void transmitUniform(QString name, int i);
         void transmitUniform(QString name, float f);
         void transmitUniform(QString name, float f1, float f2);
@@ -40,38 +87,70 @@ namespace Tessellation
         void enable();
         void disable();
         QString getValue() {return _value;}
+        QStringList getDefines() {return _defines;}
 
-        void addDisplacement(bool value) {_doDisplacement = value;}
         bool doTessellation() {return _doTessellation;}
-        bool doDisplacement() {return _doDisplacement;}
         size_t getShaderCount() {return _shaderIds.size();}
 
     private:
         QString _value;
         QStringList _shaderFilenames;
+        QStringList _feedbackVaryings;
+        QStringList _defines;
         bool _doTessellation;
-        bool _doDisplacement;
 
         std::vector<GLuint> _shaderIds;
         GLuint _programId;
         GLuint _matrixId;
+        //a program linked from a binary of an earlier run
+        bool _isCached;
+        QString _cacheFilename;
 
         QHash<QString, uint> _attributes;
-        QHash<QString, uint> _uniforms;
+        QHash<QString, GLint> _uniforms;
 
         char* loadShaderFile(QString path);
+        QByteArray getSource(QString path);
+        QString getCacheFilename(const std::vector<QByteArray> &sources, QStringList attributes);
+        bool loadBinary();
+        void saveBinary();
+    };
+
+    //what is needed to compile any variant of a registered shader
+    struct ShaderSource
+    {
+        ShaderSource(): doTessellation(false) {}
+
+        QString path;
+        QStringList attributes;
+        QStringList uniforms;
+        QStringList feedbackVaryings;
+        bool doTessellation;
     };
 
     class Shaders
     {
     public:
-        static void clear() {_shaders.clear();}
-        static Shader* getShader(QString value);
-        static void addShader(QString value, QStringList attributes, QStringList uniforms, bool doTessellation = false);
+        static void clear();
+        //variants are compiled the first time a set of defines is asked for
+        static Shader* getShader(QString value, const QStringList &defines = QStringList());
+        static void addShader(QString value, QStringList attributes, QStringList uniforms, bool doTessellation = false,
+                              QStringList feedbackVaryings = QStringList());
+        static bool contains(QString value) {return _sources.contains(value);}
+        static bool doTessellation(QString value) {return _sources.value(value).doTessellation;}
+        static QString getKey(QString value, QStringList defines);
         static size_t getCount() {return _shaders.size();}
+        //starts a variant ahead of its first use, several of them compile at once with GL_KHR_parallel_shader_compile
+        static void preload(QString value, const QStringList &defines = QStringList());
+        //false while a preloaded variant is still linking, getShader would wait for it
+        static bool isReady(QString value, const QStringList &defines = QStringList());
+        static bool isBinaryCacheSupported();
+        static bool isParallelCompileSupported();
 
     private:
+        static QHash<QString, ShaderSource> _sources;
         static QHash<QString, Shader*> _shaders;
+        static QHash<QString, Shader*> _pending;
     };
 
 }
@@ -0,0 +1,67 @@
+#ifndef SPARSE_MATRIX_H
+#define SPARSE_MATRIX_H
+
+#include <vector>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct Triplet
+    {
+        Triplet() {}
+        Triplet(const uint row, const uint column, const float value):
+            row(row), column(column), value(value) {}
+
+        bool operator<(const Triplet &triplet) const
+        {
+            return (row < triplet.row) || (row == triplet.row && column < triplet.column);
+        }
+
+        uint row;
+        uint column;
+        float value;
+    };
+
+    //compressed sparse row matrix
+    class SparseMatrix
+    {
+    public:
+        SparseMatrix(): _rows(0) {}
+        ~SparseMatrix() {}
+
+        void build(const uint rows, std::vector<Triplet> &triplets);
+        void multiply(const std::vector<float> &x, std::vector<float> &y);
+        std::vector<float> getDiagonal();
+
+        uint getRows() {return _rows;}
+        uint getNonZeros() {return _values.size();}
+
+    private:
+        uint _rows;
+        std::vector<uint> _rowOffsets;
+        std::vector<uint> _columns;
+        std::vector<float> _values;
+    };
+
+    //Jacobi preconditioned conjugate gradient for symmetric positive definite systems
+    class ConjugateGradient
+    {
+    public:
+        ConjugateGradient(const uint maxIterations = 500, const float tolerance = 1e-6f):
+            _maxIterations(maxIterations), _tolerance(tolerance), _residual(0.0f) {}
+        ~ConjugateGradient() {}
+
+        uint solve(SparseMatrix &matrix, const std::vector<float> &b, std::vector<float> &x);
+        float getResidual() {return _residual;}
+
+    private:
+        uint _maxIterations;
+        float _tolerance;
+        float _residual;
+    };
+
+}
+
+#endif // SPARSE_MATRIX_H
@@ -0,0 +1,60 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace Tessellation
+{
+
+    //bounded ring between exactly one producer thread and one consumer thread, neither side ever blocks
+    template <typename T, size_t Capacity>
+    class SpscQueue
+    {
+    public:
+        SpscQueue(): _head(0), _tail(0) {}
+
+        //producer only, false when full
+        bool push(const T &value)
+        {
+            size_t tail = _tail.load(std::memory_order_relaxed);
+            size_t next = (tail + 1) % (Capacity + 1);
+            if (next == _head.load(std::memory_order_acquire))
+                return false;
+
+            _items[tail] = value;
+            _tail.store(next, std::memory_order_release);
+            return true;
+        }
+
+        //consumer only, false when empty
+        bool pop(T &value)
+        {
+            size_t head = _head.load(std::memory_order_relaxed);
+            if (head == _tail.load(std::memory_order_acquire))
+                return false;
+
+            //the slot is reset so that whatever the value holds is released by the consumer
+            value = std::move(_items[head]);
+            _items[head] = T();
+            _head.store((head + 1) % (Capacity + 1), std::memory_order_release);
+            return true;
+        }
+
+        bool isEmpty() const
+        {
+            return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+        }
+
+    private:
+        //one slot stays free to tell a full ring from an empty one
+        T _items[Capacity + 1];
+        //on separate cache lines, each index is written by one side only
+        alignas(64) std::atomic<size_t> _head;
+        alignas(64) std::atomic<size_t> _tail;
+    };
+
+}
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,58 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <GL/glew.h>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct StreamStats
+    {
+        StreamStats(): uploads(0), bytes(0), stalls(0) {}
+
+        uint uploads;
+        double bytes;
+        //regions the GPU was still reading when they came around again
+        uint stalls;
+    };
+
+    //ring of regions in one buffer, written in place while the GPU reads the others;
+    //persistently and coherently mapped with ARB_buffer_storage, mapped unsynchronized otherwise
+    class StreamBuffer
+    {
+    public:
+        static const uint REGION_COUNT = 3;
+
+        StreamBuffer(const GLsizeiptr regionSize);
+        ~StreamBuffer();
+
+        static bool isPersistentSupported() {return GLEW_ARB_buffer_storage;}
+
+        //next region, once the draws that read it last have completed
+        void* map();
+        void unmap();
+        //after the draws that read the current region
+        void fence();
+
+        GLuint getBufferId() {return _bufferId;}
+        GLintptr getOffset() {return _region * _regionSize;}
+        GLsizeiptr getRegionSize() {return _regionSize;}
+        StreamStats getStats() {return _stats;}
+
+    private:
+        void wait(const uint region);
+
+        GLuint _bufferId;
+        GLsizeiptr _regionSize;
+        bool _isPersistent;
+        char *_data;
+        GLsync _fences[REGION_COUNT];
+        uint _region;
+        StreamStats _stats;
+    };
+
+}
+
+#endif // STREAM_BUFFER_H
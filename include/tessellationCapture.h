@@ -0,0 +1,45 @@
+#ifndef TESSELLATION_CAPTURE_H
+#define TESSELLATION_CAPTURE_H
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "geometry.h"
+#include "meshExporter.h"
+
+namespace Tessellation
+{
+
+    struct CaptureStats
+    {
+        CaptureStats(): primitives(0), written(0), vertices(0), degenerates(0), milliseconds(0.0) {}
+
+        //GL_PRIMITIVES_GENERATED and GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN
+        uint primitives;
+        uint written;
+        //welded vertices and triangles collapsed by the weld
+        uint vertices;
+        uint degenerates;
+        double milliseconds;
+    };
+
+    //reads back what the tessellation pipeline generates (renderTLCapture program)
+    class TessellationCapture
+    {
+    public:
+        TessellationCapture(const float weldTolerance = 1e-6f): _weldTolerance(weldTolerance) {}
+        ~TessellationCapture() {}
+
+        CaptureStats capture(Geometry *geometry, const glm::mat4 &mvp, IndexedMesh &mesh);
+
+    private:
+        void weld(const std::vector<float> &data, const uint triangles, IndexedMesh &mesh, CaptureStats &stats);
+        void drawGeometry(Geometry *geometry, const glm::mat4 &mvp);
+
+        //relative to the diagonal of the captured bounding box
+        float _weldTolerance;
+    };
+
+}
+
+#endif // TESSELLATION_CAPTURE_H
@@ -0,0 +1,73 @@
+#ifndef TESSELLATION_IMPORTANCE_H
+#define TESSELLATION_IMPORTANCE_H
+
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+
+#include "meshTopology.h"
+#include "tessellator.h"
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    struct ImportanceStats
+    {
+        ImportanceStats(): patches(0), budget(0), primitives(0), maxPrimitives(0), scale(0.0f), milliseconds(0.0) {}
+
+        uint patches;
+        uint budget;
+        //estimated primitives at the chosen scale and with every patch at its full level
+        uint primitives;
+        uint maxPrimitives;
+        float scale;
+        double milliseconds;
+    };
+
+    //per-patch refinement weight from the dihedral angles and the displacement magnitude
+    class TessellationImportance
+    {
+    public:
+        TessellationImportance(const float curvatureAngle = 0.5f, const float displacementRatio = 1.0f);
+        ~TessellationImportance() {}
+
+        void compute(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                     const std::vector<glm::vec3> &displacements);
+        ImportanceStats fitBudget(const float innerLevel, const float outerLevel, const uint budget);
+        //same with the per-patch outer levels the control shader computes with ADAPTIVE
+        ImportanceStats fitBudget(const std::vector<glm::vec3> &adaptiveLevels, const uint budget);
+
+        //(outer 0, outer 1, outer 2, inner) in gl_TessLevelOuter order, indexed by gl_PrimitiveID
+        std::vector<glm::vec4>& getPatchImportance() {return _patchImportance;}
+        float getScale() {return _scale;}
+
+        //same rule as the control shader: flat patches stay at level one
+        static float getLevel(const float level, const float importance, const float scale)
+        {
+            return 1.0f + (level - 1.0f) * glm::clamp(importance * scale, 0.0f, 1.0f);
+        }
+        //outer levels of every patch from its projected edges, zero for patches the control shader culls
+        static std::vector<glm::vec3> getAdaptiveLevels(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                                                        const glm::mat4 &mvp, const glm::vec2 &viewport, const float pixelsPerEdge);
+
+    private:
+        uint getPrimitiveCount(const float innerLevel, const float outerLevel, const float scale);
+        uint getPrimitiveCount(const std::vector<glm::vec3> &adaptiveLevels, const float scale);
+        //largest scale within the budget, for either kind of levels
+        ImportanceStats fit(const std::function<uint(float)> &getCount, const uint budget);
+
+        //dihedral angle (radians) and displacement relative to the largest one that reach full importance
+        float _curvatureAngle;
+        float _displacementRatio;
+        float _scale;
+
+        MeshTopology _topology;
+        Tessellator _tessellator;
+        std::vector<glm::vec4> _patchImportance;
+    };
+
+}
+
+#endif // TESSELLATION_IMPORTANCE_H
@@ -0,0 +1,135 @@
+#ifndef TESSELLATOR_H
+#define TESSELLATOR_H
+
+#include <QString>
+#include <map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "meshExporter.h"
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    //same names and rules as the layout qualifiers of the evaluation shader
+    enum TessellationSpacing
+    {
+        EqualSpacing = 0,
+        FractionalOddSpacing,
+        FractionalEvenSpacing
+    };
+
+    struct TessellationLevels
+    {
+        TessellationLevels(const float inner = 1.0f, const float outer = 1.0f): inner(inner)
+        {
+            this->outer[0] = this->outer[1] = this->outer[2] = outer;
+        }
+        TessellationLevels(const float inner, const float outer0, const float outer1, const float outer2): inner(inner)
+        {
+            outer[0] = outer0;
+            outer[1] = outer1;
+            outer[2] = outer2;
+        }
+
+        bool operator<(const TessellationLevels &levels) const
+        {
+            if (inner != levels.inner)
+                return inner < levels.inner;
+            for (int e = 0; e < 3; e++)
+                if (outer[e] != levels.outer[e])
+                    return outer[e] < levels.outer[e];
+            return false;
+        }
+
+        float inner;
+        //outer[e] subdivides the edge opposite to corner e (gl_TessLevelOuter[e])
+        float outer[3];
+    };
+
+    enum PatternLocation
+    {
+        PatternCorner = 0,
+        PatternEdge,
+        PatternInterior
+    };
+
+    struct PatternVertex
+    {
+        PatternVertex(glm::vec3 barycentric, uint location, uint element = 0, uint step = 0):
+            barycentric(barycentric), location(location), element(element), step(step) {}
+
+        //weights of the patch corners (gl_TessCoord)
+        glm::vec3 barycentric;
+        uint location;
+        //corner or edge index
+        uint element;
+        //segment boundary along edge e, counted from corner (e+1)%3
+        uint step;
+    };
+
+    struct TessellationPattern
+    {
+        TessellationPattern(): interiorCount(0)
+        {
+            segments[0] = segments[1] = segments[2] = 0;
+        }
+
+        uint getTriangleCount() const {return indices.size() / 3;}
+
+        std::vector<PatternVertex> vertices;
+        std::vector<uint> indices;
+        uint segments[3];
+        uint interiorCount;
+    };
+
+    struct TessellationStats
+    {
+        TessellationStats(): patches(0), vertices(0), triangles(0), sharedEdges(0), crackedEdges(0), patterns(0), milliseconds(0.0) {}
+
+        uint patches;
+        uint vertices;
+        uint triangles;
+        uint sharedEdges;
+        //edges whose two patches disagree on the segment count (would crack on the GPU too)
+        uint crackedEdges;
+        uint patterns;
+        double milliseconds;
+    };
+
+    //CPU reference of the fixed-function triangle tessellator
+    class Tessellator
+    {
+    public:
+        Tessellator(const TessellationSpacing spacing = EqualSpacing, const float maxLevel = 64.0f);
+        ~Tessellator() {}
+
+        void setSpacing(const TessellationSpacing spacing) {_spacing = spacing; _patterns.clear();}
+        TessellationSpacing getSpacing() {return _spacing;}
+        static bool getSpacing(QString name, TessellationSpacing &spacing);
+
+        const TessellationPattern& getPattern(const TessellationLevels &levels);
+        uint getPrimitiveCount(const TessellationLevels &levels);
+        void clearCache() {_patterns.clear();}
+
+        //levels holds either one entry for every patch or one entry per patch
+        TessellationStats tessellate(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals,
+                                     const std::vector<glm::vec2> &textureCoordinates, const std::vector<uint> &indices,
+                                     const std::vector<TessellationLevels> &levels, IndexedMesh &mesh);
+
+    private:
+        bool getSegments(const TessellationLevels &levels, float effective[4], uint segments[4]);
+        uint getSegments(const float level, float &effective);
+        void getParameters(const float level, const uint segments, std::vector<float> &parameters);
+        void buildPattern(const TessellationLevels &levels, TessellationPattern &pattern);
+
+        TessellationSpacing _spacing;
+        float _maxLevel;
+        std::map<TessellationLevels, TessellationPattern> _patterns;
+    };
+
+}
+
+#endif // TESSELLATOR_H
@@ -0,0 +1,82 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <memory>
+
+namespace Tessellation
+{
+
+    typedef unsigned int uint;
+
+    //binding points of the blocks declared in the shaders (see Shader::load)
+    static const GLuint FRAME_BLOCK_BINDING = 0;
+    static const GLuint OBJECT_BLOCK_BINDING = 1;
+    //shader storage block of the batched variant (see SceneBatch)
+    static const GLuint BATCH_BLOCK_BINDING = 2;
+
+    //std140 layout of FrameBlock, written once per frame
+    struct FrameUniforms
+    {
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::vec4 viewport;
+        glm::vec4 lightPosition;
+    };
+
+    //std140 layout of ObjectBlock, written before every draw
+    struct ObjectUniforms
+    {
+        glm::mat4 model;
+        glm::mat4 mvp;
+        glm::vec4 color;
+        GLint innerTL;
+        GLint outerTL;
+        float pixelsPerEdge;
+        float importanceScale;
+        float phongShape;
+        float frameBlend;
+        float padding[2];
+        //dequantization of compact vertices, w of the scale for the deltas
+        glm::vec4 positionOffset;
+        glm::vec4 positionScale;
+    };
+
+    //ring of aligned blocks bound by range, the buffer is orphaned when the ring wraps
+    class UniformBuffer
+    {
+    public:
+        UniformBuffer(const GLuint binding, const GLsizeiptr blockSize, const uint capacity);
+        ~UniformBuffer();
+
+        void push(const void *data);
+
+    private:
+        void orphan();
+
+        GLuint _binding;
+        GLuint _bufferId;
+        GLsizeiptr _blockSize;
+        GLsizeiptr _stride;
+        uint _capacity;
+        uint _slot;
+    };
+
+    class UniformBlocks
+    {
+    public:
+        static void clear();
+        static void updateFrame(const FrameUniforms &frame);
+        static void updateObject(const ObjectUniforms &object);
+
+    private:
+        static std::shared_ptr<UniformBuffer> _frame;
+        static std::shared_ptr<UniformBuffer> _objects;
+    };
+
+}
+
+#endif // UNIFORM_BUFFER_H
@@ -0,0 +1,70 @@
+#ifndef UPLOAD_WORKER_H
+#define UPLOAD_WORKER_H
+
+#include <GL/glew.h>
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+class QOpenGLContext;
+class QOffscreenSurface;
+
+namespace Tessellation
+{
+
+    class Geometry;
+
+    //everything about a geometry that needs no vertex array: parsing, reordering, caches;
+    //runs on the worker and returns the geometry whose buffers are created next, or NULL
+    typedef std::function<Geometry*()> UploadJob;
+
+    //buffers filled on the worker's context, usable by the viewer once the fence has signaled
+    struct Upload
+    {
+        Geometry *geometry;
+        GLsync fence;
+    };
+
+    //thread owning a second context that shares objects with the viewer's; vertex arrays are not
+    //shared between contexts, so the render thread records them once an upload is ready
+    class UploadWorker : public QThread
+    {
+    Q_OBJECT
+    public:
+        //created on the GUI thread, which the context and the offscreen surface have to be
+        UploadWorker(QOpenGLContext *shareContext);
+        ~UploadWorker();
+
+        bool isValid() {return _isValid;}
+
+        void upload(const UploadJob &job);
+        //ready uploads, in submission order, without waiting on any fence
+        std::vector<Geometry*> takeReady();
+        bool isPending();
+
+    signals:
+        void uploaded();
+
+    protected:
+        void run();
+
+    private:
+        QOpenGLContext *_context;
+        QOffscreenSurface *_surface;
+        bool _isValid;
+
+        QMutex _mutex;
+        QWaitCondition _condition;
+        std::deque<UploadJob> _queue;
+        std::deque<Upload> _ready;
+        bool _isStopping;
+    };
+
+}
+
+#endif // UPLOAD_WORKER_H
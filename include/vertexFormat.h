@@ -0,0 +1,54 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "bounds.h"
+
+namespace Tessellation
+{
+
+    //interleaved vertex of the compact layout, dequantized by the vertex stage (COMPACT_VERTEX in render.vs)
+    struct CompactVertex
+    {
+        //unorm16 within the object box
+        GLushort position[3];
+        GLushort padding;
+        //half floats
+        GLushort uv[2];
+        //octahedral mapping, snorm16
+        GLshort normal[2];
+        //snorm 10:10:10:2, relative to the largest component
+        GLuint delta;
+    };
+
+    //object space position = offset + position * scale, delta * scale.w
+    struct VertexQuantization
+    {
+        VertexQuantization(): offset(0.0f), scale(1.0f) {}
+
+        glm::vec4 offset;
+        glm::vec4 scale;
+    };
+
+    class VertexFormat
+    {
+    public:
+        static VertexQuantization getQuantization(const BoundingBox &box, const std::vector<glm::vec3> &displacements);
+        //attributes that are missing or not one per position are packed as zero
+        static std::vector<CompactVertex> pack(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals,
+                                               const std::vector<glm::vec2> &textureCoordinates, const std::vector<glm::vec3> &displacements,
+                                               const VertexQuantization &quantization);
+
+        static glm::vec2 encodeOctahedral(const glm::vec3 &normal);
+        static GLushort toHalf(const float value);
+        static GLuint toSnorm1010102(const glm::vec3 &value);
+        //position, normal, delta and uv in the separate float buffers
+        static uint getFloatVertexSize() {return 3*sizeof(glm::vec3) + sizeof(glm::vec2);}
+    };
+
+}
+
+#endif // VERTEX_FORMAT_H
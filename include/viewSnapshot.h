@@ -0,0 +1,39 @@
+#ifndef VIEW_SNAPSHOT_H
+#define VIEW_SNAPSHOT_H
+
+#include <glm/glm.hpp>
+
+namespace qglviewer
+{
+    class Camera;
+}
+
+namespace Tessellation
+{
+
+    //what a frame reads from the camera, copied on the thread that owns it
+    struct ViewSnapshot
+    {
+        ViewSnapshot();
+        ViewSnapshot(qglviewer::Camera *camera);
+
+        //object units covered by a pixel at a point
+        float getUnitsPerPixel(const glm::vec3 &point) const;
+        //distance in front of the camera, along the view direction
+        float getDepth(const glm::vec3 &point) const;
+
+        glm::mat4 view;
+        glm::mat4 projection;
+        glm::mat4 viewProjection;
+        glm::vec3 position;
+        glm::vec3 viewDirection;
+        bool isPerspective;
+        float fieldOfView;
+        float orthoHalfHeight;
+        glm::vec2 screenSize;
+        double frustumPlanes[6][4];
+    };
+
+}
+
+#endif // VIEW_SNAPSHOT_H
@@ -2,21 +2,180 @@
 
 layout(vertices = 3) out;
 in vec4 vertexPosition[];
+in vec2 vertexUV[];
+in vec4 vertexColor[];
+in vec3 vertexNormal[];
 out vec4 controlPosition[];
+out vec2 controlUV[];
+out vec4 controlColor[];
+out vec3 controlNormal[];
 
-uniform int innerTL;
-uniform int outerTL;
+#ifdef SURFACE_PN
+//cubic Bezier control points and quadratic normal coefficients of the PN triangle
+patch out vec3 b210;
+patch out vec3 b120;
+patch out vec3 b021;
+patch out vec3 b012;
+patch out vec3 b102;
+patch out vec3 b201;
+patch out vec3 b111;
+patch out vec3 n110;
+patch out vec3 n011;
+patch out vec3 n101;
+#endif
+
+layout(std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewport;
+    vec4 lightPosition;
+};
+
+layout(std140) uniform ObjectBlock
+{
+    mat4 model;
+    mat4 mvp;
+    vec4 color;
+    int innerTL;
+    int outerTL;
+    float pixelsPerEdge;
+    float importanceScale;
+    float phongShape;
+    float frameBlend;
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+#ifdef IMPORTANCE
+uniform samplerBuffer importance;
+#endif
 
 #define INV_ID gl_InvocationID
+#define MAX_TL 64.0
+
+#ifdef ADAPTIVE
+//projected length of an edge over the target, computed identically from both patches sharing it
+float getEdgeLevel(vec4 a, vec4 b)
+{
+    if (a.w <= 0.0 || b.w <= 0.0)
+        return MAX_TL;
+
+    precise vec2 screenA = 0.5 * viewport.xy * (a.xy / a.w);
+    precise vec2 screenB = 0.5 * viewport.xy * (b.xy / b.w);
+    precise float level = distance(screenA, screenB) / pixelsPerEdge;
+    return clamp(level, 1.0, MAX_TL);
+}
+
+//all three corners outside the same clip plane, with a margin for the displacement
+bool isCulled(vec4 p0, vec4 p1, vec4 p2)
+{
+    vec3 w = 1.1 * vec3(p0.w, p1.w, p2.w);
+    vec3 x = vec3(p0.x, p1.x, p2.x);
+    vec3 y = vec3(p0.y, p1.y, p2.y);
+    vec3 z = vec3(p0.z, p1.z, p2.z);
+
+    return all(lessThan(x, -w)) || all(greaterThan(x, w)) ||
+           all(lessThan(y, -w)) || all(greaterThan(y, w)) ||
+           all(lessThan(z, -w)) || all(greaterThan(z, w));
+}
+#endif
+
+#ifdef SURFACE_PN
+//edge control point next to a, projected onto the tangent plane at a
+vec3 getEdgePoint(vec3 a, vec3 b, vec3 normal)
+{
+    return (2.0 * a + b - dot(b - a, normal) * normal) / 3.0;
+}
+
+//normal at the middle of an edge, reflected across the plane perpendicular to the edge
+vec3 getEdgeNormal(vec3 a, vec3 b, vec3 normalA, vec3 normalB)
+{
+    vec3 edge = b - a;
+    float length2 = dot(edge, edge);
+    float v = (length2 > 0.0) ? 2.0 * dot(edge, normalA + normalB) / length2 : 0.0;
+    return normalize(normalA + normalB - v * edge);
+}
+
+void computePNTriangle()
+{
+    vec3 p0 = vertexPosition[0].xyz;
+    vec3 p1 = vertexPosition[1].xyz;
+    vec3 p2 = vertexPosition[2].xyz;
+    vec3 normal0 = normalize(vertexNormal[0]);
+    vec3 normal1 = normalize(vertexNormal[1]);
+    vec3 normal2 = normalize(vertexNormal[2]);
+
+    b210 = getEdgePoint(p0, p1, normal0);
+    b120 = getEdgePoint(p1, p0, normal1);
+    b021 = getEdgePoint(p1, p2, normal1);
+    b012 = getEdgePoint(p2, p1, normal2);
+    b102 = getEdgePoint(p2, p0, normal2);
+    b201 = getEdgePoint(p0, p2, normal0);
+
+    vec3 e = (b210 + b120 + b021 + b012 + b102 + b201) / 6.0;
+    vec3 v = (p0 + p1 + p2) / 3.0;
+    b111 = e + 0.5 * (e - v);
+
+    n110 = getEdgeNormal(p0, p1, normal0, normal1);
+    n011 = getEdgeNormal(p1, p2, normal1, normal2);
+    n101 = getEdgeNormal(p2, p0, normal2, normal0);
+}
+#endif
+
+#ifdef IMPORTANCE
+//flat, undisplaced patches stay at level one
+float getImportanceLevel(float level, float weight)
+{
+    return 1.0 + (level - 1.0) * clamp(weight * importanceScale, 0.0, 1.0);
+}
+#endif
 
 void main()
 {
     controlPosition[INV_ID] = vertexPosition[INV_ID];
+    controlUV[INV_ID] = vertexUV[INV_ID];
+    controlColor[INV_ID] = vertexColor[INV_ID];
+    controlNormal[INV_ID] = vertexNormal[INV_ID];
     if (INV_ID == 0)
     {
-        gl_TessLevelInner[0] = innerTL;
-        gl_TessLevelOuter[0] = outerTL;
-        gl_TessLevelOuter[1] = outerTL;
-        gl_TessLevelOuter[2] = outerTL;
+#ifdef SURFACE_PN
+        computePNTriangle();
+#endif
+
+        vec3 outer = vec3(outerTL);
+        float inner = innerTL;
+#ifdef ADAPTIVE
+        precise vec4 p0 = mvp * vertexPosition[0];
+        precise vec4 p1 = mvp * vertexPosition[1];
+        precise vec4 p2 = mvp * vertexPosition[2];
+
+        if (isCulled(p0, p1, p2))
+            outer = vec3(0.0);
+        else
+        {
+            //outer level e belongs to the edge opposite to corner e
+            outer = vec3(getEdgeLevel(p1, p2), getEdgeLevel(p2, p0), getEdgeLevel(p0, p1));
+        }
+#endif
+
+#ifdef IMPORTANCE
+        if (outer.x > 0.0)
+        {
+            vec4 weights = texelFetch(importance, gl_PrimitiveID);
+            outer = vec3(getImportanceLevel(outer.x, weights.x), getImportanceLevel(outer.y, weights.y), getImportanceLevel(outer.z, weights.z));
+            inner = getImportanceLevel(inner, weights.w);
+        }
+#endif
+
+#ifdef ADAPTIVE
+        inner = max(outer.x, max(outer.y, outer.z));
+#endif
+
+        gl_TessLevelInner[0] = inner;
+        gl_TessLevelOuter[0] = outer.x;
+        gl_TessLevelOuter[1] = outer.y;
+        gl_TessLevelOuter[2] = outer.z;
     }
 }
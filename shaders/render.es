@@ -2,17 +2,89 @@
 
 layout(triangles, equal_spacing, cw) in;
 in vec4 controlPosition[];
+in vec2 controlUV[];
+in vec4 controlColor[];
+in vec3 controlNormal[];
 out vec4 evaluationPosition;
+out vec3 evaluationNormal;
+out vec2 evaluationUV;
 out vec3 patchDistance;
+out vec4 vertexColor;
 
-uniform mat4 mvp;
+#ifdef SURFACE_PN
+patch in vec3 b210;
+patch in vec3 b120;
+patch in vec3 b021;
+patch in vec3 b012;
+patch in vec3 b102;
+patch in vec3 b201;
+patch in vec3 b111;
+patch in vec3 n110;
+patch in vec3 n011;
+patch in vec3 n101;
+#endif
+
+layout(std140) uniform ObjectBlock
+{
+    mat4 model;
+    mat4 mvp;
+    vec4 color;
+    int innerTL;
+    int outerTL;
+    float pixelsPerEdge;
+    float importanceScale;
+    float phongShape;
+    float frameBlend;
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+#ifdef DISPLACEMENT_MAP
+uniform sampler2D displacementMap;
+#endif
+
+#ifdef SURFACE_PHONG
+//projection of a point onto the tangent plane of a corner
+vec3 getTangentProjection(vec3 point, int corner)
+{
+    vec3 normal = normalize(controlNormal[corner]);
+    return point - dot(point - controlPosition[corner].xyz, normal) * normal;
+}
+#endif
 
 void main()
 {
-    vec4 p0 = gl_TessCoord.x * controlPosition[0];
-    vec4 p1 = gl_TessCoord.y * controlPosition[1];
-    vec4 p2 = gl_TessCoord.z * controlPosition[2];
+    float u = gl_TessCoord.x;
+    float v = gl_TessCoord.y;
+    float w = gl_TessCoord.z;
+
+    vec3 p0 = controlPosition[0].xyz;
+    vec3 p1 = controlPosition[1].xyz;
+    vec3 p2 = controlPosition[2].xyz;
+    vec2 uv = u * controlUV[0] + v * controlUV[1] + w * controlUV[2];
+
+    vec3 position = u * p0 + v * p1 + w * p2;
+    vec3 normal = u * controlNormal[0] + v * controlNormal[1] + w * controlNormal[2];
+#if defined(SURFACE_PN)
+    position = p0*u*u*u + p1*v*v*v + p2*w*w*w
+             + 3.0*(b210*u*u*v + b120*u*v*v + b201*u*u*w + b021*v*v*w + b102*u*w*w + b012*v*w*w)
+             + 6.0*b111*u*v*w;
+    normal = controlNormal[0]*u*u + controlNormal[1]*v*v + controlNormal[2]*w*w
+           + n110*u*v + n011*v*w + n101*u*w;
+#elif defined(SURFACE_PHONG)
+    vec3 projected = u * getTangentProjection(position, 0) + v * getTangentProjection(position, 1) + w * getTangentProjection(position, 2);
+    position = mix(position, projected, phongShape);
+#endif
+
+    //displace every generated vertex in object space, then project
+    evaluationPosition = vec4(position, 1.0);
+#ifdef DISPLACEMENT_MAP
+    evaluationPosition.xyz += texture(displacementMap, uv).xyz;
+#endif
+    evaluationNormal = normalize(normal);
+    evaluationUV = uv;
+
     patchDistance = gl_TessCoord;
-    evaluationPosition = normalize(p0 + p1 + p2);
-    gl_Position = evaluationPosition;
+    vertexColor = controlColor[0];
+    gl_Position = mvp * evaluationPosition;
 }
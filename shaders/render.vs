@@ -1,33 +1,144 @@
 #version 400
+#ifdef BATCHED
+#extension GL_ARB_shader_storage_buffer_object : require
+#extension GL_ARB_shader_draw_parameters : require
+#endif
 
+#ifdef COMPACT_VERTEX
+//one interleaved stream of normalized integers and halves (see CompactVertex)
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 uv;
+layout (location = 2) in vec2 normal;
+layout (location = 3) in vec4 delta;
+#else
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec2 uv;
 layout (location = 2) in vec3 normal;
 layout (location = 3) in vec3 delta;
+#endif
+layout (location = 4) in vec4 vertexRGBA;
+#ifdef POINT_LOD
+layout (location = 5) in float pointSpacing;
+#endif
+#ifdef FRAME_BLEND
+//the next captured frame of the same topology (see Geometry::linkNextFrame)
+layout (location = 6) in vec3 nextPosition;
+layout (location = 7) in vec3 nextNormal;
+#endif
 
 out vec4 vertexPosition;
+out vec2 vertexUV;
+out vec3 vertexNormal;
 out vec4 vertexColor;
 
 vec4 vertexTransform;
 
-uniform mat4 mvp;
-uniform bool doTessellation;
-uniform bool doDisplacement;
-uniform vec4 color;
+//per-draw values, filled by Geometry::draw (see uniformBuffer.h)
+layout(std140) uniform ObjectBlock
+{
+    mat4 model;
+    mat4 mvp;
+    vec4 color;
+    int innerTL;
+    int outerTL;
+    float pixelsPerEdge;
+    float importanceScale;
+    float phongShape;
+    float frameBlend;
+    //dequantization of COMPACT_VERTEX, w of the scale for the deltas
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+layout(std140) uniform FrameBlock
+{
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewport;
+    vec4 lightPosition;
+};
+
+#ifdef BATCHED
+//one entry per command of the multi-draw (see SceneBatch)
+struct BatchObject
+{
+    mat4 model;
+    vec4 color;
+};
 
+layout(std430) buffer BatchBlock
+{
+    BatchObject objects[];
+};
+#endif
+
+#ifdef DISPLACEMENT_MAP
+uniform sampler2D displacementMap;
+#endif
+
+#ifdef COMPACT_VERTEX
+//octahedral mapping, the lower hemisphere is folded over the diagonals
+vec3 decodeNormal(vec2 encoded)
+{
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+#endif
+
+//features are selected by the defines inserted after #version (see Geometry::getShaderDefines)
 void main()
 {
-    vertexTransform = vec4(position, 1.0f);
+#ifdef COMPACT_VERTEX
+    vec3 objectPosition = positionOffset.xyz + position * positionScale.xyz;
+    vec3 objectNormal = decodeNormal(normal);
+    vec3 objectDelta = delta.xyz * positionScale.w;
+#else
+    vec3 objectPosition = position;
+    vec3 objectNormal = normal;
+    vec3 objectDelta = delta;
+#endif
+
+#ifdef FRAME_BLEND
+    objectPosition = mix(objectPosition, nextPosition, frameBlend);
+    vec3 blendedNormal = mix(objectNormal, nextNormal, frameBlend);
+    objectNormal = (dot(blendedNormal, blendedNormal) > 0.0) ? normalize(blendedNormal) : blendedNormal;
+#endif
+
+    vertexTransform = vec4(objectPosition, 1.0f);
 
-    //apply displacement if there is
-    if (doDisplacement)
-        vertexTransform += vec4(delta, 1.0f);
+#ifdef DISPLACEMENT
+    vertexTransform += vec4(objectDelta, 0.0f);
+#endif
 
-    //apply tessellation if activated
-    if (doTessellation)
-        vertexPosition = mvp * vertexTransform;
-    else
-        gl_Position = mvp * vertexTransform;
+#ifdef TESSELLATION
+    //the evaluation stage displaces and projects
+    vertexPosition = vertexTransform;
+    vertexUV = uv;
+    vertexNormal = objectNormal;
+#else
+#ifdef DISPLACEMENT_MAP
+    vertexTransform.xyz += texture(displacementMap, uv).xyz;
+#endif
+#ifdef BATCHED
+    gl_Position = viewProjection * objects[gl_DrawIDARB].model * vertexTransform;
+#else
+    gl_Position = mvp * vertexTransform;
+#endif
+#ifdef POINT_LOD
+    //spacing of the octree node holding the point, in pixels at its depth (see PointOctree)
+    float pixelsPerUnit = 0.5 * viewport.y * projection[1][1] * length(model[0].xyz);
+    gl_PointSize = clamp(pointSpacing * pixelsPerUnit / gl_Position.w, 1.0, 64.0);
+#endif
+#endif
 
+#if defined(VERTEX_COLOR)
+    vertexColor = vertexRGBA;
+#elif defined(BATCHED)
+    vertexColor = objects[gl_DrawIDARB].color;
+#else
     vertexColor = color;
+#endif
 }
@@ -0,0 +1,117 @@
+#include "bounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tessellation
+{
+
+    BoundingBox::BoundingBox(const std::vector<glm::vec3> &points):
+        min(std::numeric_limits<float>::max()),
+        max(-std::numeric_limits<float>::max())
+    {
+        for (size_t i = 0; i < points.size(); i++)
+            extend(points[i]);
+    }
+
+    BoundingBox BoundingBox::transform(const glm::mat4 &matrix) const
+    {
+        BoundingBox box;
+        if (isEmpty())
+            return box;
+
+        glm::vec3 center = glm::vec3(matrix * glm::vec4(getCenter(), 1.0f));
+        glm::vec3 extent = getExtent();
+        glm::vec3 worldExtent(0.0f);
+        for (int c = 0; c < 3; c++)
+            for (int r = 0; r < 3; r++)
+                worldExtent[r] += fabs(matrix[c][r]) * extent[c];
+
+        box.min = center - worldExtent;
+        box.max = center + worldExtent;
+        return box;
+    }
+
+    glm::vec4 computeBoundingSphere(const std::vector<glm::vec3> &points, const BoundingBox &box)
+    {
+        if (box.isEmpty())
+            return glm::vec4(0.0f);
+
+        glm::vec3 center = box.getCenter();
+        float radius = 0.0f;
+        for (size_t i = 0; i < points.size(); i++)
+            radius = std::max(radius, glm::length(points[i] - center));
+
+        return glm::vec4(center, radius);
+    }
+
+    glm::vec4 transformBoundingSphere(const glm::vec4 &sphere, const glm::mat4 &matrix)
+    {
+        //the largest axis scale keeps the sphere conservative under non uniform scaling
+        float scale = std::max(glm::length(glm::vec3(matrix[0])), std::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+        glm::vec4 center = matrix * glm::vec4(glm::vec3(sphere), 1.0f);
+
+        return glm::vec4(glm::vec3(center), sphere.w * scale);
+    }
+
+    Frustum::Frustum()
+    {
+        //nothing is outside until the planes are set
+        for (int i = 0; i < 6; i++)
+            _planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    void Frustum::setPlanes(const double coefficients[6][4])
+    {
+        for (int i = 0; i < 6; i++)
+            _planes[i] = glm::vec4(coefficients[i][0], coefficients[i][1], coefficients[i][2], coefficients[i][3]);
+    }
+
+    Frustum Frustum::transform(const glm::mat4 &matrix) const
+    {
+        //planes transform by the transpose, as (n, -d) dotted with homogeneous points
+        Frustum frustum;
+        glm::mat4 transposed = glm::transpose(matrix);
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec4 plane = transposed * glm::vec4(glm::vec3(_planes[i]), -_planes[i].w);
+            float length = glm::length(glm::vec3(plane));
+            if (length > 0.0f)
+                frustum._planes[i] = glm::vec4(glm::vec3(plane), -plane.w) / length;
+        }
+
+        return frustum;
+    }
+
+    bool Frustum::isOutside(const glm::vec4 &sphere) const
+    {
+        glm::vec3 center(sphere);
+        for (int i = 0; i < 6; i++)
+        {
+            if (glm::dot(glm::vec3(_planes[i]), center) - _planes[i].w > sphere.w)
+                return true;
+        }
+
+        return false;
+    }
+
+    bool Frustum::isOutside(const BoundingBox &box) const
+    {
+        if (box.isEmpty())
+            return false;
+
+        //outside as soon as the corner farthest inside a plane is still in front of it
+        glm::vec3 center = box.getCenter();
+        glm::vec3 extent = box.getExtent();
+        for (int i = 0; i < 6; i++)
+        {
+            glm::vec3 normal(_planes[i]);
+            float radius = glm::dot(glm::abs(normal), extent);
+            if (glm::dot(normal, center) - radius > _planes[i].w)
+                return true;
+        }
+
+        return false;
+    }
+
+}
@@ -0,0 +1,161 @@
+#include "bvh.h"
+#include "geometry.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    BVH::BVH(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        build(positions, indices);
+    }
+
+    void BVH::build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        _nodes.clear();
+        _triangleIds.clear();
+        _triangles.clear();
+
+        uint triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        std::vector<glm::vec3> centroids(triangleCount);
+        _triangles.resize(triangleCount * 3);
+        _triangleIds.resize(triangleCount);
+        for (uint t = 0; t < triangleCount; t++)
+        {
+            for (int v = 0; v < 3; v++)
+                _triangles[t*3+v] = positions[indices[t*3+v]];
+            centroids[t] = (_triangles[t*3] + _triangles[t*3+1] + _triangles[t*3+2]) / 3.0f;
+            _triangleIds[t] = t;
+        }
+
+        _nodes.reserve(2 * triangleCount / _leafSize + 1);
+        subdivide(0, triangleCount, centroids);
+
+        std::clog << __FUNCTION__ << ": " << _nodes.size() << " nodes for " << triangleCount << " triangles.\n";
+    }
+
+    uint BVH::subdivide(const uint first, const uint count, std::vector<glm::vec3> &centroids)
+    {
+        uint nodeIndex = _nodes.size();
+        _nodes.push_back(Node());
+
+        glm::vec3 min(std::numeric_limits<float>::max());
+        glm::vec3 max(-std::numeric_limits<float>::max());
+        glm::vec3 centroidMin = min;
+        glm::vec3 centroidMax = max;
+        for (uint i = first; i < first + count; i++)
+        {
+            uint t = _triangleIds[i];
+            for (int v = 0; v < 3; v++)
+            {
+                min = glm::min(min, _triangles[t*3+v]);
+                max = glm::max(max, _triangles[t*3+v]);
+            }
+            centroidMin = glm::min(centroidMin, centroids[t]);
+            centroidMax = glm::max(centroidMax, centroids[t]);
+        }
+
+        _nodes[nodeIndex].min = min;
+        _nodes[nodeIndex].max = max;
+        _nodes[nodeIndex].first = first;
+        _nodes[nodeIndex].count = count;
+        _nodes[nodeIndex].right = 0;
+
+        if (count <= _leafSize)
+            return nodeIndex;
+
+        //median split on the longest centroid axis
+        glm::vec3 extent = centroidMax - centroidMin;
+        int axis = 0;
+        if (extent.y > extent.x)
+            axis = 1;
+        if (extent.z > extent[axis])
+            axis = 2;
+
+        uint middle = first + count/2;
+        std::nth_element(_triangleIds.begin() + first, _triangleIds.begin() + middle, _triangleIds.begin() + first + count,
+                         [&centroids, axis](uint a, uint b) {return centroids[a][axis] < centroids[b][axis];});
+
+        _nodes[nodeIndex].count = 0;
+        subdivide(first, middle - first, centroids);
+        uint right = subdivide(middle, first + count - middle, centroids);
+        _nodes[nodeIndex].right = right;
+
+        return nodeIndex;
+    }
+
+    float BVH::getBoxDistance(const Node &node, const glm::vec3 &point)
+    {
+        glm::vec3 d = glm::max(glm::max(node.min - point, point - node.max), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+
+    bool BVH::getClosest(const glm::vec3 &point, ClosestHit &hit)
+    {
+        if (_nodes.empty())
+            return false;
+
+        //squared distances during the traversal
+        float best = (hit.triangle == -1) ? std::numeric_limits<float>::max() : hit.distance * hit.distance;
+        uint stack[64];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+
+        while (stackSize > 0)
+        {
+            const Node &node = _nodes[stack[--stackSize]];
+            if (getBoxDistance(node, point) >= best)
+                continue;
+
+            if (node.count > 0)
+            {
+                for (uint i = node.first; i < node.first + node.count; i++)
+                {
+                    uint t = _triangleIds[i];
+                    glm::vec3 barycentric;
+                    glm::vec3 closest = GeometryTools::getClosestPoint(&_triangles[t*3], point, barycentric);
+                    hit.triangleTests++;
+
+                    glm::vec3 d = closest - point;
+                    float distance = glm::dot(d, d);
+                    if (distance < best)
+                    {
+                        best = distance;
+                        hit.triangle = t;
+                        hit.position = closest;
+                        hit.barycentric = barycentric;
+                    }
+                }
+            }
+            else
+            {
+                uint left = (&node - &_nodes[0]) + 1;
+                float leftDistance = getBoxDistance(_nodes[left], point);
+                float rightDistance = getBoxDistance(_nodes[node.right], point);
+
+                //visit the nearest child first
+                if (leftDistance < rightDistance)
+                {
+                    stack[stackSize++] = node.right;
+                    stack[stackSize++] = left;
+                }
+                else
+                {
+                    stack[stackSize++] = left;
+                    stack[stackSize++] = node.right;
+                }
+            }
+        }
+
+        if (hit.triangle != -1)
+            hit.distance = sqrt(best);
+
+        return hit.triangle != -1;
+    }
+
+}
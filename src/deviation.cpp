@@ -0,0 +1,177 @@
+#include "deviation.h"
+#include "geometry.h"
+#include "bvh.h"
+#include "kdTree.h"
+#include "meshTopology.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <limits>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    std::vector<DeviationReport> DeviationAnalysis::analyze(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                                                           const std::vector<std::vector<glm::vec3> > &clouds)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        //the soup repeats a vertex at every corner, the reports count welded ones
+        MeshTopology topology(positions, indices);
+        std::vector<glm::vec3> &vertices = topology.getVertices();
+
+        //every cloud is measured against the same hierarchy, one after the other
+        std::vector<glm::vec3> points;
+        std::vector<size_t> firstPoints;
+        for (size_t c = 0; c < clouds.size(); c++)
+        {
+            firstPoints.push_back(points.size());
+            points.insert(points.end(), clouds[c].begin(), clouds[c].end());
+        }
+        _signedDistances.assign(points.size(), 0.0f);
+
+        std::vector<DeviationReport> reports(clouds.size() > 1 ? clouds.size() + 1 : clouds.size());
+        for (size_t r = 0; r < reports.size(); r++)
+        {
+            reports[r].points = (r < clouds.size()) ? clouds[r].size() : points.size();
+            reports[r].vertices = vertices.size();
+        }
+
+        BVH bvh(positions, indices);
+        if (bvh.isEmpty())
+            return reports;
+
+        //cloud to mesh, signed by the face normal of the closest triangle
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int i = 0; i < static_cast<int>(points.size()); i++)
+        {
+            ClosestHit hit;
+            bvh.getClosest(points[i], hit);
+
+            glm::vec3 polygon[3];
+            for (int v = 0; v < 3; v++)
+                polygon[v] = positions[indices[hit.triangle*3+v]];
+            float side = glm::dot(points[i] - hit.position, GeometryTools::getNormal(polygon));
+            _signedDistances[i] = (side < 0.0f) ? -hit.distance : hit.distance;
+        }
+
+        for (size_t c = 0; c < clouds.size(); c++)
+            reports[c] = getReport(vertices, clouds[c], firstPoints[c]);
+        if (clouds.size() > 1)
+            reports.back() = getReport(vertices, points, 0);
+
+        double milliseconds = timer.nsecsElapsed() / 1000000.0;
+        for (size_t r = 0; r < reports.size(); r++)
+        {
+            reports[r].milliseconds = milliseconds;
+            std::clog << __FUNCTION__ << ": " << reports[r].points << " points, rms " << reports[r].rms << ", max " << reports[r].cloudToMesh
+                      << ", hausdorff " << reports[r].hausdorff << ".\n";
+        }
+        std::clog << __FUNCTION__ << ": " << clouds.size() << " clouds in " << milliseconds << " ms.\n";
+
+        return reports;
+    }
+
+    DeviationReport DeviationAnalysis::getReport(const std::vector<glm::vec3> &vertices, const std::vector<glm::vec3> &points, const size_t first)
+    {
+        DeviationReport report;
+        report.points = points.size();
+        report.vertices = vertices.size();
+        if (points.empty())
+            return report;
+
+        double sum = 0.0, sumSquared = 0.0;
+        float minSigned = std::numeric_limits<float>::max();
+        float maxSigned = -std::numeric_limits<float>::max();
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            float distance = _signedDistances[first + i];
+            sum += distance;
+            sumSquared += distance*distance;
+            minSigned = std::min(minSigned, distance);
+            maxSigned = std::max(maxSigned, distance);
+        }
+
+        //mesh to cloud over the mesh vertices
+        KdTree tree(points);
+        float meshToCloud = 0.0f;
+        #pragma omp parallel for schedule(dynamic, 256) reduction(max:meshToCloud)
+        for (int v = 0; v < static_cast<int>(vertices.size()); v++)
+        {
+            Neighbor nearest;
+            if (tree.getNearest(vertices[v], nearest))
+                meshToCloud = std::max(meshToCloud, nearest.distance);
+        }
+
+        report.mean = sum / points.size();
+        report.rms = sqrt(sumSquared / points.size());
+        report.minSigned = minSigned;
+        report.maxSigned = maxSigned;
+        report.cloudToMesh = std::max(fabs(minSigned), fabs(maxSigned));
+        report.meshToCloud = meshToCloud;
+        report.hausdorff = std::max(report.cloudToMesh, meshToCloud);
+
+        report.histogramRange = report.cloudToMesh;
+        report.histogram.assign(_bins, 0);
+        if (report.histogramRange > 0.0f)
+        {
+            for (size_t i = 0; i < points.size(); i++)
+            {
+                float t = 0.5f * (_signedDistances[first + i] / report.histogramRange + 1.0f);
+                uint bin = std::min(static_cast<uint>(t * _bins), _bins - 1);
+                report.histogram[bin]++;
+            }
+        }
+
+        return report;
+    }
+
+    std::vector<glm::vec4> DeviationAnalysis::getColors(const float range)
+    {
+        //blue (inside) to white (on the surface) to red (outside)
+        std::vector<glm::vec4> colors(_signedDistances.size());
+        for (size_t i = 0; i < _signedDistances.size(); i++)
+        {
+            float t = (range > 0.0f) ? glm::clamp(_signedDistances[i] / range, -1.0f, 1.0f) : 0.0f;
+            if (t < 0.0f)
+                colors[i] = glm::vec4(1.0f + t, 1.0f + t, 1.0f, 1.0f);
+            else
+                colors[i] = glm::vec4(1.0f, 1.0f - t, 1.0f - t, 1.0f);
+        }
+
+        return colors;
+    }
+
+    bool DeviationAnalysis::writeReport(QString filename, const std::vector<std::vector<DeviationReport> > &frames)
+    {
+        QFile file(filename);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            return false;
+
+        QTextStream stream(&file);
+        stream << "frame,cloud,points,vertices,rms,mean,min,max,cloudToMesh,meshToCloud,hausdorff,histogramRange,milliseconds,histogram\n";
+        for (size_t f = 0; f < frames.size(); f++)
+        {
+            for (size_t r = 0; r < frames[f].size(); r++)
+            {
+                const DeviationReport &report = frames[f][r];
+                stream << f+1 << "," << (report.cloud > 0 ? QString::number(report.cloud) : QString("all")) << ","
+                       << report.points << "," << report.vertices << ","
+                       << report.rms << "," << report.mean << "," << report.minSigned << "," << report.maxSigned << ","
+                       << report.cloudToMesh << "," << report.meshToCloud << "," << report.hausdorff << ","
+                       << report.histogramRange << "," << report.milliseconds << ",";
+                for (size_t b = 0; b < report.histogram.size(); b++)
+                    stream << (b > 0 ? " " : "") << report.histogram[b];
+                stream << "\n";
+            }
+        }
+
+        return true;
+    }
+
+}
@@ -0,0 +1,149 @@
+#include "displacement.h"
+
+#include <QElapsedTimer>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    TemporalDisplacement::TemporalDisplacement(const uint maxSteps, const float motionTolerance):
+        _maxSteps(maxSteps),
+        _motionTolerance(motionTolerance),
+        _bvhReady(false)
+    {
+    }
+
+    void TemporalDisplacement::reset()
+    {
+        _topology.clear();
+        _previousTriangles.clear();
+        _previousDistances.clear();
+        _stats = DisplacementStats();
+    }
+
+    float TemporalDisplacement::getDistance(const uint triangle, const glm::vec3 &point, ClosestHit &hit)
+    {
+        glm::vec3 polygon[3];
+        for (int v = 0; v < 3; v++)
+            polygon[v] = _positions[_indices[triangle*3+v]];
+
+        hit.triangle = triangle;
+        hit.position = GeometryTools::getClosestPoint(polygon, point, hit.barycentric);
+        hit.distance = glm::length(hit.position - point);
+        hit.triangleTests++;
+
+        return hit.distance;
+    }
+
+    bool TemporalDisplacement::walk(const glm::vec3 &point, const int seed, ClosestHit &hit)
+    {
+        getDistance(seed, point, hit);
+
+        for (uint step = 0; step < _maxSteps; step++)
+        {
+            glm::ivec3 neighbors = _topology.getTriangleNeighbors(hit.triangle);
+            ClosestHit best = hit;
+            for (int k = 0; k < 3; k++)
+            {
+                if (neighbors[k] < 0)
+                    continue;
+
+                ClosestHit candidate;
+                getDistance(neighbors[k], point, candidate);
+                hit.triangleTests++;
+                if (candidate.distance < best.distance)
+                {
+                    best.triangle = candidate.triangle;
+                    best.position = candidate.position;
+                    best.barycentric = candidate.barycentric;
+                    best.distance = candidate.distance;
+                }
+            }
+            best.triangleTests = hit.triangleTests;
+
+            //local minimum reached
+            if (best.triangle == hit.triangle)
+                return true;
+
+            hit = best;
+        }
+
+        return false;
+    }
+
+    DisplacementStats TemporalDisplacement::update(Geometry *mesh, Geometry *cloud)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        _stats = DisplacementStats();
+        _positions = mesh->getPositions();
+        _indices = mesh->getIndices();
+
+        BoundingBox box = mesh->getBoundingBox();
+        float tolerance = box.isEmpty() ? 0.0f : _motionTolerance * 2.0f * glm::length(box.getExtent());
+
+        uint triangleCount = _indices.size() / 3;
+        if (_topology.getTriangleCount() != triangleCount)
+        {
+            //topology changed, previous matches are meaningless
+            _topology.build(_positions, _indices);
+            _previousTriangles.clear();
+        }
+        _bvhReady = false;
+
+        std::vector<glm::vec3> points = cloud->getPositions();
+        if (_previousTriangles.size() != points.size())
+        {
+            _previousTriangles.assign(points.size(), -1);
+            _previousDistances.assign(points.size(), 0.0f);
+        }
+
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            const glm::vec3 &point = points[i];
+            ClosestHit hit;
+            bool found = false;
+
+            int seed = _previousTriangles[i];
+            if (seed >= 0 && seed < static_cast<int>(triangleCount))
+                found = walk(point, seed, hit) && hit.distance <= _previousDistances[i] + tolerance;
+
+            if (found)
+                _stats.hits++;
+            else
+            {
+                if (!_bvhReady)
+                {
+                    _bvh.build(_positions, _indices);
+                    _bvhReady = true;
+                }
+
+                uint walkTests = hit.triangleTests;
+                hit = ClosestHit();
+                _bvh.getClosest(point, hit);
+                hit.triangleTests += walkTests;
+                _stats.fallbacks++;
+            }
+
+            _stats.queries++;
+            _stats.triangleTests += hit.triangleTests;
+            _previousTriangles[i] = hit.triangle;
+            _previousDistances[i] = hit.distance;
+
+            if (hit.triangle != -1)
+                cloud->setDisplacement(i, hit.position - point);
+        }
+        cloud->updateDisplacementBuffer();
+
+        _stats.milliseconds = timer.nsecsElapsed() / 1000000.0;
+
+        std::clog << __FUNCTION__ << ": " << _stats.queries << " points, "
+                  << 100.0f * _stats.getHitRate() << "% coherent hits, "
+                  << _stats.getTestsPerQuery() << " triangle tests per point, "
+                  << _stats.milliseconds << " ms.\n";
+
+        return _stats;
+    }
+
+}
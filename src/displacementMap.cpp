@@ -0,0 +1,218 @@
+#include "displacementMap.h"
+#include "kdTree.h"
+
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    DisplacementMap::DisplacementMap(const uint resolution):
+        _resolution(resolution),
+        _textureId(0)
+    {
+    }
+
+    DisplacementMap::~DisplacementMap()
+    {
+        if (_textureId != 0)
+            glDeleteTextures(1, &_textureId);
+    }
+
+    bool DisplacementMap::hasParameterization(const std::vector<glm::vec2> &textureCoordinates, const std::vector<uint> &indices)
+    {
+        if (textureCoordinates.empty())
+            return false;
+
+        //PLY meshes come with a constant placeholder uv
+        float area = 0.0f;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            glm::vec2 e1 = textureCoordinates[indices[t+1]] - textureCoordinates[indices[t]];
+            glm::vec2 e2 = textureCoordinates[indices[t+2]] - textureCoordinates[indices[t]];
+            area += 0.5f * fabs(e1.x*e2.y - e1.y*e2.x);
+        }
+
+        return area > 1e-6f;
+    }
+
+    std::vector<glm::vec2> DisplacementMap::getAtlas(const uint triangleCount, const uint resolution)
+    {
+        //two triangles per square cell, inset by a gutter
+        uint cellCount = (triangleCount + 1) / 2;
+        uint cellsPerRow = static_cast<uint>(ceil(sqrt(static_cast<float>(cellCount))));
+        float cellSize = 1.0f / cellsPerRow;
+        float a = (static_cast<float>(_gutter) / resolution) / cellSize;
+        float b = 2.5f * a;
+
+        if (cellSize * resolution < 4.0f * _gutter)
+            std::clog << __FUNCTION__ << ": atlas cells are only " << cellSize * resolution
+                      << " texels wide, increase the resolution.\n";
+
+        std::vector<glm::vec2> atlas(triangleCount * 3);
+        for (uint t = 0; t < triangleCount; t++)
+        {
+            uint cell = t / 2;
+            glm::vec2 origin(static_cast<float>(cell % cellsPerRow), static_cast<float>(cell / cellsPerRow));
+            glm::vec2 corners[3];
+            if (t % 2 == 0)
+            {
+                corners[0] = glm::vec2(a, a);
+                corners[1] = glm::vec2(1.0f - b, a);
+                corners[2] = glm::vec2(a, 1.0f - b);
+            }
+            else
+            {
+                corners[0] = glm::vec2(1.0f - a, 1.0f - a);
+                corners[1] = glm::vec2(b, 1.0f - a);
+                corners[2] = glm::vec2(1.0f - a, b);
+            }
+
+            for (int v = 0; v < 3; v++)
+                atlas[t*3+v] = (origin + corners[v]) * cellSize;
+        }
+
+        return atlas;
+    }
+
+    void DisplacementMap::bake(const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &textureCoordinates,
+                               const std::vector<uint> &indices, const std::vector<glm::vec3> &points,
+                               const std::vector<glm::vec3> &displacements, const uint neighborCount)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        int resolution = static_cast<int>(_resolution);
+        _texels.assign(resolution * resolution, glm::vec3(0.0f));
+        std::vector<int> coverage(resolution * resolution, -1);
+        std::vector<glm::vec3> barycentrics(resolution * resolution);
+
+        //rasterize the triangles in texture space
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            glm::vec2 uv[3];
+            for (int v = 0; v < 3; v++)
+                uv[v] = textureCoordinates[indices[t+v]] * static_cast<float>(resolution) - glm::vec2(0.5f);
+
+            float area = (uv[1].x - uv[0].x)*(uv[2].y - uv[0].y) - (uv[2].x - uv[0].x)*(uv[1].y - uv[0].y);
+            if (fabs(area) < 1e-12f)
+                continue;
+
+            glm::ivec2 min = glm::max(glm::ivec2(glm::floor(glm::min(glm::min(uv[0], uv[1]), uv[2]))), glm::ivec2(0));
+            glm::ivec2 max = glm::min(glm::ivec2(glm::ceil(glm::max(glm::max(uv[0], uv[1]), uv[2]))), glm::ivec2(resolution - 1));
+            for (int y = min.y; y <= max.y; y++)
+            {
+                for (int x = min.x; x <= max.x; x++)
+                {
+                    glm::vec2 p(x, y);
+                    float w0 = ((uv[1].x - p.x)*(uv[2].y - p.y) - (uv[2].x - p.x)*(uv[1].y - p.y)) / area;
+                    float w1 = ((uv[2].x - p.x)*(uv[0].y - p.y) - (uv[0].x - p.x)*(uv[2].y - p.y)) / area;
+                    float w2 = 1.0f - w0 - w1;
+                    if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+                    {
+                        coverage[y*resolution + x] = t/3;
+                        barycentrics[y*resolution + x] = glm::vec3(w0, w1, w2);
+                    }
+                }
+            }
+        }
+
+        //surface samples carry the offset from the surface to their cloud point
+        std::vector<glm::vec3> samples(points.size());
+        for (size_t i = 0; i < points.size(); i++)
+            samples[i] = points[i] + displacements[i];
+        KdTree tree(samples);
+
+        if (!tree.isEmpty())
+        {
+            #pragma omp parallel for schedule(dynamic, 16)
+            for (int y = 0; y < resolution; y++)
+            {
+                std::vector<Neighbor> neighbors;
+                for (int x = 0; x < resolution; x++)
+                {
+                    int t = coverage[y*resolution + x];
+                    if (t == -1)
+                        continue;
+
+                    glm::vec3 b = barycentrics[y*resolution + x];
+                    glm::vec3 position = b.x * positions[indices[t*3]] + b.y * positions[indices[t*3+1]]
+                                       + b.z * positions[indices[t*3+2]];
+
+                    tree.getNearest(position, neighborCount, neighbors);
+                    float h = neighbors.back().distance + 1e-6f;
+                    glm::vec3 sum(0.0f);
+                    float weights = 0.0f;
+                    for (size_t n = 0; n < neighbors.size(); n++)
+                    {
+                        float r = neighbors[n].distance / h;
+                        float w = exp(-4.0f*r*r);
+                        sum += -w * displacements[neighbors[n].id];
+                        weights += w;
+                    }
+                    _texels[y*resolution + x] = sum / weights;
+                }
+            }
+        }
+
+        dilate(coverage, 2*_gutter);
+
+        std::clog << __FUNCTION__ << ": " << resolution << "x" << resolution << " texels from "
+                  << points.size() << " points in " << timer.elapsed() << " ms.\n";
+    }
+
+    void DisplacementMap::dilate(std::vector<int> &coverage, const int iterations)
+    {
+        //fill the gutters so bilinear filtering does not bleed zeros across seams
+        int resolution = static_cast<int>(_resolution);
+        for (int i = 0; i < iterations; i++)
+        {
+            std::vector<int> next = coverage;
+            for (int y = 0; y < resolution; y++)
+            {
+                for (int x = 0; x < resolution; x++)
+                {
+                    if (coverage[y*resolution + x] != -1)
+                        continue;
+
+                    glm::vec3 sum(0.0f);
+                    int count = 0;
+                    const int offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+                    for (int n = 0; n < 4; n++)
+                    {
+                        int nx = x + offsets[n][0];
+                        int ny = y + offsets[n][1];
+                        if (nx >= 0 && ny >= 0 && nx < resolution && ny < resolution && coverage[ny*resolution + nx] != -1)
+                        {
+                            sum += _texels[ny*resolution + nx];
+                            count++;
+                        }
+                    }
+                    if (count > 0)
+                    {
+                        _texels[y*resolution + x] = sum / static_cast<float>(count);
+                        next[y*resolution + x] = 0;
+                    }
+                }
+            }
+            coverage.swap(next);
+        }
+    }
+
+    void DisplacementMap::upload()
+    {
+        if (_textureId == 0)
+            glGenTextures(1, &_textureId);
+
+        glBindTexture(GL_TEXTURE_2D, _textureId);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, _resolution, _resolution, 0, GL_RGB, GL_FLOAT, &_texels[0]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+}
@@ -0,0 +1,379 @@
+#include "distanceField.h"
+#include "geometry.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    DistanceField::DistanceField():
+        _origin(0.0f),
+        _voxelSize(1.0f),
+        _bandWidth(0.0f),
+        _resolution(0),
+        _brickResolution(0),
+        _vertexCount(0),
+        _triangleCount(0)
+    {
+    }
+
+    void DistanceField::prepareExact(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        _bvh.build(positions, indices);
+        _topology.build(positions, indices);
+
+        uint triangleCount = _topology.getTriangleCount();
+        _faceNormals.resize(triangleCount);
+        _vertexNormals.assign(_topology.getVertexCount(), glm::vec3(0.0f));
+        _edgeNormals.assign(_topology.getEdgeCount(), glm::vec3(0.0f));
+
+        for (uint t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 polygon[3];
+            _topology.getTriangleVertices(t, polygon);
+            glm::vec3 normal = GeometryTools::getNormal(polygon);
+            float length = glm::length(normal);
+            _faceNormals[t] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+
+            glm::uvec3 triangle = _topology.getTriangle(t);
+            glm::uvec3 edges = _topology.getTriangleEdges(t);
+            for (int k = 0; k < 3; k++)
+            {
+                glm::vec3 e1 = polygon[(k+1)%3] - polygon[k];
+                glm::vec3 e2 = polygon[(k+2)%3] - polygon[k];
+                float l1 = glm::length(e1);
+                float l2 = glm::length(e2);
+                if (l1 > 0.0f && l2 > 0.0f)
+                {
+                    float angle = acos(glm::clamp(glm::dot(e1, e2) / (l1*l2), -1.0f, 1.0f));
+                    _vertexNormals[triangle[k]] += angle * _faceNormals[t];
+                }
+                _edgeNormals[edges[k]] += _faceNormals[t];
+            }
+        }
+    }
+
+    void DistanceField::releaseExact()
+    {
+        _bvh = BVH();
+        _topology.clear();
+        _faceNormals.clear();
+        _vertexNormals.clear();
+        _edgeNormals.clear();
+    }
+
+    float DistanceField::getExactDistance(const glm::vec3 &point, int &triangle)
+    {
+        ClosestHit hit;
+        if (!_bvh.getClosest(point, hit))
+        {
+            triangle = -1;
+            return _bandWidth;
+        }
+        triangle = hit.triangle;
+
+        //pseudo normal of the closest feature (face, edge or vertex)
+        glm::vec3 normal = _faceNormals[hit.triangle];
+        int zeros = 0, zero = 0, one = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            if (hit.barycentric[k] == 0.0f)
+            {
+                zeros++;
+                zero = k;
+            }
+            else
+                one = k;
+        }
+        if (zeros == 2)
+            normal = _vertexNormals[_topology.getTriangle(hit.triangle)[one]];
+        else if (zeros == 1)
+            normal = _edgeNormals[_topology.getTriangleEdges(hit.triangle)[(zero+1)%3]];
+
+        return (glm::dot(point - hit.position, normal) < 0.0f) ? -hit.distance : hit.distance;
+    }
+
+    void DistanceField::build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                              const float voxelSize, const float bandWidth)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        _voxelSize = voxelSize;
+        _bandWidth = bandWidth;
+        _vertexCount = positions.size();
+        _triangleCount = indices.size() / 3;
+        _meshHash = GeometryTools::getMeshHash(positions, indices);
+        _brickIds.clear();
+        _distances.clear();
+        _triangles.clear();
+
+        prepareExact(positions, indices);
+        if (_bvh.isEmpty())
+            return;
+
+        glm::vec3 min = _bvh.getMin() - glm::vec3(_bandWidth);
+        glm::vec3 max = _bvh.getMax() + glm::vec3(_bandWidth);
+        _origin = min;
+        _resolution = glm::ivec3(glm::ceil((max - min) / _voxelSize)) + glm::ivec3(1);
+        _brickResolution = (_resolution + glm::ivec3(_brickSize - 1)) / _brickSize;
+        _brickIds.assign(_brickResolution.x * _brickResolution.y * _brickResolution.z, -1);
+
+        //bricks touched by the band around each triangle
+        int brickCount = 0;
+        for (uint t = 0; t < _topology.getTriangleCount(); t++)
+        {
+            glm::vec3 polygon[3];
+            _topology.getTriangleVertices(t, polygon);
+            glm::vec3 tMin = glm::min(glm::min(polygon[0], polygon[1]), polygon[2]) - glm::vec3(_bandWidth);
+            glm::vec3 tMax = glm::max(glm::max(polygon[0], polygon[1]), polygon[2]) + glm::vec3(_bandWidth);
+            glm::ivec3 bMin = glm::clamp(glm::ivec3(glm::floor((tMin - _origin) / _voxelSize)) / _brickSize,
+                                         glm::ivec3(0), _brickResolution - glm::ivec3(1));
+            glm::ivec3 bMax = glm::clamp(glm::ivec3(glm::ceil((tMax - _origin) / _voxelSize)) / _brickSize,
+                                         glm::ivec3(0), _brickResolution - glm::ivec3(1));
+
+            for (int z = bMin.z; z <= bMax.z; z++)
+                for (int y = bMin.y; y <= bMax.y; y++)
+                    for (int x = bMin.x; x <= bMax.x; x++)
+                    {
+                        int &brickId = _brickIds[(z*_brickResolution.y + y)*_brickResolution.x + x];
+                        if (brickId == -1)
+                            brickId = brickCount++;
+                    }
+        }
+
+        std::vector<glm::ivec3> bricks(brickCount);
+        for (int z = 0; z < _brickResolution.z; z++)
+            for (int y = 0; y < _brickResolution.y; y++)
+                for (int x = 0; x < _brickResolution.x; x++)
+                {
+                    int brickId = _brickIds[(z*_brickResolution.y + y)*_brickResolution.x + x];
+                    if (brickId != -1)
+                        bricks[brickId] = glm::ivec3(x, y, z);
+                }
+
+        _distances.resize(brickCount * _brickVolume);
+        _triangles.resize(brickCount * _brickVolume);
+
+        #pragma omp parallel for schedule(dynamic)
+        for (int b = 0; b < brickCount; b++)
+        {
+            glm::ivec3 brick = bricks[b] * _brickSize;
+            for (int i = 0; i < _brickVolume; i++)
+            {
+                glm::ivec3 local(i % _brickSize, (i / _brickSize) % _brickSize, i / (_brickSize*_brickSize));
+                glm::vec3 point = _origin + glm::vec3(brick + local) * _voxelSize;
+
+                int triangle;
+                float distance = getExactDistance(point, triangle);
+                _distances[b*_brickVolume + i] = glm::clamp(distance, -_bandWidth, _bandWidth);
+                _triangles[b*_brickVolume + i] = triangle;
+            }
+        }
+
+        releaseExact();
+
+        std::clog << __FUNCTION__ << ": " << brickCount << " of " << _brickIds.size() << " bricks ("
+                  << _resolution.x << "x" << _resolution.y << "x" << _resolution.z << " samples) in "
+                  << timer.elapsed() << " ms.\n";
+    }
+
+    int DistanceField::getSampleIndex(const int x, const int y, const int z)
+    {
+        if (x < 0 || y < 0 || z < 0 || x >= _resolution.x || y >= _resolution.y || z >= _resolution.z)
+            return -1;
+
+        int brickId = _brickIds[((z/_brickSize)*_brickResolution.y + y/_brickSize)*_brickResolution.x + x/_brickSize];
+        if (brickId == -1)
+            return -1;
+
+        return brickId*_brickVolume + ((z%_brickSize)*_brickSize + y%_brickSize)*_brickSize + x%_brickSize;
+    }
+
+    bool DistanceField::getDistance(const glm::vec3 &point, float &distance, glm::vec3 &gradient)
+    {
+        if (_brickIds.empty())
+            return false;
+
+        glm::vec3 g = (point - _origin) / _voxelSize;
+        glm::ivec3 i(glm::floor(g));
+        glm::vec3 f = g - glm::vec3(i);
+
+        float c[8];
+        for (int corner = 0; corner < 8; corner++)
+        {
+            int index = getSampleIndex(i.x + (corner & 1), i.y + ((corner >> 1) & 1), i.z + ((corner >> 2) & 1));
+            if (index == -1)
+                return false;
+            c[corner] = _distances[index];
+        }
+
+        //trilinear interpolation and its analytic gradient
+        float c00 = glm::mix(c[0], c[1], f.x);
+        float c10 = glm::mix(c[2], c[3], f.x);
+        float c01 = glm::mix(c[4], c[5], f.x);
+        float c11 = glm::mix(c[6], c[7], f.x);
+        float c0 = glm::mix(c00, c10, f.y);
+        float c1 = glm::mix(c01, c11, f.y);
+        distance = glm::mix(c0, c1, f.z);
+
+        float dx = glm::mix(glm::mix(c[1]-c[0], c[3]-c[2], f.y), glm::mix(c[5]-c[4], c[7]-c[6], f.y), f.z);
+        float dy = glm::mix(c10 - c00, c11 - c01, f.z);
+        float dz = c1 - c0;
+        gradient = glm::vec3(dx, dy, dz) / _voxelSize;
+
+        return true;
+    }
+
+    bool DistanceField::getDisplacement(const glm::vec3 &point, glm::vec3 &displacement)
+    {
+        float distance;
+        glm::vec3 gradient;
+        if (!getDistance(point, distance, gradient))
+            return false;
+
+        float length = glm::length(gradient);
+        if (length < std::numeric_limits<float>::epsilon() || fabs(distance) >= _bandWidth)
+            return false;
+
+        displacement = -distance * gradient / length;
+        return true;
+    }
+
+    int DistanceField::getClosestTriangle(const glm::vec3 &point)
+    {
+        glm::ivec3 i(glm::floor((point - _origin) / _voxelSize + glm::vec3(0.5f)));
+        int index = getSampleIndex(i.x, i.y, i.z);
+
+        return (index == -1) ? -1 : _triangles[index];
+    }
+
+    DistanceFieldError DistanceField::validate(const std::vector<glm::vec3> &points,
+                                               const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        DistanceFieldError error;
+        prepareExact(positions, indices);
+
+        int samples = 0, outside = 0;
+        float maxError = 0.0f;
+        double sumError = 0.0, sumSquaredError = 0.0;
+
+        #pragma omp parallel for reduction(+:samples,outside,sumError,sumSquaredError) reduction(max:maxError)
+        for (int i = 0; i < static_cast<int>(points.size()); i++)
+        {
+            float distance;
+            glm::vec3 gradient;
+            if (!getDistance(points[i], distance, gradient) || fabs(distance) >= _bandWidth)
+            {
+                outside++;
+                continue;
+            }
+
+            int triangle;
+            float e = fabs(distance - getExactDistance(points[i], triangle));
+            samples++;
+            sumError += e;
+            sumSquaredError += e*e;
+            maxError = std::max(maxError, e);
+        }
+
+        releaseExact();
+
+        error.samples = samples;
+        error.outside = outside;
+        error.maxError = maxError;
+        if (samples > 0)
+        {
+            error.meanError = sumError / samples;
+            error.rmsError = sqrt(sumSquaredError / samples);
+        }
+
+        std::clog << __FUNCTION__ << ": " << error.samples << " samples (" << error.outside << " outside band), "
+                  << "max error " << error.maxError << ", mean " << error.meanError
+                  << ", rms " << error.rmsError << " (voxel " << _voxelSize << ").\n";
+
+        return error;
+    }
+
+    bool DistanceField::save(QString filename)
+    {
+        if (_brickIds.empty())
+            return false;
+
+        QFile file(filename);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+
+        QDataStream stream(&file);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        stream << QString("TSDF") << static_cast<qint32>(2);
+        stream << _vertexCount << _triangleCount << _meshHash;
+        stream << _origin.x << _origin.y << _origin.z << _voxelSize << _bandWidth;
+        stream << _resolution.x << _resolution.y << _resolution.z;
+        stream << _brickResolution.x << _brickResolution.y << _brickResolution.z;
+        stream << static_cast<quint32>(_brickIds.size()) << static_cast<quint32>(_distances.size());
+        stream.writeRawData(reinterpret_cast<const char*>(&_brickIds[0]), _brickIds.size() * sizeof(int));
+        stream.writeRawData(reinterpret_cast<const char*>(&_distances[0]), _distances.size() * sizeof(float));
+        stream.writeRawData(reinterpret_cast<const char*>(&_triangles[0]), _triangles.size() * sizeof(int));
+
+        std::clog << __FUNCTION__ << ": " << filename.toStdString() << " (" << file.size() << " bytes).\n";
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    bool DistanceField::load(QString filename, const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream stream(&file);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        QString magic;
+        qint32 version;
+        stream >> magic >> version;
+        if (magic != "TSDF" || version != 2)
+            return false;
+
+        //a cache of an earlier version of the model would load without complaint otherwise
+        quint32 vertexCount, triangleCount;
+        QByteArray meshHash;
+        stream >> vertexCount >> triangleCount >> meshHash;
+        if (vertexCount != positions.size() || triangleCount != indices.size() / 3 || meshHash != GeometryTools::getMeshHash(positions, indices))
+        {
+            std::clog << __FUNCTION__ << ": " << filename.toStdString() << " does not match the mesh, it is baked again.\n";
+            return false;
+        }
+        _vertexCount = vertexCount;
+        _triangleCount = triangleCount;
+        _meshHash = meshHash;
+
+        quint32 brickIdCount, sampleCount;
+        stream >> _origin.x >> _origin.y >> _origin.z >> _voxelSize >> _bandWidth;
+        stream >> _resolution.x >> _resolution.y >> _resolution.z;
+        stream >> _brickResolution.x >> _brickResolution.y >> _brickResolution.z;
+        stream >> brickIdCount >> sampleCount;
+
+        _brickIds.resize(brickIdCount);
+        _distances.resize(sampleCount);
+        _triangles.resize(sampleCount);
+        stream.readRawData(reinterpret_cast<char*>(&_brickIds[0]), _brickIds.size() * sizeof(int));
+        stream.readRawData(reinterpret_cast<char*>(&_distances[0]), _distances.size() * sizeof(float));
+        stream.readRawData(reinterpret_cast<char*>(&_triangles[0]), _triangles.size() * sizeof(int));
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            _brickIds.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+}
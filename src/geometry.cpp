@@ -1,17 +1,26 @@
 #include <GL/glew.h>
 #include "geometry.h"
+#include "meshTopology.h"
+#include "renderState.h"
 
 #include <QList>
 #include <QFile>
 #include <QTextStream>
+#include <QCryptographicHash>
 
 #include <iostream>
 #include <fstream>
+#include <limits>
+#include <cstddef>
+#include <cstring>
 #include <glm/glm.hpp>
 
 namespace Tessellation
 {
 
+    std::map<GLuint, uint> Geometry::_bufferUsers;
+    QMutex Geometry::_bufferUsersMutex;
+
     Geometry::Geometry():
         _translation(1.0f),
         _rotation(1.0f),
@@ -19,10 +28,46 @@ namespace Tessellation
         _mvp(glm::mat4(1.0f)),
         _innerTL(1),
         _outerTL(1),
+        _adaptiveTL(false),
+        _pixelsPerEdge(8.0f),
+        _boundShader(NULL),
         _isTessellable(false),
         _id(0),
         _type(0),
-        _addDisplacement(false)
+        _addDisplacement(false),
+        _displacementMap(NULL),
+        _vertexArrayId(0),
+        _indiceBuffer(0),
+        _vertexBuffer(0),
+        _textureBuffer(0),
+        _normalBuffer(0),
+        _displacementBuffer(0),
+        _colorBuffer(0),
+        _importanceScale(1.0f),
+        _importanceBuffer(0),
+        _importanceTexture(0),
+        _surfaceMode(LinearSurface),
+        _phongShape(0.75f),
+        _lod(0),
+        _boundingSphere(0.0f),
+        _meshletIndexBuffer(0),
+        _meshletIndexCount(0),
+        _drawMeshlets(false),
+        _octreeIndexBuffer(0),
+        _spacingBuffer(0),
+        _drawOctree(false),
+        _worldBoundingSphere(0.0f),
+        _isTransformDirty(true),
+        _compactVertices(false),
+        _compactBuffer(0),
+        _sharedSource(NULL),
+        _sharesIndices(false),
+        _sharesTextureCoordinates(false),
+        _sharesDisplacements(false),
+        _nextFrame(NULL),
+        _frameBlend(0.0f),
+        _revision(0),
+        _hasComputedNormals(false)
     {
     }
 
@@ -31,7 +76,45 @@ namespace Tessellation
         *this = geometry;
     }
 
-    Geometry::Geometry(QString filename, const uint id, const bool isTessellable)
+    Geometry::Geometry(QString filename, const uint id, const bool isTessellable):
+        _innerTL(1),
+        _outerTL(1),
+        _adaptiveTL(false),
+        _pixelsPerEdge(8.0f),
+        _boundShader(NULL),
+        _displacementMap(NULL),
+        _vertexArrayId(0),
+        _indiceBuffer(0),
+        _vertexBuffer(0),
+        _textureBuffer(0),
+        _normalBuffer(0),
+        _displacementBuffer(0),
+        _colorBuffer(0),
+        _importanceScale(1.0f),
+        _importanceBuffer(0),
+        _importanceTexture(0),
+        _surfaceMode(LinearSurface),
+        _phongShape(0.75f),
+        _lod(0),
+        _boundingSphere(0.0f),
+        _meshletIndexBuffer(0),
+        _meshletIndexCount(0),
+        _drawMeshlets(false),
+        _octreeIndexBuffer(0),
+        _spacingBuffer(0),
+        _drawOctree(false),
+        _worldBoundingSphere(0.0f),
+        _isTransformDirty(true),
+        _compactVertices(false),
+        _compactBuffer(0),
+        _sharedSource(NULL),
+        _sharesIndices(false),
+        _sharesTextureCoordinates(false),
+        _sharesDisplacements(false),
+        _nextFrame(NULL),
+        _frameBlend(0.0f),
+        _revision(0),
+        _hasComputedNormals(false)
     {
         std::string filetype = filename.mid(filename.length()-3, 3).toStdString();
 
@@ -48,27 +131,88 @@ namespace Tessellation
 
         _id = id;
         _isTessellable = isTessellable;
+        _filename = filename;
+
+        //curved surface modes need vertex normals
+        if (_isTessellable && _normals.empty() && !_indices.empty())
+            computeNormals();
+
+        computeBounds();
+        updateDrawIndices();
     }
 
     Geometry::~Geometry()
     {
         glDeleteBuffers(1, &_vertexBuffer);
-        glDeleteBuffers(1, &_textureBuffer);
         glDeleteBuffers(1, &_normalBuffer);
-        glDeleteBuffers(1, &_displacementBuffer);
-        glDeleteBuffers(1, &_indiceBuffer);
+        releaseBuffer(_textureBuffer);
+        releaseBuffer(_displacementBuffer);
+        releaseBuffer(_indiceBuffer);
+        if (_colorBuffer != 0)
+            glDeleteBuffers(1, &_colorBuffer);
+        if (_importanceTexture != 0)
+        {
+            glDeleteTextures(1, &_importanceTexture);
+            glDeleteBuffers(1, &_importanceBuffer);
+        }
+        delete _displacementMap;
+        for (size_t l = 0; l < _lodBuffers.size(); l++)
+        {
+            glDeleteBuffers(1, &_lodBuffers[l].vertexBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].normalBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].textureBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].displacementBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].indexBuffer);
+            glDeleteVertexArrays(1, &_lodBuffers[l].vertexArray);
+        }
+        if (_vertexArrayId != 0)
+            glDeleteVertexArrays(1, &_vertexArrayId);
+        if (_meshletIndexBuffer != 0)
+            glDeleteBuffers(1, &_meshletIndexBuffer);
+        if (_octreeIndexBuffer != 0)
+        {
+            glDeleteBuffers(1, &_octreeIndexBuffer);
+            glDeleteBuffers(1, &_spacingBuffer);
+        }
+        if (_compactBuffer != 0)
+            glDeleteBuffers(1, &_compactBuffer);
     }
 
     void Geometry::initialize()
     {
-        //indices
-        glGenBuffers(1, &_indiceBuffer);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indiceBuffer);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, _indices.size() * sizeof(uint), &_indices[0], GL_STATIC_DRAW);
-        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+        createBuffers();
+        createVertexArray();
+    }
+
+    void Geometry::createBuffers()
+    {
+        //indices, welded so that the post-transform cache sees shared vertices;
+        //uploaded through the copy target, the element binding belongs to whichever vertex array is bound
+        const std::vector<uint> &indices = _drawIndices.empty() ? _indices : _drawIndices;
+        _sharesIndices = _sharedSource != NULL && _sharedSource->_indiceBuffer != 0 && _sharedSource->_drawIndices == _drawIndices;
+        if (_sharesIndices)
+            _indiceBuffer = _sharedSource->_indiceBuffer;
+        else
+        {
+            glGenBuffers(1, &_indiceBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, _indiceBuffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(uint), &indices[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        retainBuffer(_indiceBuffer);
+
+        if (_compactVertices && !_positions.empty())
+        {
+            //every attribute in one stream, the float buffers are never created
+            _vertexBuffer = _textureBuffer = _normalBuffer = _displacementBuffer = 0;
+            uploadCompactVertices();
+
+            std::clog << __FUNCTION__ << ": " << _positions.size() << " compact vertices, " << sizeof(CompactVertex)
+                      << " bytes each instead of " << VertexFormat::getFloatVertexSize() << ".\n";
+            return;
+        }
 
         //vertices
-        _locationVertices = _material->getShader()->getAttribute("position");
         glGenBuffers(1, &_vertexBuffer);
         glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
         glBufferData(GL_ARRAY_BUFFER, _positions.size() * sizeof(glm::vec3), &_positions[0], GL_STATIC_DRAW);
@@ -77,17 +221,23 @@ namespace Tessellation
         if(!_textureCoordinates.empty())
         {
             //texture
-            _locationTextureCoordinates = _material->getShader()->getAttribute("uv");
-            glGenBuffers(1, &_textureBuffer);
-            glBindBuffer(GL_ARRAY_BUFFER, _textureBuffer);
-            glBufferData(GL_ARRAY_BUFFER, _textureCoordinates.size() * sizeof(glm::vec2), &_textureCoordinates[0], GL_STATIC_DRAW);
-            glUnmapBuffer(GL_ARRAY_BUFFER);
+            _sharesTextureCoordinates = _sharedSource != NULL && _sharedSource->_textureBuffer != 0 &&
+                                        _sharedSource->_textureCoordinates == _textureCoordinates;
+            if (_sharesTextureCoordinates)
+                _textureBuffer = _sharedSource->_textureBuffer;
+            else
+            {
+                glGenBuffers(1, &_textureBuffer);
+                glBindBuffer(GL_ARRAY_BUFFER, _textureBuffer);
+                glBufferData(GL_ARRAY_BUFFER, _textureCoordinates.size() * sizeof(glm::vec2), &_textureCoordinates[0], GL_STATIC_DRAW);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+            retainBuffer(_textureBuffer);
         }
 
         if(!_normals.empty())
         {
             //normals
-            _locationNormals = _material->getShader()->getAttribute("normal");
             glGenBuffers(1, &_normalBuffer);
             glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
             glBufferData(GL_ARRAY_BUFFER, _normals.size() * sizeof(glm::vec3), &_normals[0], GL_STATIC_DRAW);
@@ -95,30 +245,722 @@ namespace Tessellation
         }
 
         //displacement
-        _locationDisplacement = _material->getShader()->getAttribute("delta");
-        glGenBuffers(1, &_displacementBuffer);
+        _sharesDisplacements = _sharedSource != NULL && _sharedSource->_displacementBuffer != 0 &&
+                               _sharedSource->_displacements == _displacements;
+        if (_sharesDisplacements)
+            _displacementBuffer = _sharedSource->_displacementBuffer;
+        else
+        {
+            glGenBuffers(1, &_displacementBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, _displacementBuffer);
+            glBufferData(GL_ARRAY_BUFFER, _displacements.size() * sizeof(glm::vec3), &_displacements[0], GL_STATIC_DRAW);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+        }
+        retainBuffer(_displacementBuffer);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Geometry::createVertexArray()
+    {
+        resolveAttributeLocations();
+        updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+    }
+
+    void Geometry::resolveAttributeLocations()
+    {
+        //the variant is compiled here on first use, so only where programs are bound
+        Shader *shader = _material->getShader();
+        _locationVertices = shader->getAttribute("position");
+        _locationTextureCoordinates = shader->getAttribute("uv");
+        _locationNormals = shader->getAttribute("normal");
+        _locationDisplacement = shader->getAttribute("delta");
+        _locationPointSpacing = shader->getAttribute("pointSpacing");
+    }
+
+    void Geometry::updateVertexArray(GLuint &vertexArray, const GLuint vertexBuffer, const GLuint textureBuffer,
+                                     const GLuint normalBuffer, const GLuint displacementBuffer)
+    {
+        //attribute layout recorded once, draws only bind the array
+        if (vertexArray == 0)
+            glGenVertexArrays(1, &vertexArray);
+        RenderState::bindVertexArray(vertexArray);
+
+        if (vertexArray == _vertexArrayId && _compactBuffer != 0)
+        {
+            //normalized integer and half formats, scaled back by the vertex stage (COMPACT_VERTEX)
+            GLsizei stride = sizeof(CompactVertex);
+            glBindBuffer(GL_ARRAY_BUFFER, _compactBuffer);
+            glEnableVertexAttribArray(_locationVertices);
+            glVertexAttribPointer(_locationVertices, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride,
+                                  reinterpret_cast<const GLvoid*>(offsetof(CompactVertex, position)));
+            glEnableVertexAttribArray(_locationTextureCoordinates);
+            glVertexAttribPointer(_locationTextureCoordinates, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+                                  reinterpret_cast<const GLvoid*>(offsetof(CompactVertex, uv)));
+            glEnableVertexAttribArray(_locationNormals);
+            glVertexAttribPointer(_locationNormals, 2, GL_SHORT, GL_TRUE, stride,
+                                  reinterpret_cast<const GLvoid*>(offsetof(CompactVertex, normal)));
+            glEnableVertexAttribArray(_locationDisplacement);
+            glVertexAttribPointer(_locationDisplacement, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride,
+                                  reinterpret_cast<const GLvoid*>(offsetof(CompactVertex, delta)));
+        }
+        else
+        {
+            glEnableVertexAttribArray(_locationVertices);
+            glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+            glVertexAttribPointer(_locationVertices, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+            if (!_textureCoordinates.empty())
+            {
+                glEnableVertexAttribArray(_locationTextureCoordinates);
+                glBindBuffer(GL_ARRAY_BUFFER, textureBuffer);
+                glVertexAttribPointer(_locationTextureCoordinates, 2, GL_FLOAT, GL_FALSE, 0, 0);
+            }
+
+            if (!_normals.empty())
+            {
+                glEnableVertexAttribArray(_locationNormals);
+                glBindBuffer(GL_ARRAY_BUFFER, normalBuffer);
+                glVertexAttribPointer(_locationNormals, 3, GL_FLOAT, GL_FALSE, 0, 0);
+            }
+
+            glEnableVertexAttribArray(_locationDisplacement);
+            if (_displacementStream && vertexArray == _vertexArrayId)
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, _displacementStream->getBufferId());
+                glVertexAttribPointer(_locationDisplacement, 3, GL_FLOAT, GL_FALSE, 0,
+                                      reinterpret_cast<const GLvoid*>(_displacementStream->getOffset()));
+            }
+            else
+            {
+                glBindBuffer(GL_ARRAY_BUFFER, displacementBuffer);
+                glVertexAttribPointer(_locationDisplacement, 3, GL_FLOAT, GL_FALSE, 0, 0);
+            }
+
+            if (_nextFrame != NULL && vertexArray == _vertexArrayId)
+            {
+                glEnableVertexAttribArray(_locationNextPosition);
+                glBindBuffer(GL_ARRAY_BUFFER, _nextFrame->_vertexBuffer);
+                glVertexAttribPointer(_locationNextPosition, 3, GL_FLOAT, GL_FALSE, 0, 0);
+                if (!_normals.empty())
+                {
+                    glEnableVertexAttribArray(_locationNextNormal);
+                    glBindBuffer(GL_ARRAY_BUFFER, _nextFrame->_normalBuffer);
+                    glVertexAttribPointer(_locationNextNormal, 3, GL_FLOAT, GL_FALSE, 0, 0);
+                }
+            }
+        }
+
+        //simplified levels never carry colors
+        if (!_colors.empty() && vertexArray == _vertexArrayId)
+        {
+            glEnableVertexAttribArray(_locationColors);
+            glBindBuffer(GL_ARRAY_BUFFER, _colorBuffer);
+            glVertexAttribPointer(_locationColors, 4, GL_FLOAT, GL_FALSE, 0, 0);
+        }
+
+        if (_spacingBuffer != 0 && vertexArray == _vertexArrayId)
+        {
+            glEnableVertexAttribArray(_locationPointSpacing);
+            glBindBuffer(GL_ARRAY_BUFFER, _spacingBuffer);
+            glVertexAttribPointer(_locationPointSpacing, 1, GL_FLOAT, GL_FALSE, 0, 0);
+        }
+
+        //simplified levels bind their own indices, clouds bind their octree order instead
+        if (vertexArray == _vertexArrayId && _type == GeometryType::Mesh)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indiceBuffer);
+        else if (vertexArray == _vertexArrayId && _octreeIndexBuffer != 0)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _octreeIndexBuffer);
+
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        RenderState::bindVertexArray(0);
+    }
+
+    void Geometry::updateDisplacementBuffer()
+    {
+        if (_compactBuffer != 0)
+        {
+            uploadCompactVertices();
+            return;
+        }
+
+        if (_displacementStream)
+        {
+            //written in place, then the attribute moves to the region just written
+            memcpy(_displacementStream->map(), &_displacements[0], _displacements.size() * sizeof(glm::vec3));
+            _displacementStream->unmap();
+
+            RenderState::bindVertexArray(_vertexArrayId);
+            glBindBuffer(GL_ARRAY_BUFFER, _displacementStream->getBufferId());
+            glVertexAttribPointer(_locationDisplacement, 3, GL_FLOAT, GL_FALSE, 0,
+                                  reinterpret_cast<const GLvoid*>(_displacementStream->getOffset()));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            RenderState::bindVertexArray(0);
+            return;
+        }
+
+        //the previous or the next frame may still draw with these deltas
+        if (detachSharedBuffer(_displacementBuffer, _sharesDisplacements))
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, _displacementBuffer);
+            glBufferData(GL_ARRAY_BUFFER, _displacements.size() * sizeof(glm::vec3), &_displacements[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+            return;
+        }
+
         glBindBuffer(GL_ARRAY_BUFFER, _displacementBuffer);
-        glBufferData(GL_ARRAY_BUFFER, _displacements.size() * sizeof(glm::vec3), &_displacements[0], GL_STATIC_DRAW);
-        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _displacements.size() * sizeof(glm::vec3), &_displacements[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Geometry::setDynamicDisplacements(bool value)
+    {
+        if (value == hasDynamicDisplacements() || _vertexArrayId == 0 || _compactBuffer != 0 || _displacements.empty())
+            return;
+
+        if (value)
+            _displacementStream.reset(new StreamBuffer(_displacements.size() * sizeof(glm::vec3)));
+        else
+        {
+            //the static buffer gets the latest deltas back
+            _displacementStream.reset();
+            updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+        }
+        updateDisplacementBuffer();
+    }
+
+    bool Geometry::detachSharedBuffer(GLuint &buffer, bool &isShared)
+    {
+        //the source frame writes through here too, so the count decides and not the flag
+        isShared = false;
+        if (!isBufferShared(buffer))
+            return false;
+
+        releaseBuffer(buffer);
+        glGenBuffers(1, &buffer);
+        retainBuffer(buffer);
+        return true;
+    }
+
+    void Geometry::retainBuffer(const GLuint buffer)
+    {
+        if (buffer == 0)
+            return;
+
+        QMutexLocker locker(&_bufferUsersMutex);
+        _bufferUsers[buffer]++;
+    }
+
+    void Geometry::releaseBuffer(const GLuint buffer)
+    {
+        if (buffer == 0)
+            return;
+
+        QMutexLocker locker(&_bufferUsersMutex);
+        std::map<GLuint, uint>::iterator it = _bufferUsers.find(buffer);
+        if (it != _bufferUsers.end() && --it->second > 0)
+            return;
+
+        if (it != _bufferUsers.end())
+            _bufferUsers.erase(it);
+        glDeleteBuffers(1, &buffer);
+    }
+
+    bool Geometry::isBufferShared(const GLuint buffer)
+    {
+        QMutexLocker locker(&_bufferUsersMutex);
+        std::map<GLuint, uint>::iterator it = _bufferUsers.find(buffer);
+        return it != _bufferUsers.end() && it->second > 1;
+    }
+
+    void Geometry::linkNextFrame(Geometry *geometry)
+    {
+        //corners only match between frames of the same topology and triangle order
+        if (geometry == NULL || _compactBuffer != 0 || geometry->_compactBuffer != 0 || geometry->_vertexBuffer == 0 ||
+            geometry->_positions.size() != _positions.size())
+            return;
+
+        _nextFrame = geometry;
+        _locationNextPosition = _material->getShader()->getAttribute("nextPosition");
+        _locationNextNormal = _material->getShader()->getAttribute("nextNormal");
+        if (_vertexArrayId != 0)
+            updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+    }
+
+    void Geometry::setTextureCoordinates(const std::vector<glm::vec2> &textureCoordinates)
+    {
+        bool hasBuffer = !_textureCoordinates.empty();
+        _textureCoordinates = textureCoordinates;
+        if (_compactBuffer != 0)
+        {
+            uploadCompactVertices();
+            updateDrawIndices();
+            return;
+        }
+
+        _locationTextureCoordinates = _material->getShader()->getAttribute("uv");
+        bool detached = detachSharedBuffer(_textureBuffer, _sharesTextureCoordinates);
+        if (!hasBuffer)
+        {
+            glGenBuffers(1, &_textureBuffer);
+            retainBuffer(_textureBuffer);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, _textureBuffer);
+        glBufferData(GL_ARRAY_BUFFER, _textureCoordinates.size() * sizeof(glm::vec2), &_textureCoordinates[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (_vertexArrayId != 0 && (!hasBuffer || detached))
+            updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+
+        updateDrawIndices();
+    }
+
+    void Geometry::setColors(const std::vector<glm::vec4> &colors)
+    {
+        _colors = colors;
+
+        _locationColors = _material->getShader()->getAttribute("vertexRGBA");
+        bool hasBuffer = (_colorBuffer != 0);
+        if (!hasBuffer)
+            glGenBuffers(1, &_colorBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, _colorBuffer);
+        glBufferData(GL_ARRAY_BUFFER, _colors.size() * sizeof(glm::vec4), &_colors[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (_vertexArrayId != 0 && !hasBuffer)
+            updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+
+        updateDrawIndices();
+    }
+
+    void Geometry::computeNormals()
+    {
+        //smooth across corners that share a position
+        MeshTopology topology(_positions, _indices);
+        std::vector<uint> triangles(topology.getTriangleCount() * 3);
+        for (uint t = 0; t < topology.getTriangleCount(); t++)
+            for (int k = 0; k < 3; k++)
+                triangles[t*3+k] = topology.getTriangle(t)[k];
+        std::vector<glm::vec3> vertexNormals = GeometryTools::getSmoothNormals(topology.getVertices(), triangles);
+
+        _normals.assign(_positions.size(), glm::vec3(0.0f));
+        for (size_t c = 0; c < _indices.size(); c++)
+            _normals[_indices[c]] = vertexNormals[topology.getVertexId(c)];
+        _hasComputedNormals = true;
+    }
+
+    void Geometry::uploadLodChain()
+    {
+        createLodBuffers();
+        createLodVertexArrays();
+    }
+
+    void Geometry::createLodVertexArrays()
+    {
+        for (size_t l = 0; l < _lodBuffers.size(); l++)
+        {
+            LodBuffers &buffers = _lodBuffers[l];
+            if (buffers.vertexArray == 0)
+            {
+                updateVertexArray(buffers.vertexArray, buffers.vertexBuffer, buffers.textureBuffer, buffers.normalBuffer, buffers.displacementBuffer);
+                RenderState::bindVertexArray(buffers.vertexArray);
+                glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.indexBuffer);
+                RenderState::bindVertexArray(0);
+            }
+        }
+    }
+
+    void Geometry::createLodBuffers()
+    {
+        for (size_t l = 0; l < _lodBuffers.size(); l++)
+        {
+            glDeleteBuffers(1, &_lodBuffers[l].vertexBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].normalBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].textureBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].displacementBuffer);
+            glDeleteBuffers(1, &_lodBuffers[l].indexBuffer);
+            glDeleteVertexArrays(1, &_lodBuffers[l].vertexArray);
+        }
+        _lodBuffers.clear();
+        _lod = 0;
+
+        for (uint l = 0; l < _lodChain.getLevelCount(); l++)
+        {
+            //indexed as simplified, the chain already put the triangles in cache and overdraw order
+            LodLevel &level = _lodChain.getLevel(l);
+            std::vector<glm::vec3> normals = GeometryTools::getSmoothNormals(level.positions, level.indices);
+            std::vector<glm::vec2> textureCoordinates = level.textureCoordinates;
+            textureCoordinates.resize(level.positions.size(), glm::vec2(0.0f));
+            std::vector<glm::vec3> displacements(level.positions.size(), glm::vec3(0.0f));
+
+            LodBuffers buffers;
+            buffers.count = level.indices.size();
+            glGenBuffers(1, &buffers.vertexBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffers.vertexBuffer);
+            glBufferData(GL_ARRAY_BUFFER, level.positions.size() * sizeof(glm::vec3), &level.positions[0], GL_STATIC_DRAW);
+            glGenBuffers(1, &buffers.normalBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffers.normalBuffer);
+            glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
+            glGenBuffers(1, &buffers.textureBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffers.textureBuffer);
+            glBufferData(GL_ARRAY_BUFFER, textureCoordinates.size() * sizeof(glm::vec2), &textureCoordinates[0], GL_STATIC_DRAW);
+            glGenBuffers(1, &buffers.displacementBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, buffers.displacementBuffer);
+            glBufferData(GL_ARRAY_BUFFER, displacements.size() * sizeof(glm::vec3), &displacements[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glGenBuffers(1, &buffers.indexBuffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, buffers.indexBuffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, level.indices.size() * sizeof(uint), &level.indices[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+            buffers.vertexArray = 0;
+            _lodBuffers.push_back(buffers);
+        }
+    }
+
+    void Geometry::setImportance(const std::vector<glm::vec4> &importance, const float scale)
+    {
+        _importance = importance;
+        _importanceScale = scale;
+        if (_importance.empty())
+            return;
+
+        //one texel per patch, fetched with gl_PrimitiveID in the control shader
+        if (_importanceTexture == 0)
+        {
+            glGenBuffers(1, &_importanceBuffer);
+            glGenTextures(1, &_importanceTexture);
+        }
+        glBindBuffer(GL_TEXTURE_BUFFER, _importanceBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, _importance.size() * sizeof(glm::vec4), &_importance[0], GL_STATIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, _importanceTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, _importanceBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    void Geometry::setDisplacementMap(DisplacementMap *displacementMap)
+    {
+        if (_displacementMap != displacementMap)
+            delete _displacementMap;
+        _displacementMap = displacementMap;
+    }
+
+    void Geometry::updatePositionBuffer()
+    {
+        _revision++;
+        //shading follows the new surface, normals of the file keep their hard edges
+        if (_hasComputedNormals && _type == GeometryType::Mesh)
+            computeNormals();
+        //the compact positions are relative to the new box, which also drops the stale meshlets
+        computeBounds();
+        if (_compactBuffer != 0)
+        {
+            uploadCompactVertices();
+            return;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, _positions.size() * sizeof(glm::vec3), &_positions[0]);
+        if (_normalBuffer != 0)
+        {
+            glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, _normals.size() * sizeof(glm::vec3), &_normals[0]);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Geometry::uploadCompactVertices()
+    {
+        _quantization = VertexFormat::getQuantization(_boundingBox, _displacements);
+        std::vector<CompactVertex> vertices = VertexFormat::pack(_positions, _normals, _textureCoordinates, _displacements, _quantization);
+
+        bool hasBuffer = (_compactBuffer != 0);
+        if (!hasBuffer)
+            glGenBuffers(1, &_compactBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, _compactBuffer);
+        if (hasBuffer)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(CompactVertex), &vertices[0]);
+        else
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(CompactVertex), &vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    void Geometry::computeBounds()
+    {
+        _boundingBox = BoundingBox(_positions);
+        _boundingSphere = computeBoundingSphere(_positions, _boundingBox);
+        _isTransformDirty = true;
+        //rebuilt from the new positions on the next cull
+        _meshlets.clear();
+    }
+
+    void Geometry::buildMeshlets()
+    {
+        _meshlets.build(_positions, getDrawIndices());
+        if (!_meshlets.isEmpty() && _meshletIndexBuffer == 0)
+            glGenBuffers(1, &_meshletIndexBuffer);
+    }
+
+    MeshletStats Geometry::cullMeshlets(const Frustum &frustum, const glm::vec4 &viewpoint, const bool cullBackfaces)
+    {
+        if (_meshlets.isEmpty())
+            buildMeshlets();
+        if (_meshlets.isEmpty() || _meshletIndexBuffer == 0)
+            return MeshletStats();
+
+        //object space, so neither the bounds nor the cones are transformed
+        glm::mat4 model = getModelMatrix();
+        std::vector<uint> indices;
+        MeshletStats stats = _meshlets.cull(frustum.transform(model), glm::inverse(model) * viewpoint, cullBackfaces, indices);
+
+        //copy target, binding the element target would change whichever vertex array is current
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _meshletIndexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, _indices.size() * sizeof(uint), NULL, GL_STREAM_DRAW);
+        if (!indices.empty())
+            glBufferSubData(GL_COPY_WRITE_BUFFER, 0, indices.size() * sizeof(uint), &indices[0]);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        RenderState::countCalls(4);
+
+        //an empty selection is never drawn, so nothing would clear it before a later frame or a capture
+        _meshletIndexCount = indices.size();
+        _drawMeshlets = !indices.empty();
+        return stats;
+    }
+
+    template <typename T>
+    static void permuteCorners(std::vector<T> &values, const std::vector<uint> &corners)
+    {
+        if (values.size() != corners.size())
+            return;
+
+        std::vector<T> permuted(values.size());
+        for (size_t c = 0; c < corners.size(); c++)
+            permuted[c] = values[corners[c]];
+        values.swap(permuted);
+    }
+
+    OptimizerStats Geometry::optimizeTriangleOrder()
+    {
+        OptimizerStats stats;
+        if (_type != GeometryType::Mesh || _drawIndices.empty())
+            return stats;
+
+        //welded vertices numbered densely, in order of first use
+        std::vector<uint> vertexIds(_drawIndices.size());
+        std::vector<int> ids(_positions.size(), -1);
+        uint vertexCount = 0;
+        for (size_t c = 0; c < _drawIndices.size(); c++)
+        {
+            if (ids[_drawIndices[c]] < 0)
+                ids[_drawIndices[c]] = vertexCount++;
+            vertexIds[c] = ids[_drawIndices[c]];
+        }
+
+        MeshOptimizer optimizer;
+        std::vector<uint> order = optimizer.optimize(_positions, vertexIds, stats);
+
+        //the optimizer works on the current arrays, the order is kept relative to the file
+        if (!_triangleOrder.empty())
+            for (size_t t = 0; t < order.size(); t++)
+                order[t] = _triangleOrder[order[t]];
+        setTriangleOrder(order);
+
+        return stats;
+    }
+
+    void Geometry::setTriangleOrder(const std::vector<uint> &order)
+    {
+        uint triangleCount = _positions.size() / 3;
+        if (_type != GeometryType::Mesh || order.size() != triangleCount)
+            return;
+
+        //where every file triangle currently sits
+        std::vector<uint> current(triangleCount);
+        for (uint t = 0; t < triangleCount; t++)
+            current[_triangleOrder.empty() ? t : _triangleOrder[t]] = t;
+
+        //the soup is permuted whole, so corner indices stay valid for every per-corner setter
+        std::vector<uint> corners(triangleCount * 3);
+        for (uint t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+                corners[t*3+k] = current[order[t]]*3 + k;
+        permuteCorners(_positions, corners);
+        permuteCorners(_normals, corners);
+        permuteCorners(_textureCoordinates, corners);
+        permuteCorners(_displacements, corners);
+        permuteCorners(_colors, corners);
+        _triangleOrder = order;
+
+        updateDrawIndices();
+    }
+
+    bool Geometry::hasSameConnectivity(Geometry *geometry)
+    {
+        if (geometry->_indicePolygons.size() != _indicePolygons.size())
+            return false;
+
+        for (size_t c = 0; c < _indicePolygons.size(); c++)
+            if (geometry->_indicePolygons[c].vertex != _indicePolygons[c].vertex)
+                return false;
+
+        return true;
+    }
 
+    void Geometry::updateDrawIndices()
+    {
+        if (_type != GeometryType::Mesh)
+            return;
+
+        _drawIndices = MeshOptimizer::weldCorners(_positions, _normals, _textureCoordinates, _colors);
+        _meshlets.clear();
+        _revision++;
+
+        if (_indiceBuffer != 0)
+        {
+            bool detached = detachSharedBuffer(_indiceBuffer, _sharesIndices);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, _indiceBuffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, _drawIndices.size() * sizeof(uint), &_drawIndices[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            if (detached && _vertexArrayId != 0)
+                updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+        }
+    }
+
+    void Geometry::uploadOctree()
+    {
+        if (_octree.isEmpty() || _vertexArrayId == 0)
+            return;
+
+        createOctreeBuffers();
+        _locationPointSpacing = _material->getShader()->getAttribute("pointSpacing");
+        updateVertexArray(_vertexArrayId, _vertexBuffer, _textureBuffer, _normalBuffer, _displacementBuffer);
+    }
+
+    void Geometry::createOctreeBuffers()
+    {
+        if (_octree.isEmpty())
+            return;
+
+        //points keep their ids, the element buffer lists them node after node;
+        //the vertex array picks it up as its element buffer (see updateVertexArray)
+        const std::vector<uint> &indices = _octree.getIndices();
+        if (_octreeIndexBuffer == 0)
+            glGenBuffers(1, &_octreeIndexBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _octreeIndexBuffer);
+        glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(uint), &indices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        std::vector<float> spacings = _octree.getPointSpacings();
+        if (_spacingBuffer == 0)
+            glGenBuffers(1, &_spacingBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, _spacingBuffer);
+        glBufferData(GL_ARRAY_BUFFER, spacings.size() * sizeof(float), &spacings[0], GL_STATIC_DRAW);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+
+    OctreeStats Geometry::selectOctreeNodes(const Frustum &frustum, const glm::vec4 &viewpoint, const float pixelsPerUnit, const uint budget)
+    {
+        std::vector<uint> nodes;
+        OctreeStats stats = _octree.select(frustum, getModelMatrix(), viewpoint, pixelsPerUnit, budget, nodes);
+
+        //one range of the element buffer per node, drawn by a single multi-draw
+        _nodeCounts.resize(nodes.size());
+        _nodeOffsets.resize(nodes.size());
+        for (size_t n = 0; n < nodes.size(); n++)
+        {
+            const OctreeNode &node = _octree.getNode(nodes[n]);
+            _nodeCounts[n] = node.count;
+            _nodeOffsets[n] = reinterpret_cast<const GLvoid*>(static_cast<size_t>(node.firstIndex) * sizeof(uint));
+        }
+        _drawOctree = true;
+
+        return stats;
+    }
+
+    void Geometry::updateTransform()
+    {
+        if (!_isTransformDirty)
+            return;
+
+        _modelMatrix = _translation * _rotation * _scaling;
+        _worldBoundingBox = _boundingBox.transform(_modelMatrix);
+        _worldBoundingSphere = transformBoundingSphere(_boundingSphere, _modelMatrix);
+        _isTransformDirty = false;
+    }
+
+    QStringList Geometry::getShaderDefines()
+    {
+        QStringList defines;
+        if (_addDisplacement)
+            defines << "DISPLACEMENT";
+        if (!_colors.empty())
+            defines << "VERTEX_COLOR";
+        if (_isTessellable && _displacementMap != NULL)
+            defines << "DISPLACEMENT_MAP";
+        if (isOctreeUsable())
+            defines << "POINT_LOD";
+        //simplified levels keep their float buffers
+        if (_compactBuffer != 0 && !(isLodUsable() && _lod > 0))
+            defines << "COMPACT_VERTEX";
+        if (_frameBlend > 0.0f && isFrameBlendUsable())
+            defines << "FRAME_BLEND";
+
+        //only the tessellation stages read these
+        if (_isTessellable && _material->doTessellation())
+        {
+            if (_adaptiveTL)
+                defines << "ADAPTIVE";
+            if (!_importance.empty())
+                defines << "IMPORTANCE";
+            if (_surfaceMode == PNTriangleSurface)
+                defines << "SURFACE_PN";
+            else if (_surfaceMode == PhongSurface)
+                defines << "SURFACE_PHONG";
+        }
+
+        return defines;
+    }
+
+    void Geometry::updateShader()
+    {
+        _material->setDefines(getShaderDefines());
+    }
+
+    GLuint Geometry::getVertexArray()
+    {
+        uint lod = isLodUsable() ? _lod : 0;
+        return (lod > 0) ? _lodBuffers[lod-1].vertexArray : _vertexArrayId;
     }
 
     void Geometry::preDraw()
     {
         _material->bind();
+
+        //sampler units are program state, only set when the variant changes
+        Shader *shader = _material->getShader();
+        if (shader != _boundShader)
+        {
+            if (_isTessellable && _displacementMap != NULL)
+                shader->getUniform<int>("displacementMap").set(0);
+            if (_isTessellable && !_importance.empty())
+                shader->getUniform<int>("importance").set(1);
+            _boundShader = shader;
+        }
+
         if (_isTessellable)
         {
-            _material->getShader()->transmitUniform("innerTL", _innerTL);
-            _material->getShader()->transmitUniform("outerTL", _outerTL);
+            if (_displacementMap != NULL)
+                RenderState::bindTexture(0, GL_TEXTURE_2D, _displacementMap->getTextureId());
+            if (!_importance.empty())
+                RenderState::bindTexture(1, GL_TEXTURE_BUFFER, _importanceTexture);
         }
     }
 
     void Geometry::setMVP(glm::mat4 matrix)
     {
         _mvp =  matrix * getModelMatrix();
-        _material->getShader()->transmitUniform("mvp", _mvp);
     }
 
     void Geometry::setPosition(const int index, glm::vec3 position)
@@ -134,52 +976,60 @@ namespace Tessellation
     void Geometry::draw()
     {
         bool doTessellation = _material->getShader()->doTessellation();
-        _material->getShader()->transmitUniform("doTessellation", doTessellation);
-        _material->getShader()->transmitUniform("color", reinterpret_cast<MaterialDefault*>(_material)->getColor());
-        bool doDisplacement = _material->getShader()->doDisplacement();
-        _material->getShader()->transmitUniform("doDisplacement", doDisplacement);
-
-        glEnableVertexAttribArray(_locationVertices);
-        glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer);
-        glVertexAttribPointer(_locationVertices, 3, GL_FLOAT, GL_FALSE, 0, 0);
 
-        if (!_textureCoordinates.empty())
+        //everything the stages read per object, in one range of the ObjectBlock ring
+        ObjectUniforms object;
+        object.model = getModelMatrix();
+        object.mvp = _mvp;
+        object.color = reinterpret_cast<MaterialDefault*>(_material)->getColor();
+        object.innerTL = _innerTL;
+        object.outerTL = _outerTL;
+        object.pixelsPerEdge = _pixelsPerEdge;
+        object.importanceScale = _importanceScale;
+        object.phongShape = _phongShape;
+        object.frameBlend = _frameBlend;
+        object.positionOffset = _quantization.offset;
+        object.positionScale = _quantization.scale;
+        UniformBlocks::updateObject(object);
+
+        bool isLod = isLodUsable() && _lod > 0;
+        uint count = isLod ? _lodBuffers[_lod-1].count : _indices.size();
+        RenderState::bindVertexArray(getVertexArray());
+        if (_drawMeshlets) //surviving meshlets of the last cull, in place of the welded indices for this draw
         {
-            glEnableVertexAttribArray(_locationTextureCoordinates);
-            glBindBuffer(GL_ARRAY_BUFFER, _textureBuffer);
-            glVertexAttribPointer(_locationTextureCoordinates, 2, GL_FLOAT, GL_FALSE, 0, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _meshletIndexBuffer);
+            glDrawElements(doTessellation ? GL_PATCHES : GL_TRIANGLES, _meshletIndexCount, GL_UNSIGNED_INT, 0);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indiceBuffer);
+            RenderState::countCalls(2);
+            _drawMeshlets = false;
         }
-
-        if (!_normals.empty())
+        else if (_isTessellable) //mesh
         {
-            glEnableVertexAttribArray(_locationNormals);
-            glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
-            glVertexAttribPointer(_locationNormals, 3, GL_FLOAT, GL_FALSE, 0, 0);
+            GLenum mode = doTessellation ? GL_PATCHES : GL_TRIANGLES;
+            if (isLod || !_drawIndices.empty())
+                glDrawElements(mode, count, GL_UNSIGNED_INT, 0);
+            else
+                glDrawArrays(mode, 0, count);
         }
-
-        glEnableVertexAttribArray(_locationDisplacement);
-        glBindBuffer(GL_ARRAY_BUFFER, _displacementBuffer);
-        glVertexAttribPointer(_locationDisplacement, 3, GL_FLOAT, GL_FALSE, 0, 0);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indiceBuffer);
-        if (_isTessellable) //mesh
+        else if (_drawOctree) //selected nodes, sized by the vertex stage
         {
-            if (doTessellation)
-                glDrawArrays(GL_PATCHES, 0, _indices.size());
-            else
-                glDrawArrays(GL_TRIANGLES, 0, _indices.size());
+            RenderState::setCapability(GL_PROGRAM_POINT_SIZE, true);
+            if (!_nodeCounts.empty())
+                glMultiDrawElements(GL_POINTS, &_nodeCounts[0], GL_UNSIGNED_INT, &_nodeOffsets[0], _nodeCounts.size());
+            _drawOctree = false;
         }
         else //point cloud
         {
+            RenderState::setCapability(GL_PROGRAM_POINT_SIZE, false);
             glPointSize(5.0f);
             glDrawArrays(GL_POINTS, 0, _indices.size());
             glPointSize(1.0f);
+            RenderState::countCalls(2);
         }
-
-        glDisableVertexAttribArray(3);
-        glDisableVertexAttribArray(2);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(0);
+        RenderState::countDraw();
+        _frameBlend = 0.0f;
+        if (_displacementStream)
+            _displacementStream->fence();
     }
 
     bool Geometry::loadModelPLY(QString filename)
@@ -444,6 +1294,47 @@ namespace Tessellation
         return false;
     }
 
+    std::vector<glm::vec3> GeometryTools::getSmoothNormals(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        //angle-weighted average of the face normals around each indexed vertex
+        std::vector<glm::vec3> normals(positions.size(), glm::vec3(0.0f));
+        for (size_t t = 0; t + 2 < indices.size(); t += 3)
+        {
+            glm::vec3 polygon[3] = {positions[indices[t]], positions[indices[t+1]], positions[indices[t+2]]};
+            glm::vec3 normal = getNormal(polygon);
+            for (int k = 0; k < 3; k++)
+            {
+                glm::vec3 a = polygon[(k+1)%3] - polygon[k];
+                glm::vec3 b = polygon[(k+2)%3] - polygon[k];
+                float lengths = glm::length(a) * glm::length(b);
+                float angle = (lengths > 0.0f) ? acos(glm::clamp(glm::dot(a, b) / lengths, -1.0f, 1.0f)) : 0.0f;
+                normals[indices[t+k]] += angle * normal;
+            }
+        }
+
+        for (size_t v = 0; v < normals.size(); v++)
+        {
+            float length = glm::length(normals[v]);
+            if (length > 0.0f)
+                normals[v] /= length;
+        }
+
+        return normals;
+    }
+
+    QByteArray GeometryTools::getMeshHash(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                                          const std::vector<glm::vec2> &textureCoordinates)
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        if (!positions.empty())
+            hash.addData(reinterpret_cast<const char*>(&positions[0]), positions.size() * sizeof(glm::vec3));
+        if (!indices.empty())
+            hash.addData(reinterpret_cast<const char*>(&indices[0]), indices.size() * sizeof(uint));
+        if (!textureCoordinates.empty())
+            hash.addData(reinterpret_cast<const char*>(&textureCoordinates[0]), textureCoordinates.size() * sizeof(glm::vec2));
+        return hash.result();
+    }
+
     glm::vec3 GeometryTools::getNormal(glm::vec3 polygon[3])
     {
         glm::vec3 p0 = polygon[0];
@@ -483,4 +1374,78 @@ namespace Tessellation
         return displacement;
     }
 
+    //from Real-Time Collision Detection (Ericson)
+    glm::vec3 GeometryTools::getClosestPoint(glm::vec3 polygon[3], glm::vec3 point, glm::vec3 &barycentric)
+    {
+        glm::vec3 a = polygon[0];
+        glm::vec3 b = polygon[1];
+        glm::vec3 c = polygon[2];
+        glm::vec3 ab = b - a;
+        glm::vec3 ac = c - a;
+
+        glm::vec3 ap = point - a;
+        float d1 = glm::dot(ab, ap);
+        float d2 = glm::dot(ac, ap);
+        if (d1 <= 0.0f && d2 <= 0.0f)
+        {
+            barycentric = glm::vec3(1.0f, 0.0f, 0.0f);
+            return a;
+        }
+
+        glm::vec3 bp = point - b;
+        float d3 = glm::dot(ab, bp);
+        float d4 = glm::dot(ac, bp);
+        if (d3 >= 0.0f && d4 <= d3)
+        {
+            barycentric = glm::vec3(0.0f, 1.0f, 0.0f);
+            return b;
+        }
+
+        float vc = d1*d4 - d3*d2;
+        if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+        {
+            float v = d1 / (d1 - d3);
+            barycentric = glm::vec3(1.0f - v, v, 0.0f);
+            return a + v * ab;
+        }
+
+        glm::vec3 cp = point - c;
+        float d5 = glm::dot(ab, cp);
+        float d6 = glm::dot(ac, cp);
+        if (d6 >= 0.0f && d5 <= d6)
+        {
+            barycentric = glm::vec3(0.0f, 0.0f, 1.0f);
+            return c;
+        }
+
+        float vb = d5*d2 - d1*d6;
+        if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+        {
+            float w = d2 / (d2 - d6);
+            barycentric = glm::vec3(1.0f - w, 0.0f, w);
+            return a + w * ac;
+        }
+
+        float va = d3*d6 - d5*d4;
+        if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)
+        {
+            float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+            barycentric = glm::vec3(0.0f, 1.0f - w, w);
+            return b + w * (c - b);
+        }
+
+        float sum = va + vb + vc;
+        if (sum <= std::numeric_limits<float>::epsilon())
+        {
+            //degenerate triangle
+            barycentric = glm::vec3(1.0f, 0.0f, 0.0f);
+            return a;
+        }
+
+        float v = vb / sum;
+        float w = vc / sum;
+        barycentric = glm::vec3(1.0f - v - w, v, w);
+        return a + ab * v + ac * w;
+    }
+
 }
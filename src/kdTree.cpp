@@ -0,0 +1,133 @@
+#include "kdTree.h"
+
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace Tessellation
+{
+
+    KdTree::KdTree(const std::vector<glm::vec3> &points)
+    {
+        build(points);
+    }
+
+    void KdTree::build(const std::vector<glm::vec3> &points)
+    {
+        _points = points;
+        _ids.resize(points.size());
+        for (uint i = 0; i < _ids.size(); i++)
+            _ids[i] = i;
+
+        subdivide(0, _ids.size(), 0);
+
+        for (uint i = 0; i < _ids.size(); i++)
+            _points[i] = points[_ids[i]];
+    }
+
+    void KdTree::subdivide(const uint first, const uint last, const int depth)
+    {
+        if (last - first <= 1)
+            return;
+
+        int axis = depth % 3;
+        uint middle = (first + last) / 2;
+        std::nth_element(_ids.begin() + first, _ids.begin() + middle, _ids.begin() + last,
+                         [this, axis](uint a, uint b) {return _points[a][axis] < _points[b][axis];});
+
+        subdivide(first, middle, depth + 1);
+        subdivide(middle + 1, last, depth + 1);
+    }
+
+    void KdTree::search(const uint first, const uint last, const int depth, const glm::vec3 &point,
+                        const uint k, std::vector<Neighbor> &neighbors, float &bound)
+    {
+        if (first >= last)
+            return;
+
+        int axis = depth % 3;
+        uint middle = (first + last) / 2;
+        glm::vec3 d = _points[middle] - point;
+        float distance = glm::dot(d, d);
+
+        if (distance < bound)
+        {
+            neighbors.push_back(Neighbor(_ids[middle], distance));
+            std::push_heap(neighbors.begin(), neighbors.end());
+            if (neighbors.size() > k)
+            {
+                std::pop_heap(neighbors.begin(), neighbors.end());
+                neighbors.pop_back();
+            }
+            if (neighbors.size() == k)
+                bound = neighbors.front().distance;
+        }
+
+        float diff = point[axis] - _points[middle][axis];
+        if (diff < 0.0f)
+        {
+            search(first, middle, depth + 1, point, k, neighbors, bound);
+            if (diff*diff < bound)
+                search(middle + 1, last, depth + 1, point, k, neighbors, bound);
+        }
+        else
+        {
+            search(middle + 1, last, depth + 1, point, k, neighbors, bound);
+            if (diff*diff < bound)
+                search(first, middle, depth + 1, point, k, neighbors, bound);
+        }
+    }
+
+    void KdTree::searchRadius(const uint first, const uint last, const int depth, const glm::vec3 &point,
+                              const float radius, std::vector<Neighbor> &neighbors)
+    {
+        if (first >= last)
+            return;
+
+        int axis = depth % 3;
+        uint middle = (first + last) / 2;
+        glm::vec3 d = _points[middle] - point;
+        float distance = glm::dot(d, d);
+        if (distance <= radius*radius)
+            neighbors.push_back(Neighbor(_ids[middle], sqrt(distance)));
+
+        float diff = point[axis] - _points[middle][axis];
+        if (diff <= radius)
+            searchRadius(first, middle, depth + 1, point, radius, neighbors);
+        if (diff >= -radius)
+            searchRadius(middle + 1, last, depth + 1, point, radius, neighbors);
+    }
+
+    bool KdTree::getNearest(const glm::vec3 &point, Neighbor &nearest)
+    {
+        std::vector<Neighbor> neighbors;
+        getNearest(point, 1, neighbors);
+        if (neighbors.empty())
+            return false;
+
+        nearest = neighbors.front();
+        return true;
+    }
+
+    void KdTree::getNearest(const glm::vec3 &point, const uint k, std::vector<Neighbor> &neighbors)
+    {
+        neighbors.clear();
+        if (k == 0)
+            return;
+
+        neighbors.reserve(k + 1);
+        float bound = std::numeric_limits<float>::max();
+        search(0, _points.size(), 0, point, k, neighbors, bound);
+
+        std::sort_heap(neighbors.begin(), neighbors.end());
+        for (size_t i = 0; i < neighbors.size(); i++)
+            neighbors[i].distance = sqrt(neighbors[i].distance);
+    }
+
+    void KdTree::getNeighbors(const glm::vec3 &point, const float radius, std::vector<Neighbor> &neighbors)
+    {
+        neighbors.clear();
+        searchRadius(0, _points.size(), 0, point, radius, neighbors);
+    }
+
+}
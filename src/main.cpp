@@ -1,10 +1,48 @@
 #include <QApplication>
 #include "mediator.h"
+#include "geometry.h"
+#include "tessellator.h"
 //#include <memory>
 #include <regex>
+#include <iostream>
+
+//Tessellation --tessellate <input> <output.obj|ply> <inner> <outer> [equal|fractional_odd|fractional_even]
+int tessellate(QStringList arguments)
+{
+    using namespace Tessellation;
+
+    TessellationSpacing spacing = EqualSpacing;
+    if (arguments.size() > 6 && !Tessellator::getSpacing(arguments.at(6), spacing))
+    {
+        std::cerr << "unknown spacing " << arguments.at(6).toStdString() << "\n";
+        return 1;
+    }
+
+    //no GL context here: the geometry only holds the loaded arrays and is never released
+    Geometry *geometry = new Geometry(arguments.at(2));
+    if (geometry->getIndices().empty())
+    {
+        std::cerr << "cannot load " << arguments.at(2).toStdString() << "\n";
+        return 1;
+    }
+
+    Tessellator tessellator(spacing);
+    std::vector<TessellationLevels> levels(1, TessellationLevels(arguments.at(4).toFloat(), arguments.at(5).toFloat()));
+    IndexedMesh mesh;
+    tessellator.tessellate(geometry->getPositions(), geometry->getNormals(), geometry->getTextureCoordinates(),
+                           geometry->getIndices(), levels, mesh);
+
+    return MeshExporter::write(arguments.at(3), mesh) ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
+    if (argc >= 6 && QString(argv[1]) == "--tessellate")
+    {
+        QCoreApplication a(argc, argv);
+        return tessellate(a.arguments());
+    }
+
     QApplication a(argc, argv);
     new Tessellation::Mediator();
 
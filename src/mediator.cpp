@@ -44,6 +44,7 @@ namespace Tessellation
         connect(_userInterface.actionImportModel, SIGNAL(triggered()), this, SLOT(importModel()));
         connect(_userInterface.actionImportAnimation, SIGNAL(triggered()), this, SLOT(importAnimation()));
         connect(_userInterface.actionSnapshot, SIGNAL(triggered()), this, SLOT(saveSnapshot()));
+        connect(_userInterface.actionExportTessellation, SIGNAL(triggered()), this, SLOT(exportTessellation()));
         connect(_userInterface.actionQuit, SIGNAL(triggered()), _mainWindow.get(), SLOT(close()));
 
         //help
@@ -56,6 +57,17 @@ namespace Tessellation
         connect(_userInterface.actionReset, SIGNAL(triggered()), this, SLOT(resetScene()));
         connect(_userInterface.actionImportInputPoints, SIGNAL(triggered()), this, SLOT(browseInputPoints()));
         connect(_userInterface.actionUpdateInputPoints, SIGNAL(triggered()), this, SLOT(updateInputPoints()));
+        connect(_userInterface.actionUpdateInputPointsField, SIGNAL(triggered()), this, SLOT(updateInputPointsField()));
+        connect(_userInterface.actionBakeDisplacementMap, SIGNAL(triggered()), this, SLOT(bakeDisplacementMap()));
+        connect(_userInterface.actionFitMesh, SIGNAL(triggered()), this, SLOT(fitMesh()));
+        connect(_userInterface.actionAnalyzeDeviation, SIGNAL(triggered()), this, SLOT(analyzeDeviation()));
+        connect(_userInterface.actionLevelOfDetail, SIGNAL(toggled(bool)), this, SLOT(setLevelOfDetail(bool)));
+        connect(_userInterface.actionBuildLod, SIGNAL(triggered()), this, SLOT(buildLodChains()));
+        connect(_userInterface.actionSortedSubmission, SIGNAL(toggled(bool)), this, SLOT(setSortedSubmission(bool)));
+        connect(_userInterface.actionBatching, SIGNAL(toggled(bool)), this, SLOT(setBatching(bool)));
+        connect(_userInterface.actionFrustumCulling, SIGNAL(toggled(bool)), this, SLOT(setFrustumCulling(bool)));
+        connect(_userInterface.actionMeshletCulling, SIGNAL(toggled(bool)), this, SLOT(setMeshletCulling(bool)));
+        connect(_userInterface.actionCompactVertices, SIGNAL(toggled(bool)), this, SLOT(setCompactVertices(bool)));
 
         //tessellation
         connect(_userInterface.ckTessellation, SIGNAL(toggled(bool)), this, SLOT(toggleTessellation(bool)));
@@ -63,6 +75,14 @@ namespace Tessellation
         connect(_userInterface.sOuterLevel, SIGNAL(valueChanged(int)), this, SLOT(setOuterLevel(int)));
         connect(_userInterface.actionTessellation, SIGNAL(toggled(bool)), this, SLOT(toggleTessellation(bool)));
         connect(_userInterface.ckUniformTessellation, SIGNAL(toggled(bool)), this, SLOT(setUniform(bool)));
+        connect(_userInterface.ckAdaptiveTessellation, SIGNAL(toggled(bool)), this, SLOT(setAdaptive(bool)));
+        connect(_userInterface.sPixelsPerEdge, SIGNAL(valueChanged(int)), this, SLOT(setPixelsPerEdge(int)));
+        connect(_userInterface.cbSurfaceMode, SIGNAL(currentIndexChanged(int)), this, SLOT(setSurfaceMode(int)));
+        connect(_userInterface.ckImportance, SIGNAL(toggled(bool)), this, SLOT(setImportance(bool)));
+        connect(_userInterface.sBudget, SIGNAL(valueChanged(int)), this, SLOT(setBudget(int)));
+        connect(_userInterface.sBudget, SIGNAL(sliderReleased()), this, SLOT(updateImportance()));
+        connect(_userInterface.sInnerLevel, SIGNAL(sliderReleased()), this, SLOT(updateImportance()));
+        connect(_userInterface.sOuterLevel, SIGNAL(sliderReleased()), this, SLOT(updateImportance()));
 
         //displacement
         connect(_userInterface.sDensity, SIGNAL(valueChanged(int)), this, SLOT(setDensity(int)));
@@ -70,6 +90,7 @@ namespace Tessellation
         connect(_userInterface.bBrowseInputPoints, SIGNAL(pressed()), this, SLOT(browseInputPoints()));
         connect(_userInterface.ckDisplacement, SIGNAL(toggled(bool)), this, SLOT(toggleDisplacement(bool)));
         connect(_userInterface.ckShowInputPoints, SIGNAL(toggled(bool)), this, SLOT(showInputPoints(bool)));
+        connect(_userInterface.sPointBudget, SIGNAL(valueChanged(int)), this, SLOT(setPointBudget(int)));
 
         //player
         connect(_userInterface.sFrames, SIGNAL(valueChanged(int)), this, SLOT(changeCurrentFrame(int)));
@@ -108,18 +129,109 @@ namespace Tessellation
         _userInterface.eOuterLevel->setEnabled(!value);
     }
 
+    void Mediator::setAdaptive(bool value)
+    {
+        //levels come from the projected edge length instead of the sliders
+        _userInterface.sInnerLevel->setEnabled(!value);
+        _userInterface.eInnerLevel->setEnabled(!value);
+        _userInterface.sOuterLevel->setEnabled(!value && !_userInterface.ckUniformTessellation->isChecked());
+        _userInterface.eOuterLevel->setEnabled(!value && !_userInterface.ckUniformTessellation->isChecked());
+        _userInterface.ckUniformTessellation->setEnabled(!value);
+        _userInterface.sPixelsPerEdge->setEnabled(value);
+        _userInterface.ePixelsPerEdge->setEnabled(value);
+        if (_sceneViewer->isTessellated())
+            _sceneViewer->setAdaptiveTL(value, _userInterface.sPixelsPerEdge->value());
+    }
+
+    void Mediator::setImportance(bool value)
+    {
+        _userInterface.sBudget->setEnabled(value);
+        _userInterface.eBudget->setEnabled(value);
+        if (_sceneViewer->isTessellated())
+            updateImportance();
+    }
+
+    void Mediator::setBudget(int value)
+    {
+        _userInterface.eBudget->setText(QString("%1k").arg(value));
+    }
+
+    void Mediator::updateImportance()
+    {
+        //refitted when the slider is released, the search runs over every patch
+        if (_sceneViewer->isTessellated())
+            _sceneViewer->updateTessellationImportance(_userInterface.ckImportance->isChecked(),
+                                                       _userInterface.sBudget->value() * 1000);
+    }
+
+    void Mediator::setSurfaceMode(int mode)
+    {
+        if (_sceneViewer->isTessellated())
+            _sceneViewer->setSurfaceMode(mode);
+    }
+
+    void Mediator::setLevelOfDetail(bool value)
+    {
+        _sceneViewer->setLevelOfDetail(value);
+    }
+
+    void Mediator::buildLodChains()
+    {
+        _sceneViewer->buildLodChains();
+    }
+
+    void Mediator::setSortedSubmission(bool value)
+    {
+        _sceneViewer->setSortedSubmission(value);
+    }
+
+    void Mediator::setBatching(bool value)
+    {
+        _sceneViewer->setBatching(value);
+    }
+
+    void Mediator::setFrustumCulling(bool value)
+    {
+        _sceneViewer->setFrustumCulling(value);
+    }
+
+    void Mediator::setMeshletCulling(bool value)
+    {
+        _sceneViewer->setMeshletCulling(value);
+    }
+
+    void Mediator::setCompactVertices(bool value)
+    {
+        _sceneViewer->setCompactVertices(value);
+    }
+
+    void Mediator::setPixelsPerEdge(int value)
+    {
+        _userInterface.ePixelsPerEdge->setText(QString::number(value));
+        if (_sceneViewer->isTessellated())
+            _sceneViewer->setAdaptiveTL(_userInterface.ckAdaptiveTessellation->isChecked(), value);
+    }
+
     void Mediator::defaultValues()
     {
         //tessellation
         _userInterface.fTessellation->setEnabled(false);
         _userInterface.sInnerLevel->setValue(2);
         _userInterface.sOuterLevel->setValue(1);
+        _userInterface.sPixelsPerEdge->setValue(8);
+        _userInterface.ckAdaptiveTessellation->setChecked(false);
+        setAdaptive(false);
+        _userInterface.sBudget->setValue(100);
+        _userInterface.ckImportance->setChecked(false);
+        setImportance(false);
+        _userInterface.cbSurfaceMode->setCurrentIndex(0);
 
         //displacement
         _userInterface.fDisplacement->setEnabled(false);
         _userInterface.widgetDisplacementProperties->setEnabled(false);
         _userInterface.sDensity->setValue(10);
         _userInterface.sDistanceEpsilon->setValue(10);
+        _userInterface.sPointBudget->setValue(30);
     }
 
     void Mediator::updateInputPoints()
@@ -127,6 +239,26 @@ namespace Tessellation
         _sceneViewer->updateInputPoints();
     }
 
+    void Mediator::updateInputPointsField()
+    {
+        _sceneViewer->updateInputPointsField();
+    }
+
+    void Mediator::bakeDisplacementMap()
+    {
+        _sceneViewer->bakeDisplacementMap();
+    }
+
+    void Mediator::fitMesh()
+    {
+        _sceneViewer->fitMesh();
+    }
+
+    void Mediator::analyzeDeviation()
+    {
+        _sceneViewer->analyzeDeviation();
+    }
+
     void Mediator::toggleTessellation(bool value)
     {
         if ((value && !_userInterface.ckTessellation->isChecked()) ||
@@ -136,7 +268,11 @@ namespace Tessellation
         _userInterface.fTessellation->setEnabled(value);
         _sceneViewer->setInnerTL(_userInterface.eInnerLevel->text().toInt());
         _sceneViewer->setOuterTL(_userInterface.eOuterLevel->text().toInt());
+        _sceneViewer->setAdaptiveTL(_userInterface.ckAdaptiveTessellation->isChecked(), _userInterface.sPixelsPerEdge->value());
+        _sceneViewer->setSurfaceMode(_userInterface.cbSurfaceMode->currentIndex());
         _sceneViewer->toggleTessellation(value);
+        if (value && _userInterface.ckImportance->isChecked())
+            updateImportance();
     }
 
     void Mediator::setInnerLevel(int level)
@@ -169,6 +305,13 @@ namespace Tessellation
         _userInterface.eDistanceEpsilon->setText(QString::number(distanceEpsilon));
     }
 
+    void Mediator::setPointBudget(int value)
+    {
+        //in hundreds of thousands of points
+        _userInterface.ePointBudget->setText(QString("%1M").arg(static_cast<float>(value)/10.0f, 0, 'f', 1));
+        _sceneViewer->setPointBudget(value * 100000);
+    }
+
     void Mediator::toggleDisplacement(bool value)
     {
         _userInterface.fDisplacement->setEnabled(value);
@@ -216,9 +359,9 @@ namespace Tessellation
             if (!files.isEmpty())
             {
                 std::string path(std::string(files.at(0).filePath().toStdString()));
+                //hidden by the viewer once the frames are loaded, which may happen on the render thread
                 _userInterface.progressBar->setVisible(true);
                 _sceneViewer->loadAnimation(path, files.size());
-                _userInterface.progressBar->setVisible(false);
                 _userInterface.actionPlayer->setEnabled(true);
             }
         }
@@ -256,6 +399,14 @@ namespace Tessellation
         _sceneViewer->saveSnapshot(QString("data/saves/image%1.jpg").arg(id));
     }
 
+    void Mediator::exportTessellation()
+    {
+        QString filename = QFileDialog::getSaveFileName(_mainWindow.get(), "Export tessellation", "data/saves",
+                                                        "Meshes (*.ply *.obj)");
+        if (!filename.isEmpty())
+            _sceneViewer->exportTessellation(filename);
+    }
+
     void Mediator::about()
     {
         QMessageBox msgBox;
@@ -0,0 +1,107 @@
+#include "meshExporter.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QDataStream>
+
+#include <iostream>
+
+namespace Tessellation
+{
+
+    bool MeshExporter::write(QString filename, IndexedMesh &mesh)
+    {
+        if (filename.endsWith(".ply", Qt::CaseInsensitive))
+            return writePLY(filename, mesh);
+
+        return writeOBJ(filename, mesh);
+    }
+
+    bool MeshExporter::writeOBJ(QString filename, IndexedMesh &mesh)
+    {
+        QFile file(filename);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+            return false;
+
+        bool hasNormals = mesh.normals.size() == mesh.positions.size();
+        bool hasTextureCoordinates = mesh.textureCoordinates.size() == mesh.positions.size();
+
+        QTextStream stream(&file);
+        stream << "# " << mesh.getVertexCount() << " vertices, " << mesh.getTriangleCount() << " triangles\n";
+        for (size_t i = 0; i < mesh.positions.size(); i++)
+            stream << "v " << mesh.positions[i].x << " " << mesh.positions[i].y << " " << mesh.positions[i].z << "\n";
+        if (hasTextureCoordinates)
+            for (size_t i = 0; i < mesh.textureCoordinates.size(); i++)
+                stream << "vt " << mesh.textureCoordinates[i].x << " " << mesh.textureCoordinates[i].y << "\n";
+        if (hasNormals)
+            for (size_t i = 0; i < mesh.normals.size(); i++)
+                stream << "vn " << mesh.normals[i].x << " " << mesh.normals[i].y << " " << mesh.normals[i].z << "\n";
+
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+        {
+            stream << "f";
+            for (int v = 0; v < 3; v++)
+            {
+                uint index = mesh.indices[t+v] + 1;
+                stream << " " << index;
+                if (hasTextureCoordinates || hasNormals)
+                {
+                    stream << "/";
+                    if (hasTextureCoordinates)
+                        stream << index;
+                    if (hasNormals)
+                        stream << "/" << index;
+                }
+            }
+            stream << "\n";
+        }
+
+        std::clog << __FUNCTION__ << ": " << filename.toStdString() << " (" << mesh.getTriangleCount() << " triangles).\n";
+
+        return stream.status() == QTextStream::Ok;
+    }
+
+    bool MeshExporter::writePLY(QString filename, IndexedMesh &mesh)
+    {
+        QFile file(filename);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+
+        bool hasNormals = mesh.normals.size() == mesh.positions.size();
+        bool hasTextureCoordinates = mesh.textureCoordinates.size() == mesh.positions.size();
+
+        QString header;
+        QTextStream headerStream(&header);
+        headerStream << "ply\nformat binary_little_endian 1.0\n";
+        headerStream << "element vertex " << mesh.getVertexCount() << "\n";
+        headerStream << "property float x\nproperty float y\nproperty float z\n";
+        if (hasNormals)
+            headerStream << "property float nx\nproperty float ny\nproperty float nz\n";
+        if (hasTextureCoordinates)
+            headerStream << "property float s\nproperty float t\n";
+        headerStream << "element face " << mesh.getTriangleCount() << "\n";
+        headerStream << "property list uchar uint vertex_indices\nend_header\n";
+        headerStream.flush();
+        file.write(header.toLatin1());
+
+        QDataStream stream(&file);
+        stream.setByteOrder(QDataStream::LittleEndian);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        for (size_t i = 0; i < mesh.positions.size(); i++)
+        {
+            stream << mesh.positions[i].x << mesh.positions[i].y << mesh.positions[i].z;
+            if (hasNormals)
+                stream << mesh.normals[i].x << mesh.normals[i].y << mesh.normals[i].z;
+            if (hasTextureCoordinates)
+                stream << mesh.textureCoordinates[i].x << mesh.textureCoordinates[i].y;
+        }
+        for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+            stream << static_cast<quint8>(3) << static_cast<quint32>(mesh.indices[t])
+                   << static_cast<quint32>(mesh.indices[t+1]) << static_cast<quint32>(mesh.indices[t+2]);
+
+        std::clog << __FUNCTION__ << ": " << filename.toStdString() << " (" << mesh.getTriangleCount() << " triangles).\n";
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+}
@@ -0,0 +1,152 @@
+#include "meshFitting.h"
+#include "bvh.h"
+
+#include <QElapsedTimer>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    MeshFitting::MeshFitting(const float smoothness, const float maxDistance):
+        _smoothness(smoothness),
+        _maxDistance(maxDistance)
+    {
+    }
+
+    void MeshFitting::reset()
+    {
+        _topology.clear();
+        _previousCornerVertices.clear();
+        for (int c = 0; c < 3; c++)
+            _previousSolution[c].clear();
+    }
+
+    FittingStats MeshFitting::fit(Geometry *mesh, const std::vector<glm::vec3> &points)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        FittingStats stats;
+        std::vector<glm::vec3> positions = mesh->getPositions();
+        std::vector<uint> indices = mesh->getIndices();
+
+        //another mesh with as many triangles must not start from this one's solution
+        _topology.build(positions, indices);
+        std::vector<uint> &cornerVertices = _topology.getCornerVertices();
+        if (cornerVertices != _previousCornerVertices)
+        {
+            _previousCornerVertices = cornerVertices;
+            for (int c = 0; c < 3; c++)
+                _previousSolution[c].clear();
+        }
+
+        uint vertexCount = _topology.getVertexCount();
+        std::vector<glm::vec3> rest(vertexCount);
+        for (size_t c = 0; c < indices.size(); c++)
+            rest[cornerVertices[c]] = positions[indices[c]];
+
+        //each cloud point pulls the closest vertex of its closest triangle
+        BVH bvh(positions, indices);
+        std::vector<int> assigned(points.size(), -1);
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int i = 0; i < static_cast<int>(points.size()); i++)
+        {
+            ClosestHit hit;
+            if (bvh.getClosest(points[i], hit) && hit.distance <= _maxDistance)
+            {
+                int k = 0;
+                if (hit.barycentric[1] > hit.barycentric[k])
+                    k = 1;
+                if (hit.barycentric[2] > hit.barycentric[k])
+                    k = 2;
+                assigned[i] = _topology.getTriangle(hit.triangle)[k];
+            }
+        }
+
+        std::vector<glm::vec3> targets(vertexCount, glm::vec3(0.0f));
+        std::vector<float> weights(vertexCount, 0.0f);
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            if (assigned[i] >= 0)
+            {
+                targets[assigned[i]] += points[i];
+                weights[assigned[i]] += 1.0f;
+            }
+        }
+        for (uint v = 0; v < vertexCount; v++)
+        {
+            if (weights[v] > 0.0f)
+            {
+                targets[v] /= weights[v];
+                weights[v] = 1.0f;
+                stats.correspondences++;
+            }
+        }
+
+        //a small pull toward the rest pose keeps unconstrained components definite
+        float regularization = 1e-4f * _smoothness + 1e-8f;
+        std::vector<Triplet> triplets;
+        triplets.reserve(vertexCount + 2*_topology.getEdgeCount());
+        for (uint v = 0; v < vertexCount; v++)
+        {
+            std::vector<uint> &neighbors = _topology.getVertexNeighbors(v);
+            triplets.push_back(Triplet(v, v, weights[v] + _smoothness*neighbors.size() + regularization));
+            for (size_t n = 0; n < neighbors.size(); n++)
+                triplets.push_back(Triplet(v, neighbors[n], -_smoothness));
+        }
+
+        SparseMatrix matrix;
+        matrix.build(vertexCount, triplets);
+
+        std::vector<float> b[3];
+        for (int c = 0; c < 3; c++)
+            b[c].resize(vertexCount);
+
+        #pragma omp parallel for
+        for (int v = 0; v < static_cast<int>(vertexCount); v++)
+        {
+            std::vector<uint> &neighbors = _topology.getVertexNeighbors(v);
+            glm::vec3 laplacian = static_cast<float>(neighbors.size()) * rest[v];
+            for (size_t n = 0; n < neighbors.size(); n++)
+                laplacian -= rest[neighbors[n]];
+
+            glm::vec3 rhs = weights[v]*targets[v] + _smoothness*laplacian + regularization*rest[v];
+            for (int c = 0; c < 3; c++)
+                b[c][v] = rhs[c];
+        }
+
+        std::vector<float> x[3];
+        for (int c = 0; c < 3; c++)
+        {
+            if (_previousSolution[c].size() == vertexCount)
+                x[c] = _previousSolution[c];
+            else
+            {
+                x[c].resize(vertexCount);
+                for (uint v = 0; v < vertexCount; v++)
+                    x[c][v] = rest[v][c];
+            }
+
+            stats.iterations = std::max(stats.iterations, _solver.solve(matrix, b[c], x[c]));
+            stats.residual = std::max(stats.residual, _solver.getResidual());
+            _previousSolution[c] = x[c];
+        }
+
+        for (size_t c = 0; c < indices.size(); c++)
+        {
+            uint v = cornerVertices[c];
+            mesh->setPosition(indices[c], glm::vec3(x[0][v], x[1][v], x[2][v]));
+        }
+        mesh->updatePositionBuffer();
+
+        stats.vertices = vertexCount;
+        stats.milliseconds = timer.nsecsElapsed() / 1000000.0;
+
+        std::clog << __FUNCTION__ << ": " << stats.vertices << " vertices, " << stats.correspondences
+                  << " constrained, " << matrix.getNonZeros() << " non-zeros, " << stats.iterations
+                  << " iterations (residual " << stats.residual << "), " << stats.milliseconds << " ms.\n";
+
+        return stats;
+    }
+
+}
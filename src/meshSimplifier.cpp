@@ -0,0 +1,511 @@
+#include "meshSimplifier.h"
+#include "meshTopology.h"
+#include "geometry.h"
+#include "meshOptimizer.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <queue>
+#include <iterator>
+#include <algorithm>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    Quadric::Quadric(const glm::dvec4 &plane, const double weight)
+    {
+        const double a = plane.x, b = plane.y, c = plane.z, d = plane.w;
+        q[0] = weight*a*a; q[1] = weight*a*b; q[2] = weight*a*c; q[3] = weight*a*d;
+        q[4] = weight*b*b; q[5] = weight*b*c; q[6] = weight*b*d;
+        q[7] = weight*c*c; q[8] = weight*c*d;
+        q[9] = weight*d*d;
+    }
+
+    double Quadric::evaluate(const glm::dvec3 &p) const
+    {
+        return q[0]*p.x*p.x + 2.0*q[1]*p.x*p.y + 2.0*q[2]*p.x*p.z + 2.0*q[3]*p.x
+             + q[4]*p.y*p.y + 2.0*q[5]*p.y*p.z + 2.0*q[6]*p.y
+             + q[7]*p.z*p.z + 2.0*q[8]*p.z
+             + q[9];
+    }
+
+    bool Quadric::getMinimum(glm::dvec3 &point) const
+    {
+        //minimizer of the quadric, from its upper 3x3 system
+        glm::dmat3 A(q[0], q[1], q[2],
+                     q[1], q[4], q[5],
+                     q[2], q[5], q[7]);
+        double determinant = glm::determinant(A);
+        if (fabs(determinant) < 1e-12)
+            return false;
+
+        point = glm::inverse(A) * glm::dvec3(-q[3], -q[6], -q[8]);
+        return true;
+    }
+
+    struct CollapseCandidate
+    {
+        //cost orders the collapses, error is the squared distance to the faces merged so far
+        double cost;
+        double error;
+        uint a, b;
+        uint stampA, stampB;
+        glm::dvec3 target;
+
+        bool operator>(const CollapseCandidate &candidate) const {return cost > candidate.cost;}
+    };
+
+    bool MeshSimplifier::simplify(const LodLevel &input, const uint targetTriangles, LodLevel &output, SimplifierStats &stats)
+    {
+        MeshTopology topology(input.positions, input.indices);
+        int vertexCount = topology.getVertexCount();
+        int triangleCount = topology.getTriangleCount();
+        if (triangleCount == 0)
+            return false;
+
+        bool hasTextureCoordinates = input.textureCoordinates.size() == input.positions.size();
+        std::vector<glm::dvec3> positions(vertexCount);
+        std::vector<glm::vec2> textureCoordinates(vertexCount, glm::vec2(0.0f));
+        for (int v = 0; v < vertexCount; v++)
+            positions[v] = glm::dvec3(topology.getVertex(v));
+        for (size_t c = 0; c < input.indices.size(); c++)
+            if (hasTextureCoordinates)
+                textureCoordinates[topology.getVertexId(c)] = input.textureCoordinates[input.indices[c]];
+
+        std::vector<glm::uvec3> triangles(triangleCount);
+        std::vector<std::vector<uint> > vertexTriangles(vertexCount);
+        for (int t = 0; t < triangleCount; t++)
+            triangles[t] = topology.getTriangle(t);
+        for (int v = 0; v < vertexCount; v++)
+            vertexTriangles[v] = topology.getVertexTriangles(v);
+
+        //plane quadrics of the incident faces, borders held by perpendicular planes;
+        //the face planes alone measure the error, the border weight only delays the collapses
+        std::vector<Quadric> quadrics(vertexCount), faceQuadrics(vertexCount);
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int v = 0; v < vertexCount; v++)
+        {
+            const std::vector<uint> &incident = vertexTriangles[v];
+            for (size_t i = 0; i < incident.size(); i++)
+            {
+                uint t = incident[i];
+                glm::dvec3 p[3] = {positions[triangles[t][0]], positions[triangles[t][1]], positions[triangles[t][2]]};
+                glm::dvec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+                double length = glm::length(normal);
+                if (length <= 0.0)
+                    continue;
+                normal /= length;
+                Quadric face(glm::dvec4(normal, -glm::dot(normal, p[0])));
+                quadrics[v] += face;
+                faceQuadrics[v] += face;
+
+                glm::ivec3 neighbors = topology.getTriangleNeighbors(t);
+                for (int k = 0; k < 3; k++)
+                {
+                    if (neighbors[k] >= 0 || (triangles[t][k] != static_cast<uint>(v) && triangles[t][(k+1)%3] != static_cast<uint>(v)))
+                        continue;
+                    glm::dvec3 edge = p[(k+1)%3] - p[k];
+                    glm::dvec3 side = glm::cross(edge, normal);
+                    double sideLength = glm::length(side);
+                    if (sideLength > 0.0)
+                    {
+                        side /= sideLength;
+                        quadrics[v] += Quadric(glm::dvec4(side, -glm::dot(side, p[k])), _boundaryWeight);
+                    }
+                }
+            }
+        }
+
+        std::vector<uint> stamps(vertexCount, 0);
+        std::vector<bool> removedVertices(vertexCount, false);
+        std::vector<bool> removedTriangles(triangleCount, false);
+
+        struct CandidateBuilder
+        {
+            static CollapseCandidate get(uint a, uint b, const std::vector<glm::dvec3> &positions,
+                                         const std::vector<Quadric> &quadrics, const std::vector<Quadric> &faceQuadrics,
+                                         const std::vector<uint> &stamps)
+            {
+                CollapseCandidate candidate;
+                candidate.a = a;
+                candidate.b = b;
+                candidate.stampA = stamps[a];
+                candidate.stampB = stamps[b];
+
+                Quadric quadric = quadrics[a];
+                quadric += quadrics[b];
+
+                //nearly singular systems can put the minimum far from the edge
+                glm::dvec3 middle = 0.5 * (positions[a] + positions[b]);
+                double reach = glm::length(positions[b] - positions[a]);
+                if (!quadric.getMinimum(candidate.target) || glm::length(candidate.target - middle) > reach)
+                {
+                    glm::dvec3 options[3] = {positions[a], positions[b], 0.5 * (positions[a] + positions[b])};
+                    candidate.target = options[0];
+                    for (int i = 1; i < 3; i++)
+                        if (quadric.evaluate(options[i]) < quadric.evaluate(candidate.target))
+                            candidate.target = options[i];
+                }
+                candidate.cost = std::max(quadric.evaluate(candidate.target), 0.0);
+
+                Quadric face = faceQuadrics[a];
+                face += faceQuadrics[b];
+                candidate.error = std::max(face.evaluate(candidate.target), 0.0);
+                return candidate;
+            }
+        };
+
+        //initial costs in parallel, the collapses themselves are sequential
+        int edgeCount = topology.getEdgeCount();
+        std::vector<CollapseCandidate> candidates(edgeCount);
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int e = 0; e < edgeCount; e++)
+        {
+            glm::uvec2 edge = topology.getEdge(e);
+            candidates[e] = CandidateBuilder::get(edge.x, edge.y, positions, quadrics, faceQuadrics, stamps);
+        }
+        std::priority_queue<CollapseCandidate, std::vector<CollapseCandidate>, std::greater<CollapseCandidate> >
+                heap(std::greater<CollapseCandidate>(), candidates);
+
+        uint liveTriangles = triangleCount;
+        double maxError = 0.0;
+        std::vector<uint> neighborsA, neighborsB, opposite;
+        while (liveTriangles > targetTriangles && !heap.empty())
+        {
+            CollapseCandidate candidate = heap.top();
+            heap.pop();
+            uint a = candidate.a, b = candidate.b;
+            if (removedVertices[a] || removedVertices[b] || stamps[a] != candidate.stampA || stamps[b] != candidate.stampB)
+                continue;
+
+            //link condition: a and b may only share the vertices opposite the edge,
+            //two inside and one on a border, anything else pinches the surface into a fin
+            neighborsA.clear();
+            neighborsB.clear();
+            opposite.clear();
+            for (size_t i = 0; i < vertexTriangles[a].size(); i++)
+            {
+                const glm::uvec3 &triangle = triangles[vertexTriangles[a][i]];
+                if (triangle[0] != b && triangle[1] != b && triangle[2] != b)
+                    continue;
+                for (int k = 0; k < 3; k++)
+                    if (triangle[k] != a && triangle[k] != b)
+                        opposite.push_back(triangle[k]);
+            }
+            std::sort(opposite.begin(), opposite.end());
+            for (int side = 0; side < 2; side++)
+            {
+                uint v = side == 0 ? a : b;
+                std::vector<uint> &neighbors = side == 0 ? neighborsA : neighborsB;
+                for (size_t i = 0; i < vertexTriangles[v].size(); i++)
+                    for (int k = 0; k < 3; k++)
+                        if (triangles[vertexTriangles[v][i]][k] != v)
+                            neighbors.push_back(triangles[vertexTriangles[v][i]][k]);
+                std::sort(neighbors.begin(), neighbors.end());
+                neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            }
+            std::vector<uint> shared;
+            std::set_intersection(neighborsA.begin(), neighborsA.end(), neighborsB.begin(), neighborsB.end(), std::back_inserter(shared));
+            bool isValid = (opposite.size() == 1 || opposite.size() == 2) && shared == opposite;
+
+            //no surviving triangle may flip
+            for (int side = 0; side < 2 && isValid; side++)
+            {
+                uint v = side == 0 ? a : b;
+                for (size_t i = 0; i < vertexTriangles[v].size() && isValid; i++)
+                {
+                    const glm::uvec3 &triangle = triangles[vertexTriangles[v][i]];
+                    if ((triangle[0] == a || triangle[1] == a || triangle[2] == a) &&
+                        (triangle[0] == b || triangle[1] == b || triangle[2] == b))
+                        continue;
+
+                    glm::dvec3 before[3], after[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        before[k] = positions[triangle[k]];
+                        after[k] = (triangle[k] == v) ? candidate.target : before[k];
+                    }
+                    glm::dvec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                    glm::dvec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                    isValid = glm::dot(normalBefore, normalAfter) > 0.0;
+                }
+            }
+            if (!isValid)
+            {
+                stats.rejected++;
+                continue;
+            }
+
+            //collapse b into a
+            positions[a] = candidate.target;
+            quadrics[a] += quadrics[b];
+            faceQuadrics[a] += faceQuadrics[b];
+            removedVertices[b] = true;
+            for (size_t i = 0; i < vertexTriangles[b].size(); i++)
+            {
+                uint t = vertexTriangles[b][i];
+                glm::uvec3 &triangle = triangles[t];
+                if (triangle[0] == a || triangle[1] == a || triangle[2] == a)
+                {
+                    removedTriangles[t] = true;
+                    liveTriangles--;
+                }
+                else
+                {
+                    for (int k = 0; k < 3; k++)
+                        if (triangle[k] == b)
+                            triangle[k] = a;
+                    vertexTriangles[a].push_back(t);
+                }
+            }
+            vertexTriangles[b].clear();
+
+            std::vector<uint> &incident = vertexTriangles[a];
+            incident.erase(std::remove_if(incident.begin(), incident.end(),
+                                          [&removedTriangles](uint t) {return removedTriangles[t];}), incident.end());
+            for (size_t i = 0; i < shared.size(); i++)
+            {
+                std::vector<uint> &opposite = vertexTriangles[shared[i]];
+                opposite.erase(std::remove_if(opposite.begin(), opposite.end(),
+                                              [&removedTriangles](uint t) {return removedTriangles[t];}), opposite.end());
+            }
+
+            stamps[a]++;
+            stamps[b]++;
+            maxError = std::max(maxError, candidate.error);
+            stats.collapses++;
+
+            std::vector<uint> neighbors;
+            for (size_t i = 0; i < incident.size(); i++)
+                for (int k = 0; k < 3; k++)
+                    if (triangles[incident[i]][k] != a)
+                        neighbors.push_back(triangles[incident[i]][k]);
+            std::sort(neighbors.begin(), neighbors.end());
+            neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+            for (size_t i = 0; i < neighbors.size(); i++)
+                heap.push(CandidateBuilder::get(a, neighbors[i], positions, quadrics, faceQuadrics, stamps));
+        }
+
+        //compact the surviving vertices
+        output = LodLevel();
+        std::vector<int> remap(vertexCount, -1);
+        for (int t = 0; t < triangleCount; t++)
+        {
+            if (removedTriangles[t])
+                continue;
+            for (int k = 0; k < 3; k++)
+            {
+                uint v = triangles[t][k];
+                if (remap[v] < 0)
+                {
+                    remap[v] = output.positions.size();
+                    output.positions.push_back(glm::vec3(positions[v]));
+                    if (hasTextureCoordinates)
+                        output.textureCoordinates.push_back(textureCoordinates[v]);
+                }
+                output.indices.push_back(remap[v]);
+            }
+        }
+        output.error = std::max(input.error, static_cast<float>(sqrt(maxError)));
+
+        return true;
+    }
+
+    SimplifierStats LodChain::build(const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &textureCoordinates,
+                                    const std::vector<uint> &indices, const float ratio, const uint minTriangles,
+                                    const uint maxLevels)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        SimplifierStats stats;
+        clear();
+        _sourceTriangles = indices.size() / 3;
+        _sourceVertices = positions.size();
+        _sourceHash = GeometryTools::getMeshHash(positions, indices, textureCoordinates);
+
+        LodLevel current;
+        current.positions = positions;
+        current.textureCoordinates = textureCoordinates;
+        current.indices = indices;
+
+        //each level is simplified from the previous one
+        MeshSimplifier simplifier;
+        while (_levels.size() < maxLevels)
+        {
+            uint target = static_cast<uint>(current.getTriangleCount() * ratio);
+            if (target < minTriangles)
+                break;
+
+            LodLevel next;
+            if (!simplifier.simplify(current, target, next, stats) ||
+                next.getTriangleCount() > 0.9f * current.getTriangleCount())
+                break;
+
+            current = next;
+            optimizeLevel(next);
+            _levels.push_back(next);
+        }
+
+        stats.levels = _levels.size();
+        stats.triangles = _levels.empty() ? 0 : _levels.back().getTriangleCount();
+        stats.milliseconds = timer.nsecsElapsed() / 1000000.0;
+
+        std::clog << __FUNCTION__ << ": " << _sourceTriangles << " triangles into " << stats.levels
+                  << " levels down to " << stats.triangles << " (" << stats.collapses << " collapses, "
+                  << stats.rejected << " rejected) in " << stats.milliseconds << " ms.\n";
+
+        return stats;
+    }
+
+    void LodChain::optimizeLevel(LodLevel &level)
+    {
+        std::vector<glm::vec3> corners(level.indices.size());
+        for (size_t c = 0; c < level.indices.size(); c++)
+            corners[c] = level.positions[level.indices[c]];
+
+        MeshOptimizer optimizer;
+        OptimizerStats stats;
+        std::vector<uint> order = optimizer.optimize(corners, level.indices, stats);
+
+        bool hasTextureCoordinates = level.textureCoordinates.size() == level.positions.size();
+        std::vector<int> remap(level.positions.size(), -1);
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec2> textureCoordinates;
+        std::vector<uint> indices(level.indices.size());
+        positions.reserve(level.positions.size());
+        for (size_t t = 0; t < order.size(); t++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                uint v = level.indices[order[t]*3+k];
+                if (remap[v] < 0)
+                {
+                    remap[v] = positions.size();
+                    positions.push_back(level.positions[v]);
+                    if (hasTextureCoordinates)
+                        textureCoordinates.push_back(level.textureCoordinates[v]);
+                }
+                indices[t*3+k] = remap[v];
+            }
+        }
+
+        level.positions.swap(positions);
+        level.textureCoordinates.swap(textureCoordinates);
+        level.indices.swap(indices);
+    }
+
+    uint LodChain::selectLevel(const float unitsPerPixel, const float maxPixelError)
+    {
+        if (unitsPerPixel <= 0.0f)
+            return 0;
+
+        for (int level = static_cast<int>(_levels.size()) - 1; level >= 0; level--)
+            if (_levels[level].error / unitsPerPixel <= maxPixelError)
+                return level + 1;
+
+        return 0;
+    }
+
+    bool LodChain::save(QString filename)
+    {
+        if (_levels.empty())
+            return false;
+
+        QFile file(filename);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+
+        QDataStream stream(&file);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        stream << QString("TLOD") << static_cast<qint32>(2);
+        stream << static_cast<quint32>(_sourceTriangles) << static_cast<quint32>(_sourceVertices) << _sourceHash
+               << static_cast<quint32>(_levels.size());
+        for (size_t l = 0; l < _levels.size(); l++)
+        {
+            const LodLevel &level = _levels[l];
+            stream << level.error << static_cast<quint32>(level.positions.size())
+                   << static_cast<quint32>(level.textureCoordinates.size()) << static_cast<quint32>(level.indices.size());
+            stream.writeRawData(reinterpret_cast<const char*>(&level.positions[0]), level.positions.size() * sizeof(glm::vec3));
+            if (!level.textureCoordinates.empty())
+                stream.writeRawData(reinterpret_cast<const char*>(&level.textureCoordinates[0]), level.textureCoordinates.size() * sizeof(glm::vec2));
+            stream.writeRawData(reinterpret_cast<const char*>(&level.indices[0]), level.indices.size() * sizeof(uint));
+        }
+
+        std::clog << __FUNCTION__ << ": " << filename.toStdString() << " (" << file.size() << " bytes).\n";
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    bool LodChain::load(QString filename, const std::vector<glm::vec3> &positions, const std::vector<glm::vec2> &textureCoordinates,
+                        const std::vector<uint> &indices)
+    {
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream stream(&file);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        QString magic;
+        qint32 version;
+        stream >> magic >> version;
+        if (magic != "TLOD" || version != 2)
+            return false;
+
+        //a chain built from another model, or from this one before fitting or a new atlas, is stale
+        quint32 sourceTriangles, sourceVertices, levelCount;
+        QByteArray sourceHash;
+        stream >> sourceTriangles >> sourceVertices >> sourceHash >> levelCount;
+        if (stream.status() != QDataStream::Ok || sourceTriangles != indices.size() / 3 || sourceVertices != positions.size() ||
+            sourceHash != GeometryTools::getMeshHash(positions, indices, textureCoordinates))
+            return false;
+
+        std::vector<LodLevel> levels(levelCount);
+        for (quint32 l = 0; l < levelCount; l++)
+        {
+            LodLevel &level = levels[l];
+            quint32 positionCount, uvCount, indexCount;
+            stream >> level.error >> positionCount >> uvCount >> indexCount;
+            if (stream.status() != QDataStream::Ok || positionCount == 0 || indexCount == 0 || indexCount % 3 != 0 ||
+                (uvCount != 0 && uvCount != positionCount))
+                return false;
+
+            //counts larger than the file are corrupt, not worth allocating
+            qint64 positionBytes = static_cast<qint64>(positionCount) * sizeof(glm::vec3);
+            qint64 uvBytes = static_cast<qint64>(uvCount) * sizeof(glm::vec2);
+            qint64 indexBytes = static_cast<qint64>(indexCount) * sizeof(uint);
+            if (positionBytes + uvBytes + indexBytes > file.size())
+                return false;
+
+            level.positions.resize(positionCount);
+            level.textureCoordinates.resize(uvCount);
+            level.indices.resize(indexCount);
+            if (stream.readRawData(reinterpret_cast<char*>(&level.positions[0]), positionBytes) != positionBytes ||
+                (uvCount > 0 && stream.readRawData(reinterpret_cast<char*>(&level.textureCoordinates[0]), uvBytes) != uvBytes) ||
+                stream.readRawData(reinterpret_cast<char*>(&level.indices[0]), indexBytes) != indexBytes)
+                return false;
+
+            //a truncated or corrupt file must not reach the index buffers
+            for (quint32 i = 0; i < indexCount; i++)
+                if (level.indices[i] >= positionCount)
+                    return false;
+        }
+        if (stream.status() != QDataStream::Ok)
+            return false;
+
+        _sourceTriangles = sourceTriangles;
+        _sourceVertices = sourceVertices;
+        _sourceHash = sourceHash;
+        _levels = levels;
+
+        std::clog << __FUNCTION__ << ": " << filename.toStdString() << " (" << _levels.size() << " levels).\n";
+
+        return true;
+    }
+
+}
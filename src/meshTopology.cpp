@@ -0,0 +1,106 @@
+#include "meshTopology.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    MeshTopology::MeshTopology(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        build(positions, indices);
+    }
+
+    void MeshTopology::clear()
+    {
+        _vertices.clear();
+        _cornerVertices.clear();
+        _triangles.clear();
+        _triangleNeighbors.clear();
+        _triangleEdges.clear();
+        _edges.clear();
+        _vertexTriangles.clear();
+        _vertexNeighbors.clear();
+    }
+
+    void MeshTopology::build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        typedef boost::unordered_map<glm::vec3, uint, PositionHash> VertexMap;
+        typedef boost::unordered_map<unsigned long long, uint> EdgeMap;
+
+        clear();
+
+        //weld corners by position
+        VertexMap vertexMap;
+        _cornerVertices.resize(indices.size());
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            const glm::vec3 &position = positions[indices[i]];
+            VertexMap::const_iterator it = vertexMap.find(position);
+            if (it == vertexMap.end())
+            {
+                vertexMap[position] = _vertices.size();
+                _cornerVertices[i] = _vertices.size();
+                _vertices.push_back(position);
+            }
+            else
+                _cornerVertices[i] = it->second;
+        }
+
+        uint triangleCount = indices.size() / 3;
+        _triangles.resize(triangleCount);
+        _triangleNeighbors.resize(triangleCount, glm::ivec3(-1));
+        _triangleEdges.resize(triangleCount);
+        _vertexTriangles.resize(_vertices.size());
+        _vertexNeighbors.resize(_vertices.size());
+
+        //edges and adjacency
+        EdgeMap edgeMap;
+        std::vector<glm::ivec2> edgeOwners;
+        for (uint t = 0; t < triangleCount; t++)
+        {
+            _triangles[t] = glm::uvec3(_cornerVertices[t*3], _cornerVertices[t*3+1], _cornerVertices[t*3+2]);
+            for (int k = 0; k < 3; k++)
+            {
+                uint a = _triangles[t][k];
+                uint b = _triangles[t][(k+1)%3];
+                _vertexTriangles[a].push_back(t);
+
+                unsigned long long key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+                EdgeMap::const_iterator it = edgeMap.find(key);
+                if (it == edgeMap.end())
+                {
+                    edgeMap[key] = _edges.size();
+                    _triangleEdges[t][k] = _edges.size();
+                    _edges.push_back(glm::uvec2(std::min(a, b), std::max(a, b)));
+                    edgeOwners.push_back(glm::ivec2(t*3+k, -1));
+
+                    _vertexNeighbors[a].push_back(b);
+                    _vertexNeighbors[b].push_back(a);
+                }
+                else
+                {
+                    uint edge = it->second;
+                    _triangleEdges[t][k] = edge;
+                    if (edgeOwners[edge].y == -1)
+                    {
+                        edgeOwners[edge].y = t*3+k;
+                        int owner = edgeOwners[edge].x;
+                        _triangleNeighbors[owner/3][owner%3] = t;
+                        _triangleNeighbors[t][k] = owner/3;
+                    }
+                }
+            }
+        }
+
+        std::clog << __FUNCTION__ << ": " << _vertices.size() << " vertices, "
+                  << _edges.size() << " edges and " << triangleCount << " triangles.\n";
+    }
+
+    void MeshTopology::getTriangleVertices(const uint triangle, glm::vec3 polygon[3])
+    {
+        for (int v = 0; v < 3; v++)
+            polygon[v] = _vertices[_triangles[triangle][v]];
+    }
+
+}
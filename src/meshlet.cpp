@@ -0,0 +1,191 @@
+#include "meshlet.h"
+#include "meshTopology.h"
+
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <deque>
+#include <algorithm>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    //neighbors bending further away from the cluster normal start a new meshlet
+    static const float MIN_NORMAL_DOT = 0.5f;
+    //meshlets whose normals spread past this never face away as a whole
+    static const float MIN_CONE_DOT = 0.1f;
+    static const float NO_CONE = 2.0f;
+
+    void MeshletSet::build(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        clear();
+        MeshTopology topology(positions, indices);
+        uint triangleCount = topology.getTriangleCount();
+        if (triangleCount == 0)
+            return;
+
+        std::vector<glm::vec3> normals(triangleCount);
+        for (uint t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 polygon[3];
+            topology.getTriangleVertices(t, polygon);
+            glm::vec3 normal = glm::cross(polygon[1] - polygon[0], polygon[2] - polygon[0]);
+            float length = glm::length(normal);
+            normals[t] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+        }
+
+        std::vector<bool> assigned(triangleCount, false);
+        //meshlet that last used a welded vertex, so that its vertices are counted without a set
+        std::vector<uint> vertexMeshlets(topology.getVertexCount(), ~0u);
+        _indices.reserve(indices.size());
+
+        for (uint seed = 0; seed < triangleCount; seed++)
+        {
+            if (assigned[seed])
+                continue;
+
+            uint id = _meshlets.size();
+            uint vertexCount = 0;
+            glm::vec3 normalSum(0.0f);
+            std::vector<uint> triangles;
+            Meshlet meshlet;
+            meshlet.firstIndex = _indices.size();
+
+            std::deque<uint> frontier(1, seed);
+            while (!frontier.empty() && triangles.size() < MAX_TRIANGLES)
+            {
+                uint t = frontier.front();
+                frontier.pop_front();
+                if (assigned[t])
+                    continue;
+
+                glm::uvec3 triangle = topology.getTriangle(t);
+                uint newVertices = 0;
+                for (int k = 0; k < 3; k++)
+                    if (vertexMeshlets[triangle[k]] != id)
+                        newVertices++;
+                if (vertexCount + newVertices > MAX_VERTICES)
+                    continue;
+                if (!triangles.empty() && glm::length(normalSum) > 0.0f &&
+                    glm::dot(normals[t], glm::normalize(normalSum)) < MIN_NORMAL_DOT)
+                    continue;
+
+                for (int k = 0; k < 3; k++)
+                {
+                    if (vertexMeshlets[triangle[k]] != id)
+                    {
+                        vertexMeshlets[triangle[k]] = id;
+                        vertexCount++;
+                    }
+                    _indices.push_back(indices[t*3+k]);
+                }
+                normalSum += normals[t];
+                triangles.push_back(t);
+                assigned[t] = true;
+
+                glm::ivec3 neighbors = topology.getTriangleNeighbors(t);
+                for (int k = 0; k < 3; k++)
+                    if (neighbors[k] >= 0 && !assigned[neighbors[k]])
+                        frontier.push_back(neighbors[k]);
+            }
+
+            meshlet.indexCount = _indices.size() - meshlet.firstIndex;
+
+            std::vector<glm::vec3> points(meshlet.indexCount);
+            for (uint i = 0; i < meshlet.indexCount; i++)
+                points[i] = positions[_indices[meshlet.firstIndex + i]];
+            meshlet.sphere = computeBoundingSphere(points, BoundingBox(points));
+
+            //the cone has to hold every face, degenerate ones are never seen
+            meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+            meshlet.coneCutoff = NO_CONE;
+            if (glm::length(normalSum) > 0.0f)
+            {
+                glm::vec3 axis = glm::normalize(normalSum);
+                float minimumDot = 1.0f;
+                for (size_t i = 0; i < triangles.size(); i++)
+                {
+                    if (glm::length(normals[triangles[i]]) > 0.0f)
+                        minimumDot = std::min(minimumDot, glm::dot(normals[triangles[i]], axis));
+                }
+                if (minimumDot > MIN_CONE_DOT)
+                {
+                    meshlet.coneAxis = axis;
+                    meshlet.coneCutoff = sqrt(1.0f - minimumDot * minimumDot);
+                }
+            }
+
+            _meshlets.push_back(meshlet);
+        }
+
+        std::clog << __FUNCTION__ << ": " << _meshlets.size() << " meshlets for " << triangleCount << " triangles in "
+                  << timer.elapsed() << " ms.\n";
+    }
+
+    MeshletStats MeshletSet::cull(const Frustum &frustum, const glm::vec4 &viewpoint, const bool cullBackfaces,
+                                  std::vector<uint> &indices) const
+    {
+        MeshletStats stats;
+        int meshletCount = _meshlets.size();
+        stats.meshlets = meshletCount;
+        stats.triangles = _indices.size() / 3;
+
+        std::vector<uint> counts(meshletCount, 0);
+        uint culled = 0, backfacing = 0;
+        #pragma omp parallel for schedule(static) reduction(+:culled,backfacing)
+        for (int m = 0; m < meshletCount; m++)
+        {
+            const Meshlet &meshlet = _meshlets[m];
+            if (frustum.isOutside(meshlet.sphere))
+            {
+                culled++;
+                continue;
+            }
+
+            //every face points away when the whole sphere is behind the cone
+            if (cullBackfaces && meshlet.coneCutoff <= 1.0f)
+            {
+                bool isBackfacing;
+                if (viewpoint.w != 0.0f)
+                {
+                    glm::vec3 view = glm::vec3(meshlet.sphere) - glm::vec3(viewpoint);
+                    isBackfacing = glm::dot(view, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(view) + meshlet.sphere.w;
+                }
+                else
+                    isBackfacing = glm::dot(glm::normalize(glm::vec3(viewpoint)), meshlet.coneAxis) >= meshlet.coneCutoff;
+
+                if (isBackfacing)
+                {
+                    backfacing++;
+                    continue;
+                }
+            }
+
+            counts[m] = meshlet.indexCount;
+        }
+        stats.culled = culled;
+        stats.backfacing = backfacing;
+
+        //compaction: offsets of the survivors, then every range copied in parallel
+        std::vector<uint> offsets(meshletCount + 1, 0);
+        for (int m = 0; m < meshletCount; m++)
+            offsets[m+1] = offsets[m] + counts[m];
+        indices.resize(offsets[meshletCount]);
+        stats.visibleTriangles = indices.size() / 3;
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int m = 0; m < meshletCount; m++)
+        {
+            if (counts[m] > 0)
+                std::copy(_indices.begin() + _meshlets[m].firstIndex, _indices.begin() + _meshlets[m].firstIndex + counts[m],
+                          indices.begin() + offsets[m]);
+        }
+
+        return stats;
+    }
+
+}
@@ -0,0 +1,304 @@
+#include "pointOctree.h"
+#include "geometry.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    //children are only worth drawing while the points of their parent are more than a pixel apart
+    static const float MIN_SPACING_PIXELS = 1.0f;
+
+    static OctreeNode createNode(const glm::vec3 &center, const float halfSize, const uint depth)
+    {
+        OctreeNode node;
+        node.center = center;
+        node.halfSize = halfSize;
+        node.depth = depth;
+        node.firstIndex = 0;
+        node.count = 0;
+        for (int o = 0; o < 8; o++)
+            node.children[o] = -1;
+        return node;
+    }
+
+    OctreeStats PointOctree::build(const std::vector<glm::vec3> &positions)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        OctreeStats stats;
+        clear();
+        if (positions.empty())
+            return stats;
+
+        //cube around the cloud, slightly larger so that points on its far faces fall in the last cell
+        BoundingBox box(positions);
+        glm::vec3 extent = box.getExtent();
+        float halfSize = std::max(extent.x, std::max(extent.y, extent.z));
+        halfSize = (halfSize > 0.0f) ? halfSize * 1.001f : 1.0f;
+
+        //one level at a time, nodes of a level are subsampled in parallel
+        std::vector<OctreeNode> level(1, createNode(box.getCenter(), halfSize, 0));
+        std::vector<std::vector<uint> > levelPoints(1, std::vector<uint>(positions.size()));
+        for (size_t i = 0; i < positions.size(); i++)
+            levelPoints[0][i] = i;
+        std::vector<int> levelParents(1, -1), levelOctants(1, 0);
+
+        _indices.reserve(positions.size());
+        while (!level.empty())
+        {
+            int nodeCount = level.size();
+            std::vector<std::vector<uint> > kept(nodeCount);
+            std::vector<std::vector<uint> > childPoints(nodeCount * 8);
+
+            #pragma omp parallel for schedule(dynamic)
+            for (int n = 0; n < nodeCount; n++)
+            {
+                const OctreeNode &node = level[n];
+                std::vector<uint> &points = levelPoints[n];
+                if (points.size() <= LEAF_POINTS || node.depth >= MAX_DEPTH)
+                {
+                    kept[n].swap(points);
+                    continue;
+                }
+
+                //first point of each cell stays, the others go down to the octant they fall in
+                std::vector<bool> cells(NODE_GRID * NODE_GRID * NODE_GRID, false);
+                glm::vec3 origin = node.center - glm::vec3(node.halfSize);
+                float cellScale = NODE_GRID / (2.0f * node.halfSize);
+                for (size_t i = 0; i < points.size(); i++)
+                {
+                    const glm::vec3 &position = positions[points[i]];
+                    glm::ivec3 cell = glm::clamp(glm::ivec3((position - origin) * cellScale), glm::ivec3(0), glm::ivec3(NODE_GRID - 1));
+                    uint c = (cell.z * NODE_GRID + cell.y) * NODE_GRID + cell.x;
+                    if (!cells[c])
+                    {
+                        cells[c] = true;
+                        kept[n].push_back(points[i]);
+                    }
+                    else
+                    {
+                        uint octant = (position.x >= node.center.x ? 1 : 0) | (position.y >= node.center.y ? 2 : 0) |
+                                      (position.z >= node.center.z ? 4 : 0);
+                        childPoints[n*8+octant].push_back(points[i]);
+                    }
+                }
+                std::vector<uint>().swap(points);
+            }
+
+            //breadth-first order keeps every parent before its children
+            std::vector<OctreeNode> nextLevel;
+            std::vector<std::vector<uint> > nextPoints;
+            std::vector<int> nextParents, nextOctants;
+            for (int n = 0; n < nodeCount; n++)
+            {
+                uint id = _nodes.size();
+                OctreeNode node = level[n];
+                node.firstIndex = _indices.size();
+                node.count = kept[n].size();
+                _indices.insert(_indices.end(), kept[n].begin(), kept[n].end());
+                std::vector<uint>().swap(kept[n]);
+                _nodes.push_back(node);
+                if (levelParents[n] >= 0)
+                    _nodes[levelParents[n]].children[levelOctants[n]] = id;
+
+                for (int o = 0; o < 8; o++)
+                {
+                    if (childPoints[n*8+o].empty())
+                        continue;
+
+                    float childHalfSize = 0.5f * node.halfSize;
+                    glm::vec3 offset((o & 1) ? childHalfSize : -childHalfSize, (o & 2) ? childHalfSize : -childHalfSize,
+                                     (o & 4) ? childHalfSize : -childHalfSize);
+                    nextLevel.push_back(createNode(node.center + offset, childHalfSize, node.depth + 1));
+                    nextPoints.push_back(std::vector<uint>());
+                    nextPoints.back().swap(childPoints[n*8+o]);
+                    nextParents.push_back(id);
+                    nextOctants.push_back(o);
+                }
+            }
+
+            level.swap(nextLevel);
+            levelPoints.swap(nextPoints);
+            levelParents.swap(nextParents);
+            levelOctants.swap(nextOctants);
+            stats.levels++;
+        }
+
+        _sourcePoints = positions.size();
+        _sourceHash = GeometryTools::getMeshHash(positions, std::vector<uint>());
+        stats.nodes = _nodes.size();
+        stats.points = _sourcePoints;
+        stats.milliseconds = timer.elapsed();
+
+        std::clog << __FUNCTION__ << ": " << stats.nodes << " nodes on " << stats.levels << " levels for "
+                  << stats.points << " points in " << stats.milliseconds << " ms.\n";
+
+        return stats;
+    }
+
+    std::vector<float> PointOctree::getPointSpacings()
+    {
+        std::vector<float> spacings(_sourcePoints, 0.0f);
+        for (size_t n = 0; n < _nodes.size(); n++)
+        {
+            float spacing = 2.0f * _nodes[n].halfSize / NODE_GRID;
+            for (uint i = 0; i < _nodes[n].count; i++)
+                spacings[_indices[_nodes[n].firstIndex + i]] = spacing;
+        }
+
+        return spacings;
+    }
+
+    //projected radius in pixels, negative when the node is outside the frustum
+    static float getProjectedSize(const OctreeNode &node, const Frustum &frustum, const glm::mat4 &model,
+                                  const glm::vec4 &viewpoint, const float pixelsPerUnit)
+    {
+        glm::vec4 sphere = transformBoundingSphere(glm::vec4(node.center, node.halfSize * sqrt(3.0f)), model);
+        if (frustum.isOutside(sphere))
+            return -1.0f;
+        if (viewpoint.w == 0.0f)
+            return sphere.w * pixelsPerUnit;
+
+        float distance = glm::length(glm::vec3(sphere) - glm::vec3(viewpoint));
+        if (distance <= sphere.w)
+            return std::numeric_limits<float>::max();
+        return sphere.w * pixelsPerUnit / distance;
+    }
+
+    OctreeStats PointOctree::select(const Frustum &frustum, const glm::mat4 &model, const glm::vec4 &viewpoint,
+                                    const float pixelsPerUnit, const uint budget, std::vector<uint> &nodes) const
+    {
+        OctreeStats stats;
+        stats.nodes = _nodes.size();
+        stats.points = _sourcePoints;
+        nodes.clear();
+        if (_nodes.empty())
+            return stats;
+
+        typedef std::pair<float, uint> Candidate;
+        std::priority_queue<Candidate> queue;
+        float rootSize = getProjectedSize(_nodes[0], frustum, model, viewpoint, pixelsPerUnit);
+        if (rootSize >= 0.0f)
+            queue.push(Candidate(rootSize, 0));
+
+        while (!queue.empty())
+        {
+            Candidate candidate = queue.top();
+            queue.pop();
+
+            //the largest remaining node does not fit, the smaller ones would only add holes
+            const OctreeNode &node = _nodes[candidate.second];
+            if (stats.selectedPoints + node.count > budget)
+                break;
+            nodes.push_back(candidate.second);
+            stats.selectedNodes++;
+            stats.selectedPoints += node.count;
+
+            float spacingPixels = candidate.first / sqrt(3.0f) * 2.0f / NODE_GRID;
+            if (spacingPixels < MIN_SPACING_PIXELS)
+                continue;
+
+            for (int o = 0; o < 8; o++)
+            {
+                if (node.children[o] < 0)
+                    continue;
+                float size = getProjectedSize(_nodes[node.children[o]], frustum, model, viewpoint, pixelsPerUnit);
+                if (size >= 0.0f)
+                    queue.push(Candidate(size, node.children[o]));
+            }
+        }
+
+        return stats;
+    }
+
+    bool PointOctree::save(QString filename)
+    {
+        if (_nodes.empty())
+            return false;
+
+        QFile file(filename);
+        if (!file.open(QIODevice::WriteOnly))
+            return false;
+
+        QDataStream stream(&file);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        stream << QString("TOCT") << static_cast<qint32>(2);
+        stream << static_cast<quint32>(_sourcePoints) << _sourceHash << static_cast<quint32>(_nodes.size())
+               << static_cast<quint32>(_indices.size());
+        stream.writeRawData(reinterpret_cast<const char*>(&_nodes[0]), _nodes.size() * sizeof(OctreeNode));
+        stream.writeRawData(reinterpret_cast<const char*>(&_indices[0]), _indices.size() * sizeof(uint));
+
+        std::clog << __FUNCTION__ << ": " << filename.toStdString() << " (" << file.size() << " bytes).\n";
+
+        return stream.status() == QDataStream::Ok;
+    }
+
+    bool PointOctree::load(QString filename, const std::vector<glm::vec3> &positions)
+    {
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        QDataStream stream(&file);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+        QString magic;
+        qint32 version;
+        stream >> magic >> version;
+        if (magic != "TOCT" || version != 2)
+            return false;
+
+        //a tree built from another capture, or from this one with other points, is stale
+        quint32 source, nodeCount, indexCount;
+        QByteArray sourceHash;
+        stream >> source >> sourceHash >> nodeCount >> indexCount;
+        if (stream.status() != QDataStream::Ok || source != positions.size() || nodeCount == 0 || indexCount != source ||
+            sourceHash != GeometryTools::getMeshHash(positions, std::vector<uint>()))
+            return false;
+
+        qint64 nodeBytes = static_cast<qint64>(nodeCount) * sizeof(OctreeNode);
+        qint64 indexBytes = static_cast<qint64>(indexCount) * sizeof(uint);
+        if (nodeBytes + indexBytes > file.size())
+            return false;
+
+        std::vector<OctreeNode> nodes(nodeCount);
+        std::vector<uint> indices(indexCount);
+        if (stream.readRawData(reinterpret_cast<char*>(&nodes[0]), nodeBytes) != nodeBytes ||
+            stream.readRawData(reinterpret_cast<char*>(&indices[0]), indexBytes) != indexBytes)
+            return false;
+
+        //select and getPointSpacings trust these, children come after their parent as build writes them
+        for (quint32 n = 0; n < nodeCount; n++)
+        {
+            const OctreeNode &node = nodes[n];
+            if (node.firstIndex > indexCount || node.count > indexCount - node.firstIndex)
+                return false;
+            for (int o = 0; o < 8; o++)
+                if (node.children[o] >= 0 && (node.children[o] <= static_cast<int>(n) || node.children[o] >= static_cast<int>(nodeCount)))
+                    return false;
+        }
+        for (quint32 i = 0; i < indexCount; i++)
+            if (indices[i] >= source)
+                return false;
+
+        _sourcePoints = source;
+        _sourceHash = sourceHash;
+        _nodes.swap(nodes);
+        _indices.swap(indices);
+
+        std::clog << __FUNCTION__ << ": " << filename.toStdString() << " (" << _nodes.size() << " nodes).\n";
+
+        return true;
+    }
+
+}
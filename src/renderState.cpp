@@ -0,0 +1,93 @@
+#include "renderState.h"
+
+namespace Tessellation
+{
+
+    //no object has this name, so the first change after invalidate() is always issued
+    static const GLuint UNKNOWN = ~0u;
+
+    bool RenderState::_caching = true;
+    GLuint RenderState::_program = UNKNOWN;
+    GLuint RenderState::_vertexArray = UNKNOWN;
+    uint RenderState::_activeUnit = UNKNOWN;
+    GLuint RenderState::_textures[MAX_TEXTURE_UNITS] = {UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN};
+    std::map<GLenum, bool> RenderState::_capabilities;
+    RenderStats RenderState::_stats;
+
+    void RenderState::invalidate()
+    {
+        _program = UNKNOWN;
+        _vertexArray = UNKNOWN;
+        _activeUnit = UNKNOWN;
+        for (uint unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+            _textures[unit] = UNKNOWN;
+        _capabilities.clear();
+    }
+
+    void RenderState::useProgram(const GLuint program)
+    {
+        if (_caching && program == _program)
+        {
+            _stats.skipped++;
+            return;
+        }
+
+        glUseProgram(program);
+        _program = program;
+        _stats.programs++;
+        _stats.calls++;
+    }
+
+    void RenderState::bindVertexArray(const GLuint vertexArray)
+    {
+        if (_caching && vertexArray == _vertexArray)
+        {
+            _stats.skipped++;
+            return;
+        }
+
+        glBindVertexArray(vertexArray);
+        _vertexArray = vertexArray;
+        _stats.vertexArrays++;
+        _stats.calls++;
+    }
+
+    void RenderState::bindTexture(const uint unit, const GLenum target, const GLuint texture)
+    {
+        //units are not told apart by target, each unit only ever holds one kind of texture here
+        if (_caching && unit < MAX_TEXTURE_UNITS && texture == _textures[unit])
+        {
+            _stats.skipped++;
+            return;
+        }
+
+        if (!_caching || unit != _activeUnit)
+        {
+            glActiveTexture(GL_TEXTURE0 + unit);
+            _activeUnit = unit;
+            _stats.calls++;
+        }
+        glBindTexture(target, texture);
+        if (unit < MAX_TEXTURE_UNITS)
+            _textures[unit] = texture;
+        _stats.calls++;
+    }
+
+    void RenderState::setCapability(const GLenum capability, const bool enabled)
+    {
+        std::map<GLenum, bool>::iterator it = _capabilities.find(capability);
+        if (_caching && it != _capabilities.end() && it->second == enabled)
+        {
+            _stats.skipped++;
+            return;
+        }
+
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        _capabilities[capability] = enabled;
+        _stats.calls++;
+    }
+
+}
@@ -0,0 +1,87 @@
+#include <GL/glew.h>
+#include "renderThread.h"
+#include "sceneViewer.h"
+
+#include <QCoreApplication>
+
+namespace Tessellation
+{
+
+    RenderThread::RenderThread(SceneViewer *viewer):
+        _viewer(viewer),
+        _isStopping(false)
+    {
+    }
+
+    RenderThread::~RenderThread()
+    {
+        stop();
+    }
+
+    void RenderThread::post(const RenderCommand &command)
+    {
+        //a full ring means hundreds of changes within one frame, dropping any of them is not an option
+        while (!_commands.push(command))
+            QThread::yieldCurrentThread();
+        _work.release();
+    }
+
+    bool RenderThread::requestFrame(const FrameSnapshot &snapshot)
+    {
+        if (!_snapshots.push(snapshot))
+            return false;
+
+        _work.release();
+        return true;
+    }
+
+    void RenderThread::stop()
+    {
+        if (!isRunning())
+            return;
+
+        _isStopping = true;
+        _work.release();
+        wait();
+    }
+
+    void RenderThread::run()
+    {
+        _viewer->makeCurrent();
+
+        FrameSnapshot snapshot;
+        bool hasSnapshot = false;
+        bool isWaiting = false;
+        while (true)
+        {
+            //a finished upload requests a frame of its own, the timeout only catches fences
+            //and programs that had not signaled or linked by the last frame
+            if (isWaiting)
+                _work.tryAcquire(1, UPLOAD_POLL_INTERVAL);
+            else
+                _work.acquire();
+            //everything posted since the last frame is handled by one pass
+            _work.tryAcquire(_work.available());
+            if (_isStopping)
+                break;
+
+            RenderCommand command;
+            while (_commands.pop(command))
+                command();
+
+            //only the newest view is drawn, older ones are already out of date
+            while (_snapshots.pop(snapshot))
+                hasSnapshot = true;
+            if (!hasSnapshot)
+                continue;
+
+            //pending uploads and programs still linking need another look, with the same view
+            isWaiting = _viewer->renderFrame(snapshot);
+        }
+
+        //back to the GUI thread, which destroys it
+        _viewer->doneCurrent();
+        _viewer->context()->moveToThread(QCoreApplication::instance()->thread());
+    }
+
+}
@@ -3,6 +3,7 @@
 #include <GL/gl.h>
 #include <iostream>
 #include <random>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include "glm/ext.hpp"
@@ -26,7 +27,6 @@ namespace Tessellation
     void Renderer::initialize(Scene *scene)
     {
         _scene = scene;
-        _camera = scene->getCamera();
         _width = _scene->getWidth();
         _height = _scene->getHeight();
 
@@ -41,11 +41,23 @@ namespace Tessellation
 
     void Renderer::loadShaders()
     {
-        Shaders::addShader("render", QStringList() << "position" << "uv" << "normal" << "delta",
-                           QStringList() << "mvp" << "doTessellation" << "doDisplacement" << "color", false);
-        Shaders::addShader("render", QStringList() << "position" << "uv" << "normal" << "delta",
-                           QStringList() << "mvp" << "doTessellation" << "doDisplacement" << "color" << "innerTL" << "outerTL",
-                           true);
+        QStringList attributes = QStringList() << "position" << "uv" << "normal" << "delta" << "vertexRGBA" << "pointSpacing" << "nextPosition" << "nextNormal";
+        //everything else is read from FrameBlock and ObjectBlock (see uniformBuffer.h)
+        QStringList tessellationUniforms = QStringList() << "displacementMap" << "importance";
+
+        //feature flags are defines, each combination is compiled on first use (see Geometry::getShaderDefines)
+        Shaders::addShader("render", attributes, QStringList() << "displacementMap", false);
+        Shaders::addShader("render", attributes, tessellationUniforms, true);
+        //same pipeline with the evaluated vertices written back to a buffer (renderTLCapture)
+        Shaders::addShader("render", attributes, tessellationUniforms, true,
+                           QStringList() << "evaluationPosition" << "evaluationNormal" << "evaluationUV");
+
+        //both base programs compile side by side while the scene loads, binaries of earlier runs skip the compiler
+        if (Shaders::isParallelCompileSupported())
+        {
+            Shaders::preload("render");
+            Shaders::preload("renderTL");
+        }
     }
 
     void Renderer::render(const int currentFrame, const bool animation)
@@ -58,7 +70,9 @@ namespace Tessellation
 
     void Renderer::getModelViewProjectionMatrix(GLfloat matrix[16])
     {
-        _scene->getCamera()->getModelViewProjectionMatrix(matrix);
+        //the view the last frame was drawn with, the viewer's camera may have moved since
+        glm::mat4 mvp = _scene->getMVP();
+        memcpy(matrix, glm::value_ptr(mvp), 16 * sizeof(GLfloat));
     }
 
 }
@@ -1,14 +1,28 @@
 #include "include/scene.h"
 #include <QCursor>
 #include <QGLViewer/frame.h>
+#include <QFile>
+#include <algorithm>
+#include <limits>
 
 namespace Tessellation
 {
 
     Scene::Scene(Camera *camera):
+        _hasViewSnapshot(false),
+        _importanceMesh(NULL),
+        _importanceBudget(0),
         _loaded(false),
+        _hasPendingShaders(false),
         _moveSpeed(0.5f),
-        _showInputPoints(false)
+        _showInputPoints(false),
+        _doLod(false),
+        _lodPixelError(1.0f),
+        _doCulling(true),
+        _doMeshletCulling(false),
+        _pointBudget(3000000),
+        _compactVertices(false),
+        _frameBlend(0.0f)
     {
         _camera.reset(camera);
         _camera->setType(Camera::PERSPECTIVE);
@@ -37,30 +51,55 @@ namespace Tessellation
 
     glm::mat4 Scene::updateMVP()
     {
-        GLfloat modelView[16], projection[16], mvp[16];
+        if (!_hasViewSnapshot)
+            _view = ViewSnapshot(_camera.get());
 
-        _camera->getModelViewMatrix(modelView);
-        _modelView = glm::make_mat4(modelView);
-
-        _camera->getProjectionMatrix(projection);
-        _projection = glm::make_mat4(projection);
-
-        _camera->getModelViewProjectionMatrix(mvp);
-        _mvp = glm::make_mat4(mvp);
+        _modelView = _view.view;
+        _projection = _view.projection;
+        _mvp = _view.viewProjection;
 
         return _mvp;
     }
 
     void Scene::draw(const int currentFrame, const bool animation)
     {
+        finishUploads();
         if (isLoaded() && !_geometries.empty())
         {
             glm::mat4 mvp = updateMVP();
+            //the viewer draws in between frames, nothing cached from the last one holds
+            RenderState::invalidate();
+            RenderState::resetStats();
+            updateFrameUniforms();
+
+            _drawList.clear();
+            _cullStats = CullStats();
+            _meshletStats = MeshletStats();
+            _pointStats = OctreeStats();
+            _hasPendingShaders = false;
+            updateFrustum();
+            //fitting or new texture coordinates leave old vertices in the shared buffers
+            if (_batch && !animation && _batch->isStale())
+                setBatching(true);
+            bool batched = (_batch && !animation);
+            if (batched)
+                _batch->begin();
+
             if (animation)
             {
-                _geometries.at(currentFrame-1)->preDraw();
-                _geometries.at(currentFrame-1)->setMVP(mvp);
-                _geometries.at(currentFrame-1)->draw();
+                Geometry *frame = _geometries.at(currentFrame-1);
+                frame->setFrameBlend(_frameBlend);
+                if (!isCulled(frame))
+                    submit(frame);
+
+                if (_showInputPoints)
+                {
+                    foreach (Geometry *geometry, _geometries)
+                    {
+                        if (geometry->getType() == GeometryType::Cloud && !isCulled(geometry))
+                            submit(geometry);
+                    }
+                }
             }
             else
             {
@@ -69,22 +108,516 @@ namespace Tessellation
                     if (geometry->getType() == GeometryType::Mesh ||
                        (geometry->getType() == GeometryType::Cloud && _showInputPoints))
                     {
-                        geometry->preDraw();
-                        geometry->setMVP(mvp);
-                        geometry->draw();
+                        //culled objects keep a zero instance count in the batch
+                        if (isCulled(geometry))
+                            continue;
+                        if (!batched || !_batch->submit(geometry))
+                            submit(geometry);
                     }
                 }
             }
+
+            //program, then material, then vertex array, so consecutive draws share the most state
+            if (RenderState::isCaching())
+                std::stable_sort(_drawList.begin(), _drawList.end());
+
+            for (size_t i = 0; i < _drawList.size(); i++)
+            {
+                Geometry *geometry = _drawList[i].geometry;
+                geometry->preDraw();
+                geometry->setMVP(mvp);
+                geometry->draw();
+            }
+            if (batched)
+                _batch->draw();
+            RenderState::bindVertexArray(0);
+            _renderStats = RenderState::getStats();
+
             _light->setMVP(mvp);
         }
     }
 
+    void Scene::submit(Geometry *geometry)
+    {
+        selectLod(geometry);
+        //adaptive levels changed with the view, the fitted scale would no longer hold the budget
+        if (geometry == _importanceMesh && geometry->isAdaptiveTL() && _mvp * geometry->getModelMatrix() != _importanceMVP)
+            geometry->setImportanceScale(fitImportance(geometry).scale);
+        geometry->updateShader();
+        //preloaded programs still linking are drawn by a later frame instead of stalling this one
+        if (!geometry->isShaderReady())
+        {
+            _hasPendingShaders = true;
+            return;
+        }
+
+        if (geometry->isOctreeUsable())
+            _pointStats += geometry->selectOctreeNodes(_frustum, _viewpoint, _pixelsPerUnit, _pointBudget);
+
+        if (_doMeshletCulling && geometry->isMeshletUsable())
+        {
+            MeshletStats stats = geometry->cullMeshlets(_frustum, _viewpoint, true);
+            _meshletStats += stats;
+            if (stats.meshlets > 0 && stats.visibleTriangles == 0)
+                return;
+        }
+
+        DrawItem item;
+        item.program = geometry->getShader()->getProgramId();
+        item.material = geometry->getMaterial();
+        item.vertexArray = geometry->getVertexArray();
+        item.geometry = geometry;
+        _drawList.push_back(item);
+    }
+
+    void Scene::updateFrustum()
+    {
+        _frustum.setPlanes(_view.frustumPlanes);
+
+        //an orthographic camera sees every point along the same direction
+        if (_view.isPerspective)
+            _viewpoint = glm::vec4(_view.position, 1.0f);
+        else
+            _viewpoint = glm::vec4(_view.viewDirection, 0.0f);
+
+        //pixels covered by a unit one unit in front of the camera, the same everywhere when orthographic
+        _pixelsPerUnit = 1.0f / _view.getUnitsPerPixel(_view.position + _view.viewDirection);
+    }
+
+    bool Scene::isCulled(Geometry *geometry)
+    {
+        _cullStats.objects++;
+        if (!_doCulling)
+            return false;
+
+        //the sphere rejects most objects with one dot product per plane, the box is tighter
+        if (_frustum.isOutside(geometry->getWorldBoundingSphere()) || _frustum.isOutside(geometry->getWorldBoundingBox()))
+        {
+            _cullStats.culled++;
+            return true;
+        }
+
+        return false;
+    }
+
+    void Scene::setFrustumCulling(const bool enabled)
+    {
+        _doCulling = enabled;
+    }
+
+    void Scene::setPointBudget(const uint budget)
+    {
+        //shared by every cloud of the scene
+        _pointBudget = budget;
+    }
+
+    void Scene::setCompactVertices(const bool enabled)
+    {
+        //the buffers are laid out once, so only models loaded afterwards change
+        _compactVertices = enabled;
+    }
+
+    void Scene::setMeshletCulling(const bool enabled)
+    {
+        _doMeshletCulling = enabled;
+    }
+
+    BatchStats Scene::setBatching(const bool enabled)
+    {
+        BatchStats stats;
+        _batch.reset();
+        if (!enabled)
+            return stats;
+
+        //geometries left out keep their own draws
+        _batch.reset(new SceneBatch());
+        stats = _batch->build(_geometries);
+        if (_batch->isEmpty())
+            _batch.reset();
+
+        return stats;
+    }
+
+    void Scene::setSortedSubmission(const bool sorted)
+    {
+        //unsorted and uncached is how every draw used to set its whole state
+        RenderState::setCaching(sorted);
+    }
+
+    void Scene::updateFrameUniforms()
+    {
+        FrameUniforms frame;
+        frame.view = _modelView;
+        frame.projection = _projection;
+        frame.viewProjection = _mvp;
+        frame.viewport = glm::vec4(_view.screenSize, 0.0f, 0.0f);
+        frame.lightPosition = glm::vec4(_light->getPosition(), 1.0f);
+        UniformBlocks::updateFrame(frame);
+    }
+
+    void Scene::selectLod(Geometry *geometry)
+    {
+        if (!_doLod || !geometry->isLodUsable())
+        {
+            geometry->setLod(0);
+            return;
+        }
+
+        glm::mat4 model = geometry->getModelMatrix();
+        glm::vec4 sphere = geometry->getWorldBoundingSphere();
+        glm::vec3 center(sphere);
+        float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        if (scale <= 0.0f)
+            return;
+
+        //object units covered by a pixel at the nearest point of the bounding sphere
+        float unitsPerPixel = _view.getUnitsPerPixel(center) / scale;
+        if (_view.isPerspective)
+        {
+            float depth = _view.getDepth(center);
+            float radius = sphere.w;
+            unitsPerPixel = (depth > radius) ? unitsPerPixel * (depth - radius) / depth : 0.0f;
+        }
+
+        geometry->setLod(geometry->getLodChain().selectLevel(unitsPerPixel, _lodPixelError));
+    }
+
+    void Scene::setLevelOfDetail(const bool enabled, const float pixelError)
+    {
+        _doLod = enabled;
+        _lodPixelError = pixelError;
+    }
+
+    bool Scene::loadLodChain(Geometry *geometry)
+    {
+        if (!readLodChain(geometry))
+            return false;
+        geometry->uploadLodChain();
+
+        return true;
+    }
+
+    bool Scene::readLodChain(Geometry *geometry)
+    {
+        QString filename = geometry->getFilename() + ".lod";
+        if (geometry->getType() != GeometryType::Mesh || !geometry->isTessellable() || !QFile::exists(filename))
+            return false;
+
+        if (!geometry->getLodChain().load(filename, geometry->getPositions(), geometry->getTextureCoordinates(), geometry->getIndices()))
+        {
+            std::clog << __FUNCTION__ << ": " << filename.toStdString() << " does not match the geometry.\n";
+            return false;
+        }
+
+        return true;
+    }
+
+    bool Scene::loadOctree(Geometry *geometry)
+    {
+        if (!readOctree(geometry))
+            return false;
+        geometry->uploadOctree();
+
+        return true;
+    }
+
+    bool Scene::readOctree(Geometry *geometry)
+    {
+        if (geometry->getType() != GeometryType::Cloud || geometry->getPositions().empty())
+            return false;
+
+        //built once per capture and cached next to it, the build is the slow part for large clouds
+        PointOctree &octree = geometry->getOctree();
+        if (octree.isEmpty())
+        {
+            QString filename = geometry->getFilename() + ".octree";
+            if (!octree.load(filename, geometry->getPositions()))
+            {
+                octree.build(geometry->getPositions());
+                if (!octree.save(filename))
+                    std::clog << __FUNCTION__ << ": Unable to write the cache of " << geometry->getFilename().toStdString() << ".\n";
+            }
+        }
+
+        return true;
+    }
+
+    SimplifierStats Scene::buildLodChains()
+    {
+        SimplifierStats total;
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() != GeometryType::Mesh || !geometry->isTessellable())
+                continue;
+
+            //the chain only depends on the input mesh, so it is cached next to it
+            if (!loadLodChain(geometry))
+            {
+                SimplifierStats stats = rebuildLodChain(geometry);
+                total.collapses += stats.collapses;
+                total.rejected += stats.rejected;
+                total.milliseconds += stats.milliseconds;
+            }
+            total.levels = std::max(total.levels, geometry->getLodChain().getLevelCount());
+            total.triangles += geometry->getLodChain().isEmpty() ? geometry->getTriangleCount()
+                                                                 : geometry->getLodChain().getLevel(geometry->getLodChain().getLevelCount()-1).getTriangleCount();
+        }
+
+        return total;
+    }
+
+    SimplifierStats Scene::rebuildLodChain(Geometry *geometry)
+    {
+        LodChain &chain = geometry->getLodChain();
+        SimplifierStats stats = chain.build(geometry->getPositions(), geometry->getTextureCoordinates(), geometry->getIndices());
+        if (!chain.isEmpty() && !chain.save(geometry->getFilename() + ".lod"))
+            std::clog << __FUNCTION__ << ": Unable to write the cache of " << geometry->getFilename().toStdString() << ".\n";
+        geometry->uploadLodChain();
+
+        return stats;
+    }
+
     void Scene::addDisplacement(bool value)
     {
         foreach (Geometry *geometry, _geometries)
             geometry->addDisplacement(value);
     }
 
+    DisplacementStats Scene::updateAnimationDisplacement(const int currentFrame)
+    {
+        DisplacementStats stats;
+        if (!_loaded || currentFrame < 1 || currentFrame > static_cast<int>(_geometries.size()))
+            return stats;
+
+        Geometry *mesh = _geometries.at(currentFrame-1);
+        if (mesh->getType() != GeometryType::Mesh)
+            return stats;
+
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() == GeometryType::Cloud)
+            {
+                std::shared_ptr<TemporalDisplacement> &displacement = _temporalDisplacements[geometry->getId()];
+                if (!displacement)
+                    displacement.reset(new TemporalDisplacement());
+                //rewritten on every frame change
+                geometry->setDynamicDisplacements(true);
+                stats = displacement->update(mesh, geometry);
+            }
+        }
+
+        return stats;
+    }
+
+    void Scene::bakeDisplacementMap(const uint resolution)
+    {
+        std::vector<glm::vec3> points, displacements;
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() == GeometryType::Cloud)
+            {
+                std::vector<glm::vec3> cloudPoints = geometry->getPositions();
+                std::vector<glm::vec3> cloudDisplacements = geometry->getDisplacements();
+                points.insert(points.end(), cloudPoints.begin(), cloudPoints.end());
+                displacements.insert(displacements.end(), cloudDisplacements.begin(), cloudDisplacements.end());
+            }
+        }
+
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() == GeometryType::Mesh)
+            {
+                std::vector<uint> indices = geometry->getIndices();
+                std::vector<glm::vec2> textureCoordinates = geometry->getTextureCoordinates();
+
+                //meshes without uvs get one atlas cell per pair of triangles
+                if (!DisplacementMap::hasParameterization(textureCoordinates, indices))
+                {
+                    textureCoordinates = DisplacementMap::getAtlas(indices.size()/3, resolution);
+                    geometry->setTextureCoordinates(textureCoordinates);
+                    if (!geometry->getLodChain().isEmpty())
+                        rebuildLodChain(geometry);
+                }
+
+                DisplacementMap *displacementMap = new DisplacementMap(resolution);
+                displacementMap->bake(geometry->getPositions(), textureCoordinates, indices, points, displacements);
+                displacementMap->upload();
+                geometry->setDisplacementMap(displacementMap);
+            }
+        }
+    }
+
+    void Scene::setSurfaceMode(const int mode)
+    {
+        foreach (Geometry *geometry, _geometries)
+            geometry->setSurfaceMode(mode);
+    }
+
+    CaptureStats Scene::captureTessellation(const int currentFrame, IndexedMesh &mesh)
+    {
+        CaptureStats stats;
+        if (!_loaded || currentFrame < 1 || currentFrame > static_cast<int>(_geometries.size()))
+            return stats;
+
+        Geometry *geometry = _geometries.at(currentFrame-1);
+        if (geometry->getType() != GeometryType::Mesh)
+            return stats;
+
+        //captured with the current view, so adaptive levels match what is on screen
+        glm::mat4 mvp = updateMVP();
+        updateFrameUniforms();
+        TessellationCapture capture;
+        return capture.capture(geometry, mvp, mesh);
+    }
+
+    ImportanceStats Scene::updateTessellationImportance(const int currentFrame, const bool enabled, const uint budget)
+    {
+        ImportanceStats stats;
+        if (!_loaded || currentFrame < 1 || currentFrame > static_cast<int>(_geometries.size()))
+            return stats;
+
+        Geometry *mesh = _geometries.at(currentFrame-1);
+        if (mesh->getType() != GeometryType::Mesh || !mesh->isTessellable())
+            return stats;
+
+        if (!enabled)
+        {
+            mesh->clearImportance();
+            if (mesh == _importanceMesh)
+            {
+                _importance.reset();
+                _importanceMesh = NULL;
+            }
+            return stats;
+        }
+
+        _importance.reset(new TessellationImportance());
+        _importanceMesh = mesh;
+        _importanceBudget = budget;
+        _importance->compute(mesh->getPositions(), mesh->getIndices(), mesh->getDisplacements());
+        updateMVP();
+        stats = fitImportance(mesh);
+        mesh->setImportance(_importance->getPatchImportance(), _importance->getScale());
+
+        return stats;
+    }
+
+    ImportanceStats Scene::fitImportance(Geometry *mesh)
+    {
+        if (!mesh->isAdaptiveTL())
+            return _importance->fitBudget(mesh->getInnerTL(), mesh->getOuterTL(), _importanceBudget);
+
+        //the control shader replaces the panel levels by the projected edges, displaced if the deltas are added
+        std::vector<glm::vec3> positions = mesh->getPositions();
+        std::vector<glm::vec3> displacements = mesh->getDisplacements();
+        if (mesh->isDisplacementAdded() && displacements.size() == positions.size())
+        {
+            for (size_t i = 0; i < positions.size(); i++)
+                positions[i] += displacements[i];
+        }
+
+        _importanceMVP = _mvp * mesh->getModelMatrix();
+        std::vector<glm::vec3> levels = TessellationImportance::getAdaptiveLevels(positions, mesh->getIndices(), _importanceMVP,
+                                                                                  _view.screenSize, mesh->getPixelsPerEdge());
+        return _importance->fitBudget(levels, _importanceBudget);
+    }
+
+    FittingStats Scene::fitMesh(const int currentFrame)
+    {
+        FittingStats stats;
+        if (!_loaded || currentFrame < 1 || currentFrame > static_cast<int>(_geometries.size()))
+            return stats;
+
+        Geometry *mesh = _geometries.at(currentFrame-1);
+        if (mesh->getType() != GeometryType::Mesh)
+            return stats;
+
+        std::vector<glm::vec3> points;
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() == GeometryType::Cloud)
+            {
+                std::vector<glm::vec3> cloudPoints = geometry->getPositions();
+                points.insert(points.end(), cloudPoints.begin(), cloudPoints.end());
+            }
+        }
+        if (points.empty())
+            return stats;
+
+        //kept across frames so a sequence warm starts from the previous solution
+        if (!_meshFitting)
+            _meshFitting.reset(new MeshFitting());
+
+        stats = _meshFitting->fit(mesh, points);
+
+        //all three were built from the positions before the fit
+        rebuildGrid();
+        _distanceField.reset();
+        if (!mesh->getLodChain().isEmpty())
+            rebuildLodChain(mesh);
+
+        return stats;
+    }
+
+    std::vector<DeviationReport> Scene::analyzeDeviation(const int currentFrame, const bool colorize)
+    {
+        std::vector<DeviationReport> reports;
+        if (!_loaded || currentFrame < 1 || currentFrame > static_cast<int>(_geometries.size()))
+            return reports;
+
+        Geometry *mesh = _geometries.at(currentFrame-1);
+        if (mesh->getType() != GeometryType::Mesh)
+            return reports;
+
+        //every cloud of the scene is one scan with a report of its own
+        std::vector<Geometry*> clouds;
+        std::vector<std::vector<glm::vec3> > points;
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() == GeometryType::Cloud)
+            {
+                points.push_back(geometry->getPositions());
+                clouds.push_back(geometry);
+            }
+        }
+        if (clouds.empty())
+            return reports;
+
+        DeviationAnalysis analysis;
+        reports = analysis.analyze(mesh->getPositions(), mesh->getIndices(), points);
+        for (size_t c = 0; c < clouds.size(); c++)
+            reports[c].cloud = clouds[c]->getId();
+
+        //one range for every cloud, the last report covers all of them
+        if (colorize)
+        {
+            std::vector<glm::vec4> colors = analysis.getColors(reports.back().histogramRange);
+            size_t first = 0;
+            for (size_t c = 0; c < clouds.size(); c++)
+            {
+                clouds[c]->setColors(std::vector<glm::vec4>(colors.begin() + first, colors.begin() + first + points[c].size()));
+                first += points[c].size();
+            }
+        }
+
+        return reports;
+    }
+
+    std::vector<std::vector<DeviationReport> > Scene::analyzeSequence(QString reportFilename)
+    {
+        std::vector<std::vector<DeviationReport> > frames;
+        for (size_t f = 0; f < _geometries.size(); f++)
+        {
+            if (_geometries.at(f)->getType() == GeometryType::Mesh)
+                frames.push_back(analyzeDeviation(f+1, false));
+        }
+
+        if (!reportFilename.isEmpty())
+            DeviationAnalysis::writeReport(reportFilename, frames);
+
+        return frames;
+    }
+
     void Scene::resize(uint width, uint height)
     {
         _camera->setAspectRatio(width/height);
@@ -92,15 +625,35 @@ namespace Tessellation
 
     void Scene::loadModel(std::string path, const bool isTessellable)
     {
-        uint geometryId = _geometries.size() + 1;
-        Geometry* geometry = new Geometry(QString(path.c_str()), geometryId, isTessellable);
-        geometry->scale(glm::vec3(10.0f, 10.0f, 10.0f));
+        Geometry *previous = _geometries.empty() ? NULL : _geometries.back();
+        Geometry *geometry = createGeometry(path, _geometries.size() + 1, isTessellable, _compactVertices, previous);
         addGeometry(geometry);
         updateGrid(geometry);
     }
 
+    Geometry* Scene::createGeometry(std::string path, const uint geometryId, const bool isTessellable, const bool compactVertices,
+                                    Geometry *previous)
+    {
+        Geometry* geometry = new Geometry(QString(path.c_str()), geometryId, isTessellable);
+        geometry->scale(glm::vec3(10.0f, 10.0f, 10.0f));
+        geometry->setCompactVertices(compactVertices);
+
+        //frames of an animation keep the order of the first one, any other mesh gets its own
+        if (geometry->getType() == GeometryType::Mesh)
+        {
+            if (previous != NULL && !previous->getTriangleOrder().empty() && previous->hasSameConnectivity(geometry))
+                geometry->setTriangleOrder(previous->getTriangleOrder());
+            else
+                geometry->optimizeTriangleOrder();
+        }
+
+        return geometry;
+    }
+
     void Scene::updateGrid(Geometry *geometry)
     {
+        //filled by the upload worker too
+        QMutexLocker locker(&_gridMutex);
         if (geometry->getType() == GeometryType::Mesh)
         {
             for (int i = 0; i < geometry->getTriangleCount(); i++)
@@ -126,8 +679,20 @@ namespace Tessellation
         }
     }
 
+    void Scene::rebuildGrid()
+    {
+        {
+            QMutexLocker locker(&_gridMutex);
+            _grid.reset(new SpatialGrid(_grid->getDomain()));
+        }
+
+        foreach (Geometry *geometry, _geometries)
+            updateGrid(geometry);
+    }
+
     void Scene::updateInputPoints()
     {
+        QMutexLocker locker(&_gridMutex);
         foreach (Geometry *geometry, _geometries)
         {
             if (geometry->getType() == GeometryType::Cloud)
@@ -153,6 +718,88 @@ namespace Tessellation
         }
     }
 
+    void Scene::updateInputPointsField()
+    {
+        Geometry *mesh = NULL;
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() == GeometryType::Mesh)
+            {
+                mesh = geometry;
+                break;
+            }
+        }
+        if (mesh == NULL)
+            return;
+
+        std::vector<glm::vec3> positions = mesh->getPositions();
+        std::vector<uint> indices = mesh->getIndices();
+
+        //the field is baked once per static mesh and cached next to it
+        bool validate = false;
+        if (!_distanceField)
+        {
+            _distanceField.reset(new DistanceField());
+            QString cacheFilename = mesh->getFilename() + ".sdf";
+            if (!_distanceField->load(cacheFilename, positions, indices))
+            {
+                glm::vec3 min(std::numeric_limits<float>::max());
+                glm::vec3 max(-std::numeric_limits<float>::max());
+                foreach (glm::vec3 position, positions)
+                {
+                    min = glm::min(min, position);
+                    max = glm::max(max, position);
+                }
+                float diagonal = glm::length(max - min);
+
+                _distanceField->build(positions, indices, diagonal/256.0f, diagonal/32.0f);
+                _distanceField->save(cacheFilename);
+            }
+            validate = true;
+        }
+
+        foreach (Geometry *geometry, _geometries)
+        {
+            if (geometry->getType() == GeometryType::Cloud)
+            {
+                std::vector<glm::vec3> points = geometry->getPositions();
+                if (validate)
+                    _distanceField->validate(points, positions, indices);
+
+                std::vector<int> misses;
+                #pragma omp parallel for
+                for (int i = 0; i < static_cast<int>(points.size()); i++)
+                {
+                    glm::vec3 displacement;
+                    if (_distanceField->getDisplacement(points[i], displacement))
+                        geometry->setDisplacement(i, displacement);
+                    else
+                    {
+                        #pragma omp critical
+                        misses.push_back(i);
+                    }
+                }
+
+                //points outside the band fall back to an exact query
+                if (!misses.empty())
+                {
+                    BVH bvh(positions, indices);
+                    #pragma omp parallel for
+                    for (int m = 0; m < static_cast<int>(misses.size()); m++)
+                    {
+                        ClosestHit hit;
+                        if (bvh.getClosest(points[misses[m]], hit))
+                            geometry->setDisplacement(misses[m], hit.position - points[misses[m]]);
+                    }
+                }
+                geometry->updateDisplacementBuffer();
+
+                std::clog << __FUNCTION__ << ": " << points.size() << " points, "
+                          << misses.size() << " outside the distance field band.\n";
+            }
+        }
+    }
+
     void Scene::loadLight()
     {
         glm::vec3 worldPosition = glm::vec3(0.0, 1.0, 0.0);
@@ -164,30 +811,114 @@ namespace Tessellation
 
     void Scene::loadScene(std::string path, const bool isTessellable)
     {
+        if (_uploadWorker)
+        {
+            //parsing, reordering, the caches, the grid and the buffers all happen on the worker,
+            //the viewer keeps drawing what is loaded; only the copied values cross over
+            //the id is given when the geometry joins the scene, several imports may be in flight
+            bool compactVertices = _compactVertices;
+            _uploadWorker->upload([=]() -> Geometry*
+            {
+                Geometry *geometry = createGeometry(path, 0, isTessellable, compactVertices, NULL);
+                readLodChain(geometry);
+                readOctree(geometry);
+                updateGrid(geometry);
+                return geometry;
+            });
+            loadLight();
+            return;
+        }
+
         loadModel(path, isTessellable);
         loadLight();
 
         foreach (Geometry *geometry, _geometries)
+        {
             geometry->initialize();
+            loadLodChain(geometry);
+            loadOctree(geometry);
+        }
 
         _loaded = true;
     }
 
+    void Scene::setUploadWorker(std::shared_ptr<UploadWorker> worker)
+    {
+        _uploadWorker = worker;
+        if (_uploadWorker && !_uploadWorker->isValid())
+            _uploadWorker.reset();
+    }
+
+    bool Scene::hasPendingUploads()
+    {
+        return _uploadWorker && _uploadWorker->isPending();
+    }
+
+    void Scene::finishUploads()
+    {
+        if (!_uploadWorker)
+            return;
+
+        std::vector<Geometry*> geometries = _uploadWorker->takeReady();
+        foreach (Geometry *geometry, geometries)
+        {
+            //only the attribute layouts are recorded here, vertex arrays belong to the context drawing them
+            geometry->createVertexArray();
+            geometry->createLodVertexArrays();
+            geometry->setId(_geometries.size() + 1);
+            addGeometry(geometry);
+            _loaded = true;
+        }
+    }
+
     void Scene::loadAnimation(std::string path, const int frameCount, QProgressBar &progress)
     {
         _geometries.clear();
-        progress.setValue(0);
-        progress.setMaximum(frameCount);
+        _temporalDisplacements.clear();
+        _distanceField.reset();
+        _meshFitting.reset();
+        _importance.reset();
+        _importanceMesh = NULL;
+        _batch.reset();
         for (size_t i = 0; i < frameCount; i++)
         {
             std::string filename(std::string(path).append(std::to_string(static_cast<ll>(i))).append(".ply"));
             loadModel(filename);
-            progress.setValue(progress.value()+1);
+            //the bar belongs to the GUI thread, loads posted to the render thread report through its event loop
+            QMetaObject::invokeMethod(&progress, "setValue", Q_ARG(int, static_cast<int>(i)+1));
         }
         loadLight();
 
-        foreach (Geometry *geometry, _geometries)
+        //frames of the same topology keep their own positions and normals only
+        uint sharing = 0;
+        for (size_t i = 0; i < _geometries.size(); i++)
+        {
+            Geometry *geometry = _geometries[i];
+            if (i > 0)
+                geometry->shareBuffers(_geometries[i-1]);
             geometry->initialize();
+            loadLodChain(geometry);
+            loadOctree(geometry);
+            if (geometry->isSharingBuffers())
+                sharing++;
+        }
+
+        //playback blends every frame into the next one, the last one into the first
+        uint linked = 0;
+        for (size_t i = 0; i < _geometries.size(); i++)
+        {
+            Geometry *geometry = _geometries[i];
+            Geometry *next = _geometries[(i+1) % _geometries.size()];
+            if (geometry != next && geometry->hasSameConnectivity(next) && geometry->getTriangleOrder() == next->getTriangleOrder())
+            {
+                geometry->linkNextFrame(next);
+                if (geometry->isFrameBlendUsable())
+                    linked++;
+            }
+        }
+
+        std::clog << __FUNCTION__ << ": " << sharing << " of " << _geometries.size() << " frames share buffers, "
+                  << linked << " blend into the next.\n";
 
         _loaded = true;
     }
@@ -201,6 +932,19 @@ namespace Tessellation
                 geometry->getMaterial()->setShader("render");
     }
 
+    void Scene::setAdaptiveTessellation(const bool adaptive, const float pixelsPerEdge)
+    {
+        foreach (Geometry *geometry, _geometries)
+        {
+            geometry->setAdaptiveTL(adaptive);
+            geometry->setPixelsPerEdge(pixelsPerEdge);
+        }
+
+        //the budget was fitted against the levels of the other mode
+        if (_importanceMesh != NULL)
+            _importanceMesh->setImportanceScale(fitImportance(_importanceMesh).scale);
+    }
+
     void Scene::setLight(Light *light)
     {
         _light.reset(light);
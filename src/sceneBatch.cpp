@@ -0,0 +1,216 @@
+#include "sceneBatch.h"
+#include "renderState.h"
+
+#include <iostream>
+
+namespace Tessellation
+{
+
+    SceneBatch::SceneBatch():
+        _vertexArrayId(0),
+        _positionBuffer(0),
+        _textureBuffer(0),
+        _normalBuffer(0),
+        _indexBuffer(0),
+        _commandBuffer(0),
+        _objectBuffer(0)
+    {
+    }
+
+    SceneBatch::~SceneBatch()
+    {
+        clear();
+    }
+
+    bool SceneBatch::isSupported()
+    {
+        //GL 4.3 features, plus gl_DrawIDARB to find the object of a command
+        return GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_shader_draw_parameters;
+    }
+
+    void SceneBatch::clear()
+    {
+        if (_vertexArrayId != 0)
+        {
+            glDeleteVertexArrays(1, &_vertexArrayId);
+            glDeleteBuffers(1, &_positionBuffer);
+            glDeleteBuffers(1, &_textureBuffer);
+            glDeleteBuffers(1, &_normalBuffer);
+            glDeleteBuffers(1, &_indexBuffer);
+            glDeleteBuffers(1, &_commandBuffer);
+            glDeleteBuffers(1, &_objectBuffer);
+            _vertexArrayId = 0;
+        }
+
+        _geometries.clear();
+        _revisions.clear();
+        _objectIds.clear();
+        _commands.clear();
+        _objects.clear();
+    }
+
+    BatchStats SceneBatch::build(const std::vector<Geometry*> &geometries)
+    {
+        BatchStats stats;
+        clear();
+        if (!isSupported())
+        {
+            std::clog << __FUNCTION__ << ": Multi-draw indirect or shader draw parameters are not supported.\n";
+            return stats;
+        }
+
+        std::vector<glm::vec3> positions, normals;
+        std::vector<glm::vec2> textureCoordinates;
+        std::vector<uint> indices;
+        foreach (Geometry *geometry, geometries)
+        {
+            if (!geometry->isBatchable())
+                continue;
+
+            std::vector<glm::vec3> geometryPositions = geometry->getPositions();
+            std::vector<glm::vec3> geometryNormals = geometry->getNormals();
+            std::vector<glm::vec2> geometryTextureCoordinates = geometry->getTextureCoordinates();
+            std::vector<uint> geometryIndices = geometry->getDrawIndices();
+            if (geometryIndices.empty())
+                continue;
+
+            //indices stay relative to the geometry, baseVertex moves them into the shared range
+            DrawElementsIndirectCommand command;
+            command.count = geometryIndices.size();
+            command.instanceCount = 1;
+            command.firstIndex = indices.size();
+            command.baseVertex = positions.size();
+            command.baseInstance = 0;
+
+            //missing attributes are zero filled so that every range lines up
+            positions.insert(positions.end(), geometryPositions.begin(), geometryPositions.end());
+            if (geometryNormals.size() == geometryPositions.size())
+                normals.insert(normals.end(), geometryNormals.begin(), geometryNormals.end());
+            else
+                normals.resize(positions.size(), glm::vec3(0.0f));
+            if (geometryTextureCoordinates.size() == geometryPositions.size())
+                textureCoordinates.insert(textureCoordinates.end(), geometryTextureCoordinates.begin(), geometryTextureCoordinates.end());
+            else
+                textureCoordinates.resize(positions.size(), glm::vec2(0.0f));
+            indices.insert(indices.end(), geometryIndices.begin(), geometryIndices.end());
+
+            BatchObject object;
+            object.model = geometry->getModelMatrix();
+            object.color = reinterpret_cast<MaterialDefault*>(geometry->getMaterial())->getColor();
+
+            _objectIds[geometry] = _geometries.size();
+            _geometries.push_back(geometry);
+            _revisions.push_back(geometry->getRevision());
+            _commands.push_back(command);
+            _objects.push_back(object);
+        }
+
+        if (_geometries.empty())
+            return stats;
+
+        glGenVertexArrays(1, &_vertexArrayId);
+        RenderState::bindVertexArray(_vertexArrayId);
+
+        glGenBuffers(1, &_positionBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, _positionBuffer);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), &positions[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+        glGenBuffers(1, &_textureBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, _textureBuffer);
+        glBufferData(GL_ARRAY_BUFFER, textureCoordinates.size() * sizeof(glm::vec2), &textureCoordinates[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
+
+        glGenBuffers(1, &_normalBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, _normalBuffer);
+        glBufferData(GL_ARRAY_BUFFER, normals.size() * sizeof(glm::vec3), &normals[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 0, 0);
+
+        glGenBuffers(1, &_indexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint), &indices[0], GL_STATIC_DRAW);
+
+        RenderState::bindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+        //rewritten every frame with the visibility and the transforms
+        glGenBuffers(1, &_commandBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, _commands.size() * sizeof(DrawElementsIndirectCommand), &_commands[0], GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        glGenBuffers(1, &_objectBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _objectBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, _objects.size() * sizeof(BatchObject), &_objects[0], GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        stats.objects = _geometries.size();
+        stats.vertices = positions.size();
+        stats.indices = indices.size();
+        std::clog << __FUNCTION__ << ": " << stats.objects << " objects, " << stats.vertices << " vertices and "
+                  << stats.indices << " indices in shared buffers.\n";
+
+        return stats;
+    }
+
+    bool SceneBatch::isStale()
+    {
+        for (size_t i = 0; i < _geometries.size(); i++)
+            if (_geometries[i]->getRevision() != _revisions[i])
+                return true;
+
+        return false;
+    }
+
+    void SceneBatch::begin()
+    {
+        for (size_t i = 0; i < _commands.size(); i++)
+            _commands[i].instanceCount = 0;
+    }
+
+    bool SceneBatch::submit(Geometry *geometry)
+    {
+        std::map<Geometry*, uint>::iterator it = _objectIds.find(geometry);
+        if (it == _objectIds.end() || !geometry->isBatchable())
+            return false;
+
+        //a zero instance count skips the command without touching the others
+        uint id = it->second;
+        _commands[id].instanceCount = 1;
+        _objects[id].model = geometry->getModelMatrix();
+        _objects[id].color = reinterpret_cast<MaterialDefault*>(geometry->getMaterial())->getColor();
+
+        return true;
+    }
+
+    void SceneBatch::draw()
+    {
+        Shader *shader = Shaders::getShader("render", QStringList() << "BATCHED");
+        if (_geometries.empty() || shader == NULL)
+            return;
+
+        RenderState::setCapability(GL_DEPTH_TEST, true);
+        RenderState::setCapability(GL_CULL_FACE, false);
+        RenderState::setCapability(GL_BLEND, false);
+        RenderState::useProgram(shader->getProgramId());
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, _objectBuffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, _objects.size() * sizeof(BatchObject), &_objects[0]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BATCH_BLOCK_BINDING, _objectBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        RenderState::bindVertexArray(_vertexArrayId);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commandBuffer);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, _commands.size() * sizeof(DrawElementsIndirectCommand), &_commands[0]);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, _commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        RenderState::countCalls(7);
+        RenderState::countDraw();
+    }
+
+}
@@ -2,18 +2,24 @@
 #include "sceneViewer.h"
 
 #include <QKeyEvent>
+#include <QTimer>
 
 namespace Tessellation
 {
 
     #define USE_KEYBOARD 0
+    #define USE_RENDER_THREAD 1
 
     SceneViewer::SceneViewer(Ui_MainWindow *userInterface, QGLFormat glFormat):
         QGLViewer(glFormat),
         _isInitialized(false),
         _isWireframe(false),
         _currentFrame(1),
-        _isTessellated(false)
+        _isTessellated(false),
+        _isDisplaced(false),
+        _reportRenderStats(false),
+        _frameBlend(0.0f),
+        _maxTessellationLevel(0)
     {
         _userInterface = userInterface;
         resize(1024, 768);
@@ -21,6 +27,12 @@ namespace Tessellation
 
     SceneViewer::~SceneViewer()
     {
+        //the scene releases its objects on the GUI thread, with the context back
+        if (_renderThread)
+        {
+            _renderThread->stop();
+            makeCurrent();
+        }
     }
 
     void SceneViewer::init()
@@ -35,38 +47,147 @@ namespace Tessellation
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
         glewExperimental = GL_TRUE;
         glewInit();
+        glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &_maxTessellationLevel);
 
         _renderer.reset(new Renderer());
         _scene.reset(new Scene(this->camera()));
         _scene->initialize(1024, 768);
         _renderer->initialize(_scene.get());
 
+        //models imported later upload on a second context, the first one stays synchronous
+        std::shared_ptr<UploadWorker> uploadWorker(new UploadWorker(context()->contextHandle()));
+        connect(uploadWorker.get(), SIGNAL(uploaded()), this, SLOT(update()));
+        _scene->setUploadWorker(uploadWorker);
+
         _isInitialized = true;
     }
 
+    void SceneViewer::startRenderThread()
+    {
+        //from here on the context belongs to the render thread and every scene change is posted to it
+        setAutoBufferSwap(false);
+        doneCurrent();
+        _renderThread.reset(new RenderThread(this));
+        context()->moveToThread(_renderThread.get());
+        _renderThread->start();
+    }
+
+    void SceneViewer::post(const RenderCommand &command)
+    {
+        if (_renderThread)
+            _renderThread->post(command);
+        else
+        {
+            makeCurrent();
+            command();
+        }
+    }
+
+    void SceneViewer::showMessage(QString message, int timeout)
+    {
+        //queued when called from the render thread
+        QMetaObject::invokeMethod(_userInterface->statusBar, "showMessage", Q_ARG(QString, message), Q_ARG(int, timeout));
+    }
+
+    bool SceneViewer::isAnimationShown()
+    {
+        return animationIsStarted() || _userInterface->widgetPlayer->isVisible() || _currentFrame != 1;
+    }
+
+    void SceneViewer::reset()
+    {
+        post([=]() {_scene->reset();});
+        update();
+    }
+
     void SceneViewer::loadAnimation(std::string path, const int frameCount)
     {
         _animationPath = path.substr(0, path.length()-5);
         _player.reset(new ScenePlayer(frameCount));
+        //the player keeps the capture rate, every display refresh shows a blended frame
+        setAnimationPeriod(0);
         _userInterface->sFrames->setValue(1);
         _userInterface->sFrames->setMinimum(1);
         _userInterface->sFrames->setMaximum(frameCount);
-        _scene->loadAnimation(_animationPath, frameCount, *_userInterface->progressBar);
+        _userInterface->progressBar->setValue(0);
+        _userInterface->progressBar->setMaximum(frameCount);
+
+        std::string animationPath = _animationPath;
+        QProgressBar *progress = _userInterface->progressBar;
+        post([=]()
+        {
+            _scene->loadAnimation(animationPath, frameCount, *progress);
+            QMetaObject::invokeMethod(progress, "setVisible", Q_ARG(bool, false));
+        });
+        update();
     }
 
     void SceneViewer::loadModel(std::string path)
     {
-        _scene->loadScene(path);
+        post([=]() {_scene->loadScene(path);});
+        update();
     }
 
     void SceneViewer::loadInputPoints(std::string path)
     {
-        _scene->loadScene(path, false);
+        post([=]() {_scene->loadScene(path, false);});
+        update();
     }
 
     void SceneViewer::updateInputPoints()
     {
-        _scene->updateInputPoints();
+        post([=]() {_scene->updateInputPoints();});
+        update();
+    }
+
+    void SceneViewer::updateInputPointsField()
+    {
+        post([=]() {_scene->updateInputPointsField();});
+        update();
+    }
+
+    void SceneViewer::bakeDisplacementMap()
+    {
+        post([=]() {_scene->bakeDisplacementMap();});
+        update();
+    }
+
+    void SceneViewer::fitMesh()
+    {
+        int currentFrame = _currentFrame;
+        post([=]()
+        {
+            FittingStats stats = _scene->fitMesh(currentFrame);
+            if (stats.vertices > 0)
+                showMessage(QString("Fitting: %1 vertices, %2 iterations, %3 ms")
+                            .arg(stats.vertices).arg(stats.iterations)
+                            .arg(stats.milliseconds, 0, 'f', 1), 2000);
+        });
+        update();
+    }
+
+    void SceneViewer::analyzeDeviation()
+    {
+        int currentFrame = _currentFrame;
+        bool isSequence = (_player != NULL);
+        post([=]()
+        {
+            //batch QA over the whole sequence, one csv row per frame and cloud
+            if (isSequence)
+                _scene->analyzeSequence("data/saves/deviation.csv");
+
+            std::vector<DeviationReport> reports = _scene->analyzeDeviation(currentFrame);
+            if (reports.empty() || reports.back().points == 0)
+                return;
+
+            //the last report is the only cloud or all of them together
+            QStringList lines;
+            foreach (const DeviationReport &report, reports)
+                lines << QString("%1: rms %2, max %3, hausdorff %4")
+                         .arg(report.cloud > 0 ? QString("cloud %1").arg(report.cloud) : QString("all clouds"))
+                         .arg(report.rms).arg(report.cloudToMesh).arg(report.hausdorff);
+            showMessage(QString("Deviation of ").append(lines.join(" | ")), 5000);
+        });
         update();
     }
 
@@ -75,22 +196,22 @@ namespace Tessellation
         _isTessellated = value;
         if (value)
             initializeTS();
-        _scene->updateObjectShaders(value);
+        post([=]() {_scene->updateObjectShaders(value);});
         update();
     }
 
     void SceneViewer::toggleDisplacement(bool value)
     {
-        _scene->addDisplacement(value);
+        _isDisplaced = value;
+        post([=]() {_scene->addDisplacement(value);});
         update();
     }
 
     void SceneViewer::initializeTS()
     {
-        GLint maxPatchVertices = 0;
-        glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxPatchVertices);
-        _userInterface->sInnerLevel->setMaximum(maxPatchVertices);
-        _userInterface->sOuterLevel->setMaximum(maxPatchVertices);
+        //queried by init, the context may belong to the render thread by now
+        _userInterface->sInnerLevel->setMaximum(_maxTessellationLevel);
+        _userInterface->sOuterLevel->setMaximum(_maxTessellationLevel);
     }
 
     bool SceneViewer::isReady()
@@ -113,13 +234,77 @@ namespace Tessellation
 
     void SceneViewer::setInnerTL(int value)
     {
-        _scene->getGeometry(_currentFrame-1)->setInnerTL(value);
+        int currentFrame = _currentFrame;
+        post([=]() {_scene->getGeometry(currentFrame-1)->setInnerTL(value);});
         update();
     }
 
     void SceneViewer::setOuterTL(int value)
     {
-        _scene->getGeometry(_currentFrame-1)->setOuterTL(value);
+        int currentFrame = _currentFrame;
+        post([=]() {_scene->getGeometry(currentFrame-1)->setOuterTL(value);});
+        update();
+    }
+
+    void SceneViewer::setAdaptiveTL(bool adaptive, float pixelsPerEdge)
+    {
+        post([=]() {_scene->setAdaptiveTessellation(adaptive, pixelsPerEdge);});
+        update();
+    }
+
+    void SceneViewer::exportTessellation(QString filename)
+    {
+        int currentFrame = _currentFrame;
+        post([=]()
+        {
+            IndexedMesh mesh;
+            CaptureStats stats = _scene->captureTessellation(currentFrame, mesh);
+            if (mesh.getTriangleCount() > 0 && MeshExporter::write(filename, mesh))
+                showMessage(QString("Export: %1 triangles, %2 vertices to %3")
+                            .arg(mesh.getTriangleCount()).arg(stats.vertices).arg(filename), 2000);
+            else
+                showMessage(QString("Export: nothing captured, is tessellation enabled?"), 2000);
+        });
+    }
+
+    void SceneViewer::setLevelOfDetail(bool enabled)
+    {
+        post([=]() {_scene->setLevelOfDetail(enabled, 1.0f);});
+        update();
+    }
+
+    void SceneViewer::buildLodChains()
+    {
+        post([=]()
+        {
+            SimplifierStats stats = _scene->buildLodChains();
+            if (stats.levels > 0)
+                showMessage(QString("LOD: %1 levels, %2 triangles at the coarsest, %3 ms")
+                            .arg(stats.levels).arg(stats.triangles)
+                            .arg(stats.milliseconds, 0, 'f', 1), 2000);
+            else
+                showMessage(QString("LOD: no mesh to simplify"), 2000);
+        });
+        update();
+    }
+
+    void SceneViewer::setSurfaceMode(int mode)
+    {
+        post([=]() {_scene->setSurfaceMode(mode);});
+        update();
+    }
+
+    void SceneViewer::updateTessellationImportance(bool enabled, uint budget)
+    {
+        int currentFrame = _currentFrame;
+        post([=]()
+        {
+            ImportanceStats stats = _scene->updateTessellationImportance(currentFrame, enabled, budget);
+            if (stats.patches > 0)
+                showMessage(QString("Importance: %1 of %2 primitives (scale %3)")
+                            .arg(stats.primitives).arg(stats.maxPrimitives)
+                            .arg(stats.scale, 0, 'f', 2), 2000);
+        });
         update();
     }
 
@@ -128,27 +313,226 @@ namespace Tessellation
         _renderer->resize(width, height);
     }
 
+    void SceneViewer::resizeEvent(QResizeEvent *event)
+    {
+        if (!_renderThread)
+        {
+            QGLViewer::resizeEvent(event);
+            return;
+        }
+
+        //the widget part only, the GL part is a message like any other
+        QWidget::resizeEvent(event);
+        int width = event->size().width();
+        int height = event->size().height();
+        post([=]() {resizeGL(width, height);});
+        update();
+    }
+
+    void SceneViewer::paintEvent(QPaintEvent *event)
+    {
+        //the first paint initializes the context on the GUI thread, every later one only asks for a frame
+        if (!_renderThread)
+        {
+            QGLViewer::paintEvent(event);
+    #if USE_RENDER_THREAD
+            if (_isInitialized)
+                startRenderThread();
+    #endif
+            return;
+        }
+
+        requestFrame();
+    }
+
+    void SceneViewer::updateGL()
+    {
+        if (_renderThread)
+            requestFrame();
+        else
+            QGLViewer::updateGL();
+    }
+
+    void SceneViewer::requestFrame()
+    {
+        FrameSnapshot snapshot;
+        snapshot.view = ViewSnapshot(camera());
+        snapshot.currentFrame = _currentFrame;
+        snapshot.animation = isAnimationShown();
+        snapshot.frameBlend = _frameBlend;
+
+        //the render thread is still busy with earlier frames, the view at the retry is the newest one anyway
+        if (!_renderThread->requestFrame(snapshot))
+            QTimer::singleShot(5, this, SLOT(update()));
+    }
+
+    bool SceneViewer::renderFrame(const FrameSnapshot &snapshot)
+    {
+        _scene->setView(snapshot.view);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        drawScene(snapshot.currentFrame, snapshot.animation, snapshot.frameBlend);
+
+        //read back before the swap, the back buffer is undefined afterwards
+        if (!_snapshotFilename.isEmpty())
+        {
+            grabFrameBuffer().save(_snapshotFilename);
+            _snapshotFilename.clear();
+        }
+        swapBuffers();
+
+        return _scene->hasPendingUploads() || _scene->hasPendingShaders();
+    }
+
+    void SceneViewer::saveSnapshot(const QString &filename)
+    {
+        if (!_renderThread)
+        {
+            QGLViewer::saveSnapshot(filename);
+            return;
+        }
+
+        post([=]() {_snapshotFilename = filename;});
+        update();
+    }
+
     void SceneViewer::setCurrentFrame(const int currentFrame)
     {
         _currentFrame = currentFrame;
+        if (_player && _player->isPaused())
+        {
+            _player->seek(_currentFrame);
+            _frameBlend = 0.0f;
+        }
+        if (_isDisplaced && _player)
+        {
+            post([=]()
+            {
+                DisplacementStats stats = _scene->updateAnimationDisplacement(currentFrame);
+                if (stats.queries > 0)
+                    showMessage(QString("Displacement: %1% hits, %2 ms")
+                                .arg(100.0f * stats.getHitRate(), 0, 'f', 1)
+                                .arg(stats.milliseconds, 0, 'f', 2), 1000);
+            });
+        }
         update();
     }
 
     void SceneViewer::animate()
     {
-        _currentFrame = _player->getNextFrame();
+        double position = _player->getPosition();
+        _currentFrame = static_cast<int>(position);
+        _frameBlend = position - _currentFrame;
         _userInterface->sFrames->setValue(_currentFrame);
     }
 
     void SceneViewer::draw()
     {
-        bool animation = (animationIsStarted() || _userInterface->widgetPlayer->isVisible() || _currentFrame != 1);
-        _renderer->render(_currentFrame, animation);
+        drawScene(_currentFrame, isAnimationShown(), _frameBlend);
+        //fences not signaled yet and programs still linking are polled again next frame
+        if (_scene->hasPendingUploads() || _scene->hasPendingShaders())
+            update();
+    }
+
+    void SceneViewer::drawScene(const int currentFrame, const bool animation, const float frameBlend)
+    {
+        _scene->setFrameBlend(frameBlend);
+        _renderer->render(currentFrame, animation);
+
+        if (_reportRenderStats)
+        {
+            RenderStats stats = _scene->getRenderStats();
+            CullStats cullStats = _scene->getCullStats();
+            QString message = QString("Draw: %1 GL calls for %2 draws (%3 programs, %4 vertex arrays, %5 skipped), %6, %7 of %8 objects culled")
+                              .arg(stats.calls).arg(stats.submissions).arg(stats.programs).arg(stats.vertexArrays)
+                              .arg(stats.skipped).arg(RenderState::isCaching() ? "sorted" : "unsorted")
+                              .arg(cullStats.culled).arg(cullStats.objects);
+            MeshletStats meshletStats = _scene->getMeshletStats();
+            if (meshletStats.meshlets > 0)
+                message += QString(", %1 of %2 meshlets culled (%3 facing away), %4 of %5 triangles drawn")
+                           .arg(meshletStats.culled + meshletStats.backfacing).arg(meshletStats.meshlets)
+                           .arg(meshletStats.backfacing).arg(meshletStats.visibleTriangles).arg(meshletStats.triangles);
+            OctreeStats pointStats = _scene->getPointStats();
+            if (pointStats.points > 0)
+                message += QString(", %1 of %2 points in %3 of %4 nodes")
+                           .arg(pointStats.selectedPoints).arg(pointStats.points)
+                           .arg(pointStats.selectedNodes).arg(pointStats.nodes);
+            std::clog << __FUNCTION__ << ": " << message.toStdString() << ".\n";
+            showMessage(message, 2000);
+            _reportRenderStats = false;
+        }
+    }
+
+    void SceneViewer::setBatching(bool enabled)
+    {
+        post([=]()
+        {
+            BatchStats stats = _scene->setBatching(enabled);
+            if (enabled && stats.objects > 0)
+                showMessage(QString("Batch: %1 objects, %2 vertices in shared buffers")
+                            .arg(stats.objects).arg(stats.vertices), 2000);
+            else if (enabled)
+                showMessage(QString("Batch: nothing to batch or not supported"), 2000);
+            _reportRenderStats = true;
+        });
+        update();
+    }
+
+    void SceneViewer::setFrustumCulling(bool enabled)
+    {
+        post([=]()
+        {
+            _scene->setFrustumCulling(enabled);
+            _reportRenderStats = true;
+        });
+        update();
+    }
+
+    void SceneViewer::setPointBudget(uint budget)
+    {
+        //the default values are set before the context exists, the scene starts with the same budget
+        if (!_isInitialized)
+            return;
+
+        post([=]()
+        {
+            _scene->setPointBudget(budget);
+            _reportRenderStats = true;
+        });
+        update();
+    }
+
+    void SceneViewer::setMeshletCulling(bool enabled)
+    {
+        //meshlets are built on the first cull and upload an index buffer
+        post([=]()
+        {
+            _scene->setMeshletCulling(enabled);
+            _reportRenderStats = true;
+        });
+        update();
+    }
+
+    void SceneViewer::setCompactVertices(bool enabled)
+    {
+        if (!_isInitialized)
+            return;
+
+        post([=]() {_scene->setCompactVertices(enabled);});
+    }
+
+    void SceneViewer::setSortedSubmission(bool sorted)
+    {
+        post([=]()
+        {
+            _scene->setSortedSubmission(sorted);
+            _reportRenderStats = true;
+        });
+        update();
     }
 
     void SceneViewer::showInputPoints(bool value)
     {
-        _scene->showInputPoints(value);
+        post([=]() {_scene->showInputPoints(value);});
         update();
     }
 
@@ -172,11 +556,9 @@ namespace Tessellation
     #endif
             case Qt::Key_Z:
             {
-                if (_isWireframe)
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-                else
-                    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
                 _isWireframe = !_isWireframe;
+                GLenum mode = _isWireframe ? GL_LINE : GL_FILL;
+                post([=]() {glPolygonMode(GL_FRONT_AND_BACK, mode);});
             }
             break;
             case Qt::Key_1:
@@ -1,5 +1,14 @@
 #include "shader.h"
+#include "uniformBuffer.h"
+#include "renderState.h"
 
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <vector>
@@ -11,10 +20,15 @@
 namespace Tessellation
 {
 
-    Shader::Shader(QString value, QString filename, bool doTessellation)
+    Shader::Shader(QString value, QString filename, bool doTessellation, QStringList defines):
+        _programId(0),
+        _isCached(false)
     {
         _value = value;
         _doTessellation = doTessellation;
+        _defines = defines;
+        if (doTessellation)
+            _defines.prepend("TESSELLATION");
 
         _shaderFilenames.append(QString(filename).append(".vs"));
         if (doTessellation)
@@ -55,8 +69,111 @@ namespace Tessellation
         return content;
     }
 
-    void Shader::load(QStringList attributes, QStringList uniforms)
+    QByteArray Shader::getSource(QString path)
+    {
+        char* content = loadShaderFile(path);
+        if (content == NULL)
+        {
+            std::clog << __FUNCTION__ << ": Unable to read " << path.toStdString() << ".\n";
+            return QByteArray();
+        }
+        QByteArray source(content);
+        delete[] content;
+
+        //defines have to follow #version, #line keeps the compiler messages on the lines of the file
+        int versionEnd = source.startsWith("#version") ? source.indexOf('\n') + 1 : 0;
+        QByteArray preamble;
+        foreach (QString define, _defines)
+            preamble.append("#define ").append(define.toLatin1()).append('\n');
+        preamble.append(QString("#line %1\n").arg(versionEnd > 0 ? 2 : 1).toLatin1());
+        source.insert(versionEnd, preamble);
+
+        return source;
+    }
+
+    QString Shader::getCacheFilename(const std::vector<QByteArray> &sources, QStringList attributes)
+    {
+        //the sources already carry the defines, the driver strings catch driver updates
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        for (size_t i = 0; i < sources.size(); i++)
+            hash.addData(sources[i]);
+        hash.addData(_defines.join(",").toLatin1());
+        hash.addData(attributes.join(",").toLatin1());
+        hash.addData(_feedbackVaryings.join(",").toLatin1());
+        GLenum strings[] = {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION};
+        for (int i = 0; i < 4; i++)
+        {
+            const GLubyte *value = glGetString(strings[i]);
+            if (value != NULL)
+                hash.addData(reinterpret_cast<const char*>(value));
+        }
+
+        return QString("data/cache/shaders/%1.bin").arg(QString(hash.result().toHex()));
+    }
+
+    bool Shader::loadBinary()
+    {
+        QFile file(_cacheFilename);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        //binary format, then the binary
+        QByteArray data = file.readAll();
+        if (data.size() <= static_cast<int>(sizeof(GLenum)))
+            return false;
+        GLenum format;
+        memcpy(&format, data.constData(), sizeof(GLenum));
+        glProgramBinary(_programId, format, data.constData() + sizeof(GLenum), data.size() - sizeof(GLenum));
+
+        //a driver may still refuse its own binary, the sources are always there
+        GLint result = GL_FALSE;
+        glGetProgramiv(_programId, GL_LINK_STATUS, &result);
+        if (result == GL_TRUE)
+            return true;
+
+        std::clog << __FUNCTION__ << ": " << _cacheFilename.toStdString() << " rejected, " << _value.toStdString() << " is compiled.\n";
+        glDeleteProgram(_programId);
+        _programId = glCreateProgram();
+
+        return false;
+    }
+
+    void Shader::saveBinary()
     {
+        GLint length = 0;
+        glGetProgramiv(_programId, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+
+        QByteArray data(sizeof(GLenum) + length, 0);
+        GLenum format = 0;
+        glGetProgramBinary(_programId, length, NULL, &format, data.data() + sizeof(GLenum));
+        memcpy(data.data(), &format, sizeof(GLenum));
+
+        QDir().mkpath(QFileInfo(_cacheFilename).path());
+        QFile file(_cacheFilename);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+            std::clog << __FUNCTION__ << ": Unable to write " << _cacheFilename.toStdString() << ".\n";
+    }
+
+    void Shader::compile(QStringList attributes)
+    {
+        if (_programId != 0)
+            return;
+
+        std::vector<QByteArray> sources;
+        for (int i = 0; i < _shaderFilenames.size(); i++)
+            sources.push_back(getSource(_shaderFilenames.at(i)));
+
+        _programId = glCreateProgram();
+        if (Shaders::isBinaryCacheSupported())
+        {
+            _cacheFilename = getCacheFilename(sources, attributes);
+            _isCached = loadBinary();
+            if (_isCached)
+                return;
+        }
+
         _shaderIds.push_back(glCreateShader(GL_VERTEX_SHADER));
         if (_doTessellation)
         {
@@ -66,51 +183,110 @@ namespace Tessellation
         }
         _shaderIds.push_back(glCreateShader(GL_FRAGMENT_SHADER));
 
-        GLint result = GL_FALSE;
-        int infoLogLength;
-
-        _programId = glCreateProgram();
+        //no status is read here, any query would wait for the compiler
         for (size_t i = 0; i < _shaderIds.size(); i++)
         {
-            const char* shaderSourcePointer = loadShaderFile(_shaderFilenames.at(i).toLatin1());
+            const char* shaderSourcePointer = sources[i].constData();
             glShaderSource(_shaderIds[i], 1, &shaderSourcePointer, NULL);
             glCompileShader(_shaderIds[i]);
+            glAttachShader(_programId, _shaderIds[i]);
+        }
 
-            glGetShaderiv(_shaderIds[i], GL_COMPILE_STATUS, &result);
-            glGetShaderiv(_shaderIds[i], GL_INFO_LOG_LENGTH, &infoLogLength);
-            std::vector<char> shaderErrorMessage(infoLogLength);
-            glGetShaderInfoLog(_shaderIds[i], infoLogLength, NULL, &shaderErrorMessage[0]);
+        //every variant shares the same attribute locations, even when one is optimized out
+        for (int i = 0; i < attributes.size(); i++)
+            glBindAttribLocation(_programId, i, attributes.at(i).toLatin1());
 
-            if (shaderErrorMessage[0] != NULL)
-            {
-                std::vector<char> shaderErrorMessage(infoLogLength+1);
-                glGetShaderInfoLog(_shaderIds[i], infoLogLength, NULL, &shaderErrorMessage[0]);
-                std::cout << &shaderErrorMessage[0] << std::endl;
-            }
-            glAttachShader(_programId, _shaderIds[i]);
+        //captured outputs have to be declared before linking
+        if (!_feedbackVaryings.isEmpty())
+        {
+            std::vector<QByteArray> names;
+            std::vector<const char*> varyings;
+            foreach (QString varying, _feedbackVaryings)
+                names.push_back(varying.toLatin1());
+            for (size_t i = 0; i < names.size(); i++)
+                varyings.push_back(names[i].constData());
+            glTransformFeedbackVaryings(_programId, varyings.size(), &varyings[0], GL_INTERLEAVED_ATTRIBS);
         }
+        if (!_cacheFilename.isEmpty())
+            glProgramParameteri(_programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
         glLinkProgram(_programId);
+    }
 
-        glGetProgramiv(_programId, GL_LINK_STATUS, &result);
-        glGetProgramiv(_programId, GL_INFO_LOG_LENGTH, &infoLogLength);
-        std::vector<char> programErrorMessage(std::max(infoLogLength, int(1)));
-        glGetProgramInfoLog(_programId, infoLogLength, NULL, &programErrorMessage[0]);
+    bool Shader::isReady()
+    {
+        if (_programId == 0)
+            return false;
+        if (_isCached || !Shaders::isParallelCompileSupported())
+            return true;
+
+        GLint completed = GL_FALSE;
+        glGetProgramiv(_programId, GL_COMPLETION_STATUS_KHR, &completed);
+        return completed == GL_TRUE;
+    }
 
-        if (programErrorMessage[0] != NULL)
+    void Shader::load(QStringList attributes, QStringList uniforms)
+    {
+        compile(attributes);
+
+        if (!_isCached)
         {
-            std::vector<char> programErrorMessage(infoLogLength+1);
-            glGetShaderInfoLog(_programId, infoLogLength, NULL, &programErrorMessage[0]);
-            std::cout << &programErrorMessage[0] << std::endl;
+            GLint result = GL_FALSE;
+            int infoLogLength;
+            for (size_t i = 0; i < _shaderIds.size(); i++)
+            {
+                glGetShaderiv(_shaderIds[i], GL_COMPILE_STATUS, &result);
+                glGetShaderiv(_shaderIds[i], GL_INFO_LOG_LENGTH, &infoLogLength);
+                std::vector<char> shaderErrorMessage(std::max(infoLogLength, int(1)));
+                glGetShaderInfoLog(_shaderIds[i], infoLogLength, NULL, &shaderErrorMessage[0]);
+
+                if (shaderErrorMessage[0] != NULL)
+                {
+                    std::vector<char> shaderErrorMessage(infoLogLength+1);
+                    glGetShaderInfoLog(_shaderIds[i], infoLogLength, NULL, &shaderErrorMessage[0]);
+                    std::cout << &shaderErrorMessage[0] << std::endl;
+                }
+            }
+
+            glGetProgramiv(_programId, GL_LINK_STATUS, &result);
+            glGetProgramiv(_programId, GL_INFO_LOG_LENGTH, &infoLogLength);
+            std::vector<char> programErrorMessage(std::max(infoLogLength, int(1)));
+            glGetProgramInfoLog(_programId, infoLogLength, NULL, &programErrorMessage[0]);
+
+            if (programErrorMessage[0] != NULL)
+            {
+                std::vector<char> programErrorMessage(infoLogLength+1);
+                glGetShaderInfoLog(_programId, infoLogLength, NULL, &programErrorMessage[0]);
+                std::cout << &programErrorMessage[0] << std::endl;
+            }
+
+            //only programs that linked are worth loading next time
+            if (result == GL_TRUE && !_cacheFilename.isEmpty())
+                saveBinary();
+
+            for (size_t i = 0; i < _shaderIds.size(); i++)
+                glDeleteShader(_shaderIds[i]);
         }
 
         _matrixId = glGetUniformLocation(_programId, "mvp");
 
-        for (size_t i = 0; i < _shaderIds.size(); i++)
-            glDeleteShader(_shaderIds[i]);
+        //blocks shared by every program, GLSL 4.0 cannot declare their binding
+        GLuint frameBlock = glGetUniformBlockIndex(_programId, "FrameBlock");
+        if (frameBlock != GL_INVALID_INDEX)
+            glUniformBlockBinding(_programId, frameBlock, FRAME_BLOCK_BINDING);
+        GLuint objectBlock = glGetUniformBlockIndex(_programId, "ObjectBlock");
+        if (objectBlock != GL_INVALID_INDEX)
+            glUniformBlockBinding(_programId, objectBlock, OBJECT_BLOCK_BINDING);
+        //storage blocks need GL 4.3, only the batched variant declares one
+        if (_defines.contains("BATCHED"))
+        {
+            GLuint batchBlock = glGetProgramResourceIndex(_programId, GL_SHADER_STORAGE_BLOCK, "BatchBlock");
+            if (batchBlock != GL_INVALID_INDEX)
+                glShaderStorageBlockBinding(_programId, batchBlock, BATCH_BLOCK_BINDING);
+        }
 
         bind();
-        foreach (QString attribute, attributes)
-            _attributes.insert(attribute, glGetAttribLocation(_programId, attribute.toLatin1()));
+        for (int i = 0; i < attributes.size(); i++)
+            _attributes.insert(attributes.at(i), i);
 
         foreach (QString uniform, uniforms)
             _uniforms.insert(uniform, glGetUniformLocation(_programId, uniform.toLatin1()));
@@ -119,7 +295,7 @@ namespace Tessellation
     void Shader::enable()
     {
         std::clog << __FUNCTION__ << std::endl;
-        glUseProgram(_programId);
+        RenderState::useProgram(_programId);
     }
 
     void Shader::disable()
@@ -128,7 +304,7 @@ namespace Tessellation
         glDisableVertexAttribArray(1);
 
         glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glUseProgram(0);
+        RenderState::useProgram(0);
     }
 
     GLint Shader::getVariable(std::string strVariable)
@@ -141,7 +317,7 @@ namespace Tessellation
 
     void Shader::bind()
     {
-        glUseProgram(_programId);
+        RenderState::useProgram(_programId);
     }
 
     uint Shader::getAttribute(QString name)
@@ -149,11 +325,6 @@ namespace Tessellation
         return _attributes.value(name);
     }
 
-    uint Shader::getUniform(QString name)
-    {
-        return _uniforms.value(name);
-    }
-
     void Shader::transmitUniform(QString name, int i)
     {
         glUniform1i(_uniforms.value(name, -1), i);
@@ -200,23 +371,124 @@ namespace Tessellation
     }
 
     //Shaders database
+    QHash<QString, ShaderSource> Shaders::_sources;
     QHash<QString, Shader*> Shaders::_shaders;
+    QHash<QString, Shader*> Shaders::_pending;
+
+    void Shaders::clear()
+    {
+        foreach (Shader *shader, _shaders)
+            delete shader;
+        foreach (Shader *shader, _pending)
+            delete shader;
+        _shaders.clear();
+        _pending.clear();
+        _sources.clear();
+    }
+
+    bool Shaders::isBinaryCacheSupported()
+    {
+        if (!GLEW_ARB_get_program_binary)
+            return false;
+
+        //some drivers expose the entry points without a single format
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    bool Shaders::isParallelCompileSupported()
+    {
+        //looked up by name, the extension is younger than most GLEW releases
+        static int supported = -1;
+        if (supported < 0)
+        {
+            supported = 0;
+            GLint count = 0;
+            glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+            for (GLint i = 0; i < count && supported == 0; i++)
+            {
+                const char *name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+                if (name != NULL && (strcmp(name, "GL_KHR_parallel_shader_compile") == 0 || strcmp(name, "GL_ARB_parallel_shader_compile") == 0))
+                    supported = 1;
+            }
+        }
+
+        return supported == 1;
+    }
+
+    void Shaders::preload(QString value, const QStringList &defines)
+    {
+        QString key = getKey(value, defines);
+        if (_shaders.contains(key) || _pending.contains(key) || !_sources.contains(value))
+            return;
+
+        const ShaderSource &source = _sources[value];
+        Shader *shader = new Shader(key, source.path, source.doTessellation, defines);
+        shader->setFeedbackVaryings(source.feedbackVaryings);
+        shader->compile(source.attributes);
+        _pending.insert(key, shader);
+    }
 
-    Shader* Shaders::getShader(QString value)
+    bool Shaders::isReady(QString value, const QStringList &defines)
     {
-        if (_shaders.contains(value))
-            return _shaders.value(value);
+        Shader *shader = _pending.value(getKey(value, defines), NULL);
+        return shader == NULL || shader->isReady();
     }
-    void Shaders::addShader(QString value, QStringList attributes, QStringList uniforms, bool doTessellation)
+
+    QString Shaders::getKey(QString value, QStringList defines)
+    {
+        if (defines.isEmpty())
+            return value;
+
+        defines.sort();
+        return QString("%1[%2]").arg(value).arg(defines.join(","));
+    }
+
+    Shader* Shaders::getShader(QString value, const QStringList &defines)
+    {
+        QString key = getKey(value, defines);
+        if (_shaders.contains(key))
+            return _shaders.value(key);
+
+        if (!_sources.contains(value))
+            return NULL;
+
+        QElapsedTimer timer;
+        timer.start();
+        const ShaderSource &source = _sources[value];
+        //preloaded variants only wait for whatever the driver has not finished yet
+        Shader *shader = _pending.take(key);
+        if (shader == NULL)
+        {
+            shader = new Shader(key, source.path, source.doTessellation, defines);
+            shader->setFeedbackVaryings(source.feedbackVaryings);
+        }
+        shader->load(source.attributes, source.uniforms);
+        _shaders.insert(key, shader);
+        std::clog << "shader " << key.toStdString().c_str() << (shader->isCached() ? " loaded from the cache" : " compiled")
+                  << " with " << source.attributes.size() << " attributes and " << source.uniforms.size() << " uniforms in "
+                  << timer.elapsed() << " ms.\n";
+
+        return shader;
+    }
+
+    void Shaders::addShader(QString value, QStringList attributes, QStringList uniforms, bool doTessellation,
+                            QStringList feedbackVaryings)
     {
-        QString path = QString("shaders/").append(value);
         QString shaderName(value);
         if (doTessellation)
             shaderName.append("TL");
-        Shader *shader = new Shader(shaderName, path, doTessellation);
-        shader->load(attributes, uniforms);
-        _shaders.insert(shaderName, shader);
-        std::clog << "shader " << shaderName.toStdString().c_str() << " loaded with " << attributes.size() << " attributes and " << uniforms.size() << " uniforms.\n";
+        if (!feedbackVaryings.isEmpty())
+            shaderName.append("Capture");
+
+        ShaderSource source;
+        source.path = QString("shaders/").append(value);
+        source.attributes = attributes;
+        source.uniforms = uniforms;
+        source.feedbackVaryings = feedbackVaryings;
+        source.doTessellation = doTessellation;
+        _sources.insert(shaderName, source);
     }
 
 }
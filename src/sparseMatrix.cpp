@@ -0,0 +1,127 @@
+#include "sparseMatrix.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Tessellation
+{
+
+    void SparseMatrix::build(const uint rows, std::vector<Triplet> &triplets)
+    {
+        _rows = rows;
+        _rowOffsets.assign(rows + 1, 0);
+        _columns.clear();
+        _values.clear();
+        _columns.reserve(triplets.size());
+        _values.reserve(triplets.size());
+
+        //duplicates are summed
+        std::sort(triplets.begin(), triplets.end());
+        for (size_t i = 0; i < triplets.size(); i++)
+        {
+            const Triplet &triplet = triplets[i];
+            if (i > 0 && triplet.row == triplets[i-1].row && triplet.column == triplets[i-1].column)
+            {
+                _values.back() += triplet.value;
+                continue;
+            }
+
+            _columns.push_back(triplet.column);
+            _values.push_back(triplet.value);
+            _rowOffsets[triplet.row + 1]++;
+        }
+
+        for (uint r = 0; r < rows; r++)
+            _rowOffsets[r + 1] += _rowOffsets[r];
+    }
+
+    void SparseMatrix::multiply(const std::vector<float> &x, std::vector<float> &y)
+    {
+        y.resize(_rows);
+
+        #pragma omp parallel for schedule(static)
+        for (int r = 0; r < static_cast<int>(_rows); r++)
+        {
+            float sum = 0.0f;
+            for (uint i = _rowOffsets[r]; i < _rowOffsets[r + 1]; i++)
+                sum += _values[i] * x[_columns[i]];
+            y[r] = sum;
+        }
+    }
+
+    std::vector<float> SparseMatrix::getDiagonal()
+    {
+        std::vector<float> diagonal(_rows, 0.0f);
+        for (uint r = 0; r < _rows; r++)
+            for (uint i = _rowOffsets[r]; i < _rowOffsets[r + 1]; i++)
+                if (_columns[i] == r)
+                    diagonal[r] = _values[i];
+
+        return diagonal;
+    }
+
+    uint ConjugateGradient::solve(SparseMatrix &matrix, const std::vector<float> &b, std::vector<float> &x)
+    {
+        int n = static_cast<int>(matrix.getRows());
+        x.resize(n, 0.0f);
+
+        std::vector<float> inverseDiagonal = matrix.getDiagonal();
+        for (int i = 0; i < n; i++)
+            inverseDiagonal[i] = (inverseDiagonal[i] != 0.0f) ? 1.0f / inverseDiagonal[i] : 1.0f;
+
+        std::vector<float> r(n), z(n), p(n), q(n);
+        matrix.multiply(x, q);
+
+        double rz = 0.0, bb = 0.0, rr = 0.0;
+        #pragma omp parallel for reduction(+:rz,bb,rr)
+        for (int i = 0; i < n; i++)
+        {
+            r[i] = b[i] - q[i];
+            z[i] = inverseDiagonal[i] * r[i];
+            p[i] = z[i];
+            rz += r[i] * z[i];
+            bb += b[i] * b[i];
+            rr += r[i] * r[i];
+        }
+
+        //a warm start may already be converged
+        double threshold = _tolerance * _tolerance * std::max(bb, 1e-30);
+        uint iteration = 0;
+        for (; iteration < _maxIterations && rr >= threshold; iteration++)
+        {
+            matrix.multiply(p, q);
+
+            double pq = 0.0;
+            #pragma omp parallel for reduction(+:pq)
+            for (int i = 0; i < n; i++)
+                pq += p[i] * q[i];
+            if (pq <= 0.0)
+                break;
+
+            float alpha = static_cast<float>(rz / pq);
+            double rzNext = 0.0;
+            double rrNext = 0.0;
+            #pragma omp parallel for reduction(+:rzNext,rrNext)
+            for (int i = 0; i < n; i++)
+            {
+                x[i] += alpha * p[i];
+                r[i] -= alpha * q[i];
+                z[i] = inverseDiagonal[i] * r[i];
+                rzNext += r[i] * z[i];
+                rrNext += r[i] * r[i];
+            }
+            rr = rrNext;
+
+            float beta = static_cast<float>(rzNext / rz);
+            rz = rzNext;
+            #pragma omp parallel for
+            for (int i = 0; i < n; i++)
+                p[i] = z[i] + beta * p[i];
+        }
+
+        _residual = static_cast<float>(sqrt(rr / std::max(bb, 1e-30)));
+
+        return iteration;
+    }
+
+}
@@ -0,0 +1,107 @@
+#include "streamBuffer.h"
+#include "renderState.h"
+
+#include <iostream>
+
+namespace Tessellation
+{
+
+    //nanoseconds per poll while a region is still being read
+    static const GLuint64 FENCE_TIMEOUT = 1000000000;
+
+    StreamBuffer::StreamBuffer(const GLsizeiptr regionSize):
+        _bufferId(0),
+        _regionSize(regionSize),
+        _isPersistent(isPersistentSupported()),
+        _data(NULL),
+        _region(REGION_COUNT - 1)
+    {
+        for (uint r = 0; r < REGION_COUNT; r++)
+            _fences[r] = 0;
+
+        glGenBuffers(1, &_bufferId);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _bufferId);
+        if (_isPersistent)
+        {
+            //immutable storage, mapped once for the lifetime of the buffer
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_COPY_WRITE_BUFFER, REGION_COUNT * _regionSize, NULL, flags);
+            _data = static_cast<char*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, REGION_COUNT * _regionSize, flags));
+        }
+        else
+            glBufferData(GL_COPY_WRITE_BUFFER, REGION_COUNT * _regionSize, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        std::clog << __FUNCTION__ << ": " << REGION_COUNT << " regions of " << _regionSize << " bytes, "
+                  << (_isPersistent ? "persistently mapped" : "mapped per upload") << ".\n";
+    }
+
+    StreamBuffer::~StreamBuffer()
+    {
+        for (uint r = 0; r < REGION_COUNT; r++)
+            if (_fences[r] != 0)
+                glDeleteSync(_fences[r]);
+
+        if (_data != NULL)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, _bufferId);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &_bufferId);
+    }
+
+    void StreamBuffer::wait(const uint region)
+    {
+        if (_fences[region] == 0)
+            return;
+
+        GLenum result = glClientWaitSync(_fences[region], 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            _stats.stalls++;
+            do
+                result = glClientWaitSync(_fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT);
+            while (result == GL_TIMEOUT_EXPIRED);
+        }
+
+        glDeleteSync(_fences[region]);
+        _fences[region] = 0;
+    }
+
+    void* StreamBuffer::map()
+    {
+        _region = (_region + 1) % REGION_COUNT;
+        wait(_region);
+        _stats.uploads++;
+        _stats.bytes += _regionSize;
+
+        if (_isPersistent)
+            return _data + getOffset();
+
+        //the fence already guarantees the region is free, the driver does not have to check
+        glBindBuffer(GL_COPY_WRITE_BUFFER, _bufferId);
+        return glMapBufferRange(GL_COPY_WRITE_BUFFER, getOffset(), _regionSize,
+                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    }
+
+    void StreamBuffer::unmap()
+    {
+        //coherent writes are seen by every later command
+        if (_isPersistent)
+            return;
+
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+
+    void StreamBuffer::fence()
+    {
+        //the region may be drawn several times before it is written again, the last draw counts
+        if (_fences[_region] != 0)
+            glDeleteSync(_fences[_region]);
+        _fences[_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        RenderState::countCalls(1);
+    }
+
+}
@@ -0,0 +1,186 @@
+#include "tessellationCapture.h"
+#include "shader.h"
+
+#include <QElapsedTimer>
+#include <boost/unordered_map.hpp>
+
+#include <cmath>
+#include <limits>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    //interleaved evaluationPosition (vec4), evaluationNormal (vec3), evaluationUV (vec2)
+    static const uint CAPTURE_STRIDE = 9;
+
+    struct WeldKey
+    {
+        glm::ivec3 position;
+        glm::ivec2 textureCoordinate;
+
+        bool operator==(const WeldKey &key) const
+        {
+            return position == key.position && textureCoordinate == key.textureCoordinate;
+        }
+    };
+
+    struct WeldKeyHash : std::unary_function<WeldKey, size_t> {
+        std::size_t operator()(const WeldKey &key) const {
+            size_t hash = 0;
+            boost::hash_combine(hash, key.position.x);
+            boost::hash_combine(hash, key.position.y);
+            boost::hash_combine(hash, key.position.z);
+            boost::hash_combine(hash, key.textureCoordinate.x);
+            boost::hash_combine(hash, key.textureCoordinate.y);
+            return hash;
+        }
+    };
+
+    void TessellationCapture::drawGeometry(Geometry *geometry, const glm::mat4 &mvp)
+    {
+        geometry->updateShader();
+        geometry->preDraw();
+        geometry->setMVP(mvp);
+        geometry->draw();
+    }
+
+    CaptureStats TessellationCapture::capture(Geometry *geometry, const glm::mat4 &mvp, IndexedMesh &mesh)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        CaptureStats stats;
+        mesh = IndexedMesh();
+
+        Material *material = geometry->getMaterial();
+        QString value = material->getValue();
+        if (!Shaders::contains("renderTLCapture") || !geometry->isTessellable() || !material->doTessellation())
+            return stats;
+
+        //same uniforms, state and defines as the viewer, through the capturing program
+        material->setShader("renderTLCapture");
+        glEnable(GL_RASTERIZER_DISCARD);
+
+        GLuint queries[2];
+        glGenQueries(2, queries);
+
+        //first pass only counts, so the buffer can be sized exactly
+        glBeginQuery(GL_PRIMITIVES_GENERATED, queries[0]);
+        drawGeometry(geometry, mvp);
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        glGetQueryObjectuiv(queries[0], GL_QUERY_RESULT, &stats.primitives);
+
+        std::vector<float> data;
+        if (stats.primitives > 0)
+        {
+            GLuint buffer;
+            GLsizeiptr size = static_cast<GLsizeiptr>(stats.primitives) * 3 * CAPTURE_STRIDE * sizeof(float);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, buffer);
+            glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, size, NULL, GL_STATIC_READ);
+            glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffer);
+
+            glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, queries[1]);
+            glBeginTransformFeedback(GL_TRIANGLES);
+            drawGeometry(geometry, mvp);
+            glEndTransformFeedback();
+            glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+            glGetQueryObjectuiv(queries[1], GL_QUERY_RESULT, &stats.written);
+
+            data.resize(static_cast<size_t>(stats.written) * 3 * CAPTURE_STRIDE);
+            if (!data.empty())
+                glGetBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, 0, data.size() * sizeof(float), &data[0]);
+
+            glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+            glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, 0);
+            glDeleteBuffers(1, &buffer);
+        }
+
+        glDeleteQueries(2, queries);
+        glDisable(GL_RASTERIZER_DISCARD);
+        material->setShader(value);
+
+        if (stats.written < stats.primitives)
+            std::clog << __FUNCTION__ << ": " << stats.written << " of " << stats.primitives << " primitives written.\n";
+
+        weld(data, stats.written, mesh, stats);
+        stats.milliseconds = timer.nsecsElapsed() / 1000000.0;
+
+        std::clog << __FUNCTION__ << ": " << stats.written << " triangles captured, " << stats.vertices
+                  << " vertices after welding, " << stats.degenerates << " degenerates removed in "
+                  << stats.milliseconds << " ms.\n";
+
+        return stats;
+    }
+
+    void TessellationCapture::weld(const std::vector<float> &data, const uint triangles, IndexedMesh &mesh, CaptureStats &stats)
+    {
+        typedef boost::unordered_map<WeldKey, uint, WeldKeyHash> WeldMap;
+
+        uint cornerCount = triangles * 3;
+        if (cornerCount == 0)
+            return;
+
+        glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+        for (uint c = 0; c < cornerCount; c++)
+        {
+            const float *corner = &data[c * CAPTURE_STRIDE];
+            min = glm::min(min, glm::vec3(corner[0], corner[1], corner[2]));
+            max = glm::max(max, glm::vec3(corner[0], corner[1], corner[2]));
+        }
+
+        //patches evaluate their shared edges separately, so positions only agree within a tolerance
+        float cell = std::max(_weldTolerance * glm::length(max - min), std::numeric_limits<float>::min());
+        float uvCell = _weldTolerance;
+
+        WeldMap weldMap;
+        std::vector<uint> cornerIds(cornerCount);
+        for (uint c = 0; c < cornerCount; c++)
+        {
+            const float *corner = &data[c * CAPTURE_STRIDE];
+            glm::vec3 position(corner[0], corner[1], corner[2]);
+            glm::vec3 normal(corner[4], corner[5], corner[6]);
+            glm::vec2 uv(corner[7], corner[8]);
+
+            WeldKey key;
+            key.position = glm::ivec3(glm::floor(position / cell + 0.5f));
+            key.textureCoordinate = glm::ivec2(glm::floor(uv / uvCell + 0.5f));
+
+            std::pair<WeldMap::iterator, bool> inserted = weldMap.insert(std::make_pair(key, mesh.positions.size()));
+            cornerIds[c] = inserted.first->second;
+            if (inserted.second)
+            {
+                mesh.positions.push_back(position);
+                mesh.normals.push_back(normal);
+                mesh.textureCoordinates.push_back(uv);
+            }
+            else
+                mesh.normals[cornerIds[c]] += normal;
+        }
+
+        for (size_t v = 0; v < mesh.normals.size(); v++)
+        {
+            float length = glm::length(mesh.normals[v]);
+            if (length > 0.0f)
+                mesh.normals[v] /= length;
+        }
+
+        mesh.indices.reserve(cornerCount);
+        for (uint t = 0; t < triangles; t++)
+        {
+            uint a = cornerIds[t*3], b = cornerIds[t*3+1], c = cornerIds[t*3+2];
+            if (a == b || b == c || a == c)
+            {
+                stats.degenerates++;
+                continue;
+            }
+            mesh.indices.push_back(a);
+            mesh.indices.push_back(b);
+            mesh.indices.push_back(c);
+        }
+
+        stats.vertices = mesh.positions.size();
+    }
+
+}
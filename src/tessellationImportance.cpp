@@ -0,0 +1,224 @@
+#include "tessellationImportance.h"
+
+#include <QElapsedTimer>
+
+#include <cmath>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    TessellationImportance::TessellationImportance(const float curvatureAngle, const float displacementRatio):
+        _curvatureAngle(curvatureAngle),
+        _displacementRatio(displacementRatio),
+        _scale(1.0f),
+        _tessellator(EqualSpacing)
+    {
+    }
+
+    void TessellationImportance::compute(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                                         const std::vector<glm::vec3> &displacements)
+    {
+        _topology.build(positions, indices);
+        int triangleCount = _topology.getTriangleCount();
+
+        std::vector<glm::vec3> faceNormals(triangleCount);
+        std::vector<float> magnitudes(triangleCount, 0.0f);
+        bool hasDisplacements = displacements.size() == positions.size();
+        float maxMagnitude = 0.0f;
+        #pragma omp parallel for reduction(max:maxMagnitude)
+        for (int t = 0; t < triangleCount; t++)
+        {
+            glm::vec3 polygon[3];
+            _topology.getTriangleVertices(t, polygon);
+            glm::vec3 normal = glm::cross(polygon[1] - polygon[0], polygon[2] - polygon[0]);
+            float length = glm::length(normal);
+            faceNormals[t] = (length > 0.0f) ? normal / length : normal;
+
+            if (hasDisplacements)
+            {
+                for (int k = 0; k < 3; k++)
+                    magnitudes[t] += glm::length(displacements[indices[t*3+k]]) / 3.0f;
+                maxMagnitude = std::max(maxMagnitude, magnitudes[t]);
+            }
+        }
+
+        //a patch is as important as its sharpest crease or its largest displacement
+        std::vector<float> triangleImportance(triangleCount, 0.0f);
+        float displacementReference = maxMagnitude * _displacementRatio;
+        #pragma omp parallel for
+        for (int t = 0; t < triangleCount; t++)
+        {
+            glm::ivec3 neighbors = _topology.getTriangleNeighbors(t);
+            float angle = 0.0f;
+            for (int k = 0; k < 3; k++)
+            {
+                if (neighbors[k] >= 0)
+                {
+                    float cosine = glm::clamp(glm::dot(faceNormals[t], faceNormals[neighbors[k]]), -1.0f, 1.0f);
+                    angle = std::max(angle, static_cast<float>(acos(cosine)));
+                }
+            }
+
+            float curvature = std::min(angle / _curvatureAngle, 1.0f);
+            float displacement = (displacementReference > 0.0f) ? std::min(magnitudes[t] / displacementReference, 1.0f) : 0.0f;
+            triangleImportance[t] = std::max(curvature, displacement);
+        }
+
+        //an edge takes the larger importance of its two patches so that both pick the same level
+        _patchImportance.resize(triangleCount);
+        #pragma omp parallel for
+        for (int t = 0; t < triangleCount; t++)
+        {
+            glm::ivec3 neighbors = _topology.getTriangleNeighbors(t);
+            glm::vec4 importance(0.0f, 0.0f, 0.0f, triangleImportance[t]);
+            for (int e = 0; e < 3; e++)
+            {
+                //outer level e is the edge opposite to corner e, that is topology edge e+1
+                int neighbor = neighbors[(e+1)%3];
+                importance[e] = std::max(triangleImportance[t], neighbor >= 0 ? triangleImportance[neighbor] : 0.0f);
+            }
+            _patchImportance[t] = importance;
+        }
+    }
+
+    uint TessellationImportance::getPrimitiveCount(const float innerLevel, const float outerLevel, const float scale)
+    {
+        uint count = 0;
+        #pragma omp parallel for reduction(+:count)
+        for (int t = 0; t < static_cast<int>(_patchImportance.size()); t++)
+        {
+            const glm::vec4 &importance = _patchImportance[t];
+            TessellationLevels levels(getLevel(innerLevel, importance.w, scale), getLevel(outerLevel, importance.x, scale),
+                                      getLevel(outerLevel, importance.y, scale), getLevel(outerLevel, importance.z, scale));
+            count += _tessellator.getPrimitiveCount(levels);
+        }
+
+        return count;
+    }
+
+    uint TessellationImportance::getPrimitiveCount(const std::vector<glm::vec3> &adaptiveLevels, const float scale)
+    {
+        uint count = 0;
+        #pragma omp parallel for reduction(+:count)
+        for (int t = 0; t < static_cast<int>(_patchImportance.size()); t++)
+        {
+            //culled patches draw nothing, the inner level follows the largest outer one like in the control shader
+            const glm::vec3 &outer = adaptiveLevels[t];
+            if (outer.x <= 0.0f)
+                continue;
+
+            const glm::vec4 &importance = _patchImportance[t];
+            glm::vec3 level(getLevel(outer.x, importance.x, scale), getLevel(outer.y, importance.y, scale), getLevel(outer.z, importance.z, scale));
+            TessellationLevels levels(std::max(level.x, std::max(level.y, level.z)), level.x, level.y, level.z);
+            count += _tessellator.getPrimitiveCount(levels);
+        }
+
+        return count;
+    }
+
+    std::vector<glm::vec3> TessellationImportance::getAdaptiveLevels(const std::vector<glm::vec3> &positions, const std::vector<uint> &indices,
+                                                                     const glm::mat4 &mvp, const glm::vec2 &viewport, const float pixelsPerEdge)
+    {
+        const float maxLevel = 64.0f;
+        int patchCount = indices.size() / 3;
+        std::vector<glm::vec3> levels(patchCount, glm::vec3(0.0f));
+        #pragma omp parallel for
+        for (int t = 0; t < patchCount; t++)
+        {
+            glm::vec4 p[3];
+            for (int k = 0; k < 3; k++)
+                p[k] = mvp * glm::vec4(positions[indices[t*3+k]], 1.0f);
+
+            //all three corners outside the same clip plane, with the margin of render.cs
+            bool isCulled = false;
+            for (int axis = 0; axis < 3 && !isCulled; axis++)
+            {
+                bool below = true, above = true;
+                for (int k = 0; k < 3; k++)
+                {
+                    below = below && p[k][axis] < -1.1f * p[k].w;
+                    above = above && p[k][axis] > 1.1f * p[k].w;
+                }
+                isCulled = below || above;
+            }
+            if (isCulled)
+                continue;
+
+            //outer level e belongs to the edge opposite to corner e
+            for (int e = 0; e < 3; e++)
+            {
+                const glm::vec4 &a = p[(e+1)%3];
+                const glm::vec4 &b = p[(e+2)%3];
+                if (a.w <= 0.0f || b.w <= 0.0f)
+                {
+                    levels[t][e] = maxLevel;
+                    continue;
+                }
+                glm::vec2 screenA = 0.5f * viewport * glm::vec2(a) / a.w;
+                glm::vec2 screenB = 0.5f * viewport * glm::vec2(b) / b.w;
+                levels[t][e] = glm::clamp(glm::distance(screenA, screenB) / pixelsPerEdge, 1.0f, maxLevel);
+            }
+        }
+
+        return levels;
+    }
+
+    ImportanceStats TessellationImportance::fitBudget(const float innerLevel, const float outerLevel, const uint budget)
+    {
+        ImportanceStats stats = fit([=](float scale) {return getPrimitiveCount(innerLevel, outerLevel, scale);}, budget);
+        std::clog << __FUNCTION__ << ": " << stats.patches << " patches, scale " << stats.scale << ", "
+                  << stats.primitives << "/" << stats.budget << " primitives (" << stats.maxPrimitives
+                  << " at full level) in " << stats.milliseconds << " ms.\n";
+
+        return stats;
+    }
+
+    ImportanceStats TessellationImportance::fitBudget(const std::vector<glm::vec3> &adaptiveLevels, const uint budget)
+    {
+        //refitted whenever the view moves, so not logged
+        return fit([&](float scale) {return getPrimitiveCount(adaptiveLevels, scale);}, budget);
+    }
+
+    ImportanceStats TessellationImportance::fit(const std::function<uint(float)> &getCount, const uint budget)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        ImportanceStats stats;
+        stats.patches = _patchImportance.size();
+        stats.budget = budget;
+
+        //the scale that saturates the least important non-flat patch
+        float minImportance = 1.0f;
+        for (size_t t = 0; t < _patchImportance.size(); t++)
+            for (int e = 0; e < 4; e++)
+                if (_patchImportance[t][e] > 0.0f)
+                    minImportance = std::min(minImportance, _patchImportance[t][e]);
+
+        float low = 0.0f, high = 1.0f / minImportance;
+        stats.maxPrimitives = getCount(high);
+        if (stats.maxPrimitives <= budget)
+            low = high;
+        else
+        {
+            //the count grows with the scale: keep the largest scale within the budget
+            for (int i = 0; i < 24; i++)
+            {
+                float middle = 0.5f * (low + high);
+                if (getCount(middle) <= budget)
+                    low = middle;
+                else
+                    high = middle;
+            }
+        }
+
+        _scale = low;
+        stats.scale = _scale;
+        stats.primitives = getCount(_scale);
+        stats.milliseconds = timer.nsecsElapsed() / 1000000.0;
+
+        return stats;
+    }
+
+}
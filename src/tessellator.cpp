@@ -0,0 +1,467 @@
+#include "tessellator.h"
+
+#include <QElapsedTimer>
+#include <boost/unordered_map.hpp>
+
+#include <cmath>
+#include <limits>
+#include <iostream>
+
+namespace Tessellation
+{
+
+    struct CornerKey
+    {
+        glm::vec3 position;
+        glm::vec3 normal;
+        glm::vec2 textureCoordinate;
+
+        bool operator==(const CornerKey &key) const
+        {
+            return position == key.position && normal == key.normal && textureCoordinate == key.textureCoordinate;
+        }
+    };
+
+    struct CornerKeyHash : std::unary_function<CornerKey, size_t> {
+        std::size_t operator()(const CornerKey &key) const {
+            size_t hash = 0;
+            for (int c = 0; c < 3; c++)
+            {
+                boost::hash_combine(hash, key.position[c]);
+                boost::hash_combine(hash, key.normal[c]);
+            }
+            boost::hash_combine(hash, key.textureCoordinate.x);
+            boost::hash_combine(hash, key.textureCoordinate.y);
+            return hash;
+        }
+    };
+
+    Tessellator::Tessellator(const TessellationSpacing spacing, const float maxLevel):
+        _spacing(spacing),
+        _maxLevel(maxLevel)
+    {
+    }
+
+    bool Tessellator::getSpacing(QString name, TessellationSpacing &spacing)
+    {
+        if (name == "equal" || name == "equal_spacing")
+            spacing = EqualSpacing;
+        else if (name == "fractional_odd" || name == "fractional_odd_spacing")
+            spacing = FractionalOddSpacing;
+        else if (name == "fractional_even" || name == "fractional_even_spacing")
+            spacing = FractionalEvenSpacing;
+        else
+            return false;
+
+        return true;
+    }
+
+    uint Tessellator::getSegments(const float level, float &effective)
+    {
+        //clamping and rounding of the specification for each spacing mode
+        switch (_spacing)
+        {
+        case FractionalOddSpacing:
+        {
+            effective = glm::clamp(level, 1.0f, _maxLevel - 1.0f);
+            uint segments = static_cast<uint>(ceil(effective));
+            return (segments % 2 == 0) ? segments + 1 : segments;
+        }
+        case FractionalEvenSpacing:
+        {
+            effective = glm::clamp(level, 2.0f, _maxLevel);
+            uint segments = static_cast<uint>(ceil(effective));
+            return (segments % 2 == 1) ? segments + 1 : segments;
+        }
+        default:
+            effective = ceil(glm::clamp(level, 1.0f, _maxLevel));
+            return static_cast<uint>(effective);
+        }
+    }
+
+    bool Tessellator::getSegments(const TessellationLevels &levels, float effective[4], uint segments[4])
+    {
+        //a patch with a non-positive (or NaN) outer level is discarded
+        for (int e = 0; e < 3; e++)
+            if (!(levels.outer[e] > 0.0f))
+                return false;
+
+        segments[0] = getSegments(levels.inner, effective[0]);
+        bool isOuterOne = true;
+        for (int e = 0; e < 3; e++)
+        {
+            segments[e+1] = getSegments(levels.outer[e], effective[e+1]);
+            isOuterOne = isOuterOne && segments[e+1] == 1;
+        }
+
+        //an inner level of one with a subdivided outer edge is treated as 1+epsilon
+        if (segments[0] == 1 && !isOuterOne)
+            segments[0] = getSegments(1.0f + std::numeric_limits<float>::epsilon(), effective[0]);
+
+        return true;
+    }
+
+    void Tessellator::getParameters(const float level, const uint segments, std::vector<float> &parameters)
+    {
+        parameters.resize(segments+1);
+        parameters[0] = 0.0f;
+        parameters[segments] = 1.0f;
+        if (segments < 2)
+            return;
+
+        //n-2 segments of length 1/level and two shorter ones placed symmetrically around the center
+        float length = 1.0f / level;
+        float shortLength = 0.5f * (1.0f - (segments - 2) * length);
+        uint shortA = (segments % 2 == 0) ? segments/2 - 1 : (segments-1)/2 - 1;
+        uint shortB = (segments % 2 == 0) ? segments/2 : (segments-1)/2 + 1;
+
+        //mirrored so that both patches of an edge produce the same points
+        float t = 0.0f;
+        for (uint i = 0; i < segments/2; i++)
+        {
+            t += (i == shortA || i == shortB) ? shortLength : length;
+            parameters[i+1] = t;
+            parameters[segments-i-1] = 1.0f - t;
+        }
+        if (segments % 2 == 0)
+            parameters[segments/2] = 0.5f;
+    }
+
+    uint Tessellator::getPrimitiveCount(const TessellationLevels &levels)
+    {
+        float effective[4];
+        uint segments[4];
+        if (!getSegments(levels, effective, segments))
+            return 0;
+        if (segments[0] == 1)
+            return 1;
+
+        uint innerRing = segments[0] - 2;
+        uint count = segments[1] + segments[2] + segments[3] + 3*innerRing;
+        for (int ring = static_cast<int>(innerRing); ring >= 2; ring -= 2)
+            count += 3*(ring + ring - 2);
+        if (segments[0] % 2 == 1)
+            count++;
+
+        return count;
+    }
+
+    const TessellationPattern& Tessellator::getPattern(const TessellationLevels &levels)
+    {
+        std::map<TessellationLevels, TessellationPattern>::iterator it = _patterns.find(levels);
+        if (it != _patterns.end())
+            return it->second;
+
+        TessellationPattern &pattern = _patterns[levels];
+        buildPattern(levels, pattern);
+
+        return pattern;
+    }
+
+    void Tessellator::buildPattern(const TessellationLevels &levels, TessellationPattern &pattern)
+    {
+        float effective[4];
+        uint segments[4];
+        if (!getSegments(levels, effective, segments))
+            return;
+
+        const glm::vec3 corners[3] = {glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)};
+        const glm::vec3 center(1.0f/3.0f);
+
+        for (int k = 0; k < 3; k++)
+            pattern.vertices.push_back(PatternVertex(corners[k], PatternCorner, k));
+
+        if (segments[0] == 1)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                pattern.indices.push_back(k);
+                pattern.segments[k] = 1;
+            }
+            return;
+        }
+
+        //outer ring: edge e runs from corner (e+1)%3 to corner (e+2)%3
+        std::vector<uint> outer[3], inner[3];
+        std::vector<float> parameters;
+        for (int e = 0; e < 3; e++)
+        {
+            uint a = (e+1)%3, b = (e+2)%3;
+            pattern.segments[e] = segments[e+1];
+            getParameters(effective[e+1], segments[e+1], parameters);
+            outer[e].push_back(a);
+            for (uint i = 1; i < segments[e+1]; i++)
+            {
+                outer[e].push_back(pattern.vertices.size());
+                pattern.vertices.push_back(PatternVertex(glm::mix(corners[a], corners[b], parameters[i]), PatternEdge, e, i));
+            }
+            outer[e].push_back(b);
+        }
+
+        //inner rings shrink toward the center by twice the first inner segment
+        float scale = 1.0f;
+        float level = effective[0];
+        int ringSegments = segments[0];
+        while (ringSegments >= 2)
+        {
+            getParameters(level, ringSegments, parameters);
+            float ratio = 1.0f - 2.0f*parameters[1];
+            float innerScale = scale * ratio;
+            level -= 2.0f;
+            ringSegments -= 2;
+
+            glm::vec3 ringCorners[3];
+            uint ringIds[3];
+            for (int k = 0; k < 3; k++)
+                ringCorners[k] = center + innerScale * (corners[k] - center);
+
+            if (ringSegments == 0)
+            {
+                uint id = pattern.vertices.size();
+                pattern.vertices.push_back(PatternVertex(center, PatternInterior));
+                for (int e = 0; e < 3; e++)
+                    inner[e].assign(1, id);
+            }
+            else
+            {
+                for (int k = 0; k < 3; k++)
+                {
+                    ringIds[k] = pattern.vertices.size();
+                    pattern.vertices.push_back(PatternVertex(ringCorners[k], PatternInterior));
+                }
+                getParameters(level, ringSegments, parameters);
+                for (int e = 0; e < 3; e++)
+                {
+                    uint a = (e+1)%3, b = (e+2)%3;
+                    inner[e].assign(1, ringIds[a]);
+                    for (int i = 1; i < ringSegments; i++)
+                    {
+                        inner[e].push_back(pattern.vertices.size());
+                        pattern.vertices.push_back(PatternVertex(glm::mix(ringCorners[a], ringCorners[b], parameters[i]), PatternInterior));
+                    }
+                    inner[e].push_back(ringIds[b]);
+                }
+            }
+
+            //stitch each outer edge to its inner edge, merging by position along the edge
+            for (int e = 0; e < 3; e++)
+            {
+                const std::vector<uint> &p = outer[e];
+                const std::vector<uint> &q = inner[e];
+                const glm::vec3 &start = pattern.vertices[p.front()].barycentric;
+                glm::vec3 direction = pattern.vertices[p.back()].barycentric - start;
+                float length2 = glm::dot(direction, direction);
+
+                size_t i = 0, j = 0;
+                while (i+1 < p.size() || j+1 < q.size())
+                {
+                    bool advanceOuter = (j+1 >= q.size());
+                    if (!advanceOuter && i+1 < p.size())
+                    {
+                        float s = glm::dot(pattern.vertices[p[i+1]].barycentric - start, direction) / length2;
+                        float t = glm::dot(pattern.vertices[q[j+1]].barycentric - start, direction) / length2;
+                        advanceOuter = s <= t;
+                    }
+
+                    pattern.indices.push_back(p[i]);
+                    if (advanceOuter)
+                    {
+                        pattern.indices.push_back(p[i+1]);
+                        pattern.indices.push_back(q[j]);
+                        i++;
+                    }
+                    else
+                    {
+                        pattern.indices.push_back(q[j+1]);
+                        pattern.indices.push_back(q[j]);
+                        j++;
+                    }
+                }
+                outer[e] = inner[e];
+            }
+
+            if (ringSegments == 1)
+                for (int k = 0; k < 3; k++)
+                    pattern.indices.push_back(ringIds[k]);
+
+            scale = innerScale;
+        }
+
+        for (size_t v = 0; v < pattern.vertices.size(); v++)
+            if (pattern.vertices[v].location == PatternInterior)
+                pattern.interiorCount++;
+
+        if (pattern.getTriangleCount() != getPrimitiveCount(levels))
+            std::clog << __FUNCTION__ << ": pattern has " << pattern.getTriangleCount() << " triangles, expected "
+                      << getPrimitiveCount(levels) << ".\n";
+    }
+
+    TessellationStats Tessellator::tessellate(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals,
+                                              const std::vector<glm::vec2> &textureCoordinates, const std::vector<uint> &indices,
+                                              const std::vector<TessellationLevels> &levels, IndexedMesh &mesh)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        TessellationStats stats;
+        uint patchCount = indices.size() / 3;
+        stats.patches = patchCount;
+        mesh = IndexedMesh();
+        if (patchCount == 0 || levels.empty())
+            return stats;
+
+        bool hasNormals = !normals.empty() && normals.size() == positions.size();
+        bool hasTextureCoordinates = !textureCoordinates.empty() && textureCoordinates.size() == positions.size();
+
+        //corners with identical attributes become one vertex
+        typedef boost::unordered_map<CornerKey, uint, CornerKeyHash> CornerMap;
+        CornerMap cornerMap;
+        std::vector<uint> cornerIds(patchCount*3);
+        for (uint c = 0; c < patchCount*3; c++)
+        {
+            CornerKey key;
+            key.position = positions[indices[c]];
+            key.normal = hasNormals ? normals[indices[c]] : glm::vec3(0.0f);
+            key.textureCoordinate = hasTextureCoordinates ? textureCoordinates[indices[c]] : glm::vec2(0.0f);
+
+            std::pair<CornerMap::iterator, bool> inserted = cornerMap.insert(std::make_pair(key, mesh.positions.size()));
+            cornerIds[c] = inserted.first->second;
+            if (inserted.second)
+            {
+                mesh.positions.push_back(key.position);
+                if (hasNormals)
+                    mesh.normals.push_back(key.normal);
+                if (hasTextureCoordinates)
+                    mesh.textureCoordinates.push_back(key.textureCoordinate);
+            }
+        }
+
+        //patterns are shared by every patch with the same levels
+        std::vector<const TessellationPattern*> patterns(patchCount);
+        for (uint t = 0; t < patchCount; t++)
+            patterns[t] = &getPattern(levels.size() == patchCount ? levels[t] : levels[0]);
+        stats.patterns = _patterns.size();
+
+        //edge vertices are owned by the first patch and reused by its neighbor when the counts agree
+        struct SharedEdge
+        {
+            uint segments;
+            uint owner;
+            uint base;
+        };
+        typedef boost::unordered_map<std::pair<uint, uint>, uint> EdgeMap;
+        EdgeMap edgeMap;
+        std::vector<SharedEdge> edges;
+        std::vector<glm::ivec3> patchEdges(patchCount, glm::ivec3(-1));
+        std::vector<glm::bvec3> patchForward(patchCount, glm::bvec3(true));
+        std::vector<uint> patchBase(patchCount+1, 0), triangleBase(patchCount+1, 0);
+        for (uint t = 0; t < patchCount; t++)
+        {
+            const TessellationPattern &pattern = *patterns[t];
+            uint privateCount = pattern.interiorCount;
+            if (pattern.getTriangleCount() > 0)
+            {
+                for (int e = 0; e < 3; e++)
+                {
+                    uint a = cornerIds[t*3 + (e+1)%3], b = cornerIds[t*3 + (e+2)%3];
+                    std::pair<uint, uint> key(std::min(a, b), std::max(a, b));
+                    EdgeMap::iterator it = edgeMap.find(key);
+                    if (it == edgeMap.end())
+                    {
+                        SharedEdge edge = {pattern.segments[e], t, 0};
+                        edgeMap[key] = edges.size();
+                        patchEdges[t][e] = edges.size();
+                        edges.push_back(edge);
+                    }
+                    else if (edges[it->second].segments == pattern.segments[e])
+                    {
+                        patchEdges[t][e] = it->second;
+                        stats.sharedEdges++;
+                    }
+                    else
+                    {
+                        privateCount += pattern.segments[e] - 1;
+                        stats.crackedEdges++;
+                    }
+                    patchForward[t][e] = a <= b;
+                }
+            }
+            patchBase[t+1] = patchBase[t] + privateCount;
+            triangleBase[t+1] = triangleBase[t] + pattern.indices.size();
+        }
+
+        uint vertexCount = mesh.positions.size();
+        for (size_t e = 0; e < edges.size(); e++)
+        {
+            edges[e].base = vertexCount;
+            vertexCount += edges[e].segments - 1;
+        }
+        for (uint t = 0; t <= patchCount; t++)
+            patchBase[t] += vertexCount;
+        vertexCount = patchBase[patchCount];
+
+        mesh.positions.resize(vertexCount);
+        if (hasNormals)
+            mesh.normals.resize(vertexCount);
+        if (hasTextureCoordinates)
+            mesh.textureCoordinates.resize(vertexCount);
+        mesh.indices.resize(triangleBase[patchCount]);
+
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int t = 0; t < static_cast<int>(patchCount); t++)
+        {
+            const TessellationPattern &pattern = *patterns[t];
+            std::vector<uint> ids(pattern.vertices.size());
+            uint next = patchBase[t];
+            for (size_t v = 0; v < pattern.vertices.size(); v++)
+            {
+                const PatternVertex &vertex = pattern.vertices[v];
+                bool write = true;
+                if (vertex.location == PatternCorner)
+                {
+                    ids[v] = cornerIds[t*3 + vertex.element];
+                    write = false;
+                }
+                else if (vertex.location == PatternEdge && patchEdges[t][vertex.element] >= 0)
+                {
+                    const SharedEdge &edge = edges[patchEdges[t][vertex.element]];
+                    uint step = patchForward[t][vertex.element] ? vertex.step : edge.segments - vertex.step;
+                    ids[v] = edge.base + step - 1;
+                    write = (edge.owner == static_cast<uint>(t));
+                }
+                else
+                    ids[v] = next++;
+
+                if (write)
+                {
+                    const glm::vec3 &w = vertex.barycentric;
+                    uint c0 = indices[t*3], c1 = indices[t*3+1], c2 = indices[t*3+2];
+                    mesh.positions[ids[v]] = w.x*positions[c0] + w.y*positions[c1] + w.z*positions[c2];
+                    if (hasNormals)
+                    {
+                        glm::vec3 normal = w.x*normals[c0] + w.y*normals[c1] + w.z*normals[c2];
+                        float length = glm::length(normal);
+                        mesh.normals[ids[v]] = (length > 0.0f) ? normal / length : normal;
+                    }
+                    if (hasTextureCoordinates)
+                        mesh.textureCoordinates[ids[v]] = w.x*textureCoordinates[c0] + w.y*textureCoordinates[c1] + w.z*textureCoordinates[c2];
+                }
+            }
+
+            for (size_t i = 0; i < pattern.indices.size(); i++)
+                mesh.indices[triangleBase[t] + i] = ids[pattern.indices[i]];
+        }
+
+        stats.vertices = mesh.getVertexCount();
+        stats.triangles = mesh.getTriangleCount();
+        stats.milliseconds = timer.nsecsElapsed() / 1000000.0;
+
+        std::clog << __FUNCTION__ << ": " << stats.patches << " patches into " << stats.triangles << " triangles, "
+                  << stats.vertices << " vertices, " << stats.sharedEdges << " shared edges, "
+                  << stats.crackedEdges << " cracked edges, " << stats.patterns << " patterns in "
+                  << stats.milliseconds << " ms.\n";
+
+        return stats;
+    }
+
+}
@@ -0,0 +1,81 @@
+#include "uniformBuffer.h"
+#include "renderState.h"
+
+namespace Tessellation
+{
+
+    //draws between two wraps of the object ring
+    static const uint OBJECT_RING_CAPACITY = 1024;
+
+    UniformBuffer::UniformBuffer(const GLuint binding, const GLsizeiptr blockSize, const uint capacity):
+        _binding(binding),
+        _bufferId(0),
+        _blockSize(blockSize),
+        _capacity(capacity),
+        _slot(0)
+    {
+        //ranges have to start on the implementation's offset alignment
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        _stride = ((blockSize + alignment - 1) / alignment) * alignment;
+
+        glGenBuffers(1, &_bufferId);
+        orphan();
+    }
+
+    UniformBuffer::~UniformBuffer()
+    {
+        glDeleteBuffers(1, &_bufferId);
+    }
+
+    void UniformBuffer::orphan()
+    {
+        //the driver hands out fresh storage while draws still read the old one
+        glBindBuffer(GL_UNIFORM_BUFFER, _bufferId);
+        glBufferData(GL_UNIFORM_BUFFER, _stride * _capacity, NULL, GL_STREAM_DRAW);
+        _slot = 0;
+    }
+
+    void UniformBuffer::push(const void *data)
+    {
+        if (_slot == _capacity)
+        {
+            orphan();
+            RenderState::countCalls(1);
+        }
+        else
+            glBindBuffer(GL_UNIFORM_BUFFER, _bufferId);
+
+        GLintptr offset = _stride * _slot;
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, _blockSize, data);
+        glBindBufferRange(GL_UNIFORM_BUFFER, _binding, _bufferId, offset, _blockSize);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        RenderState::countCalls(4);
+        _slot++;
+    }
+
+    //Uniform blocks shared by every program
+    std::shared_ptr<UniformBuffer> UniformBlocks::_frame;
+    std::shared_ptr<UniformBuffer> UniformBlocks::_objects;
+
+    void UniformBlocks::clear()
+    {
+        _frame.reset();
+        _objects.reset();
+    }
+
+    void UniformBlocks::updateFrame(const FrameUniforms &frame)
+    {
+        if (!_frame)
+            _frame.reset(new UniformBuffer(FRAME_BLOCK_BINDING, sizeof(FrameUniforms), 1));
+        _frame->push(&frame);
+    }
+
+    void UniformBlocks::updateObject(const ObjectUniforms &object)
+    {
+        if (!_objects)
+            _objects.reset(new UniformBuffer(OBJECT_BLOCK_BINDING, sizeof(ObjectUniforms), OBJECT_RING_CAPACITY));
+        _objects->push(&object);
+    }
+
+}
@@ -0,0 +1,145 @@
+#include <GL/glew.h>
+#include "uploadWorker.h"
+#include "geometry.h"
+
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QElapsedTimer>
+
+#include <iostream>
+
+namespace Tessellation
+{
+
+    UploadWorker::UploadWorker(QOpenGLContext *shareContext):
+        _context(NULL),
+        _surface(NULL),
+        _isValid(false),
+        _isStopping(false)
+    {
+        if (shareContext == NULL)
+            return;
+
+        _surface = new QOffscreenSurface();
+        _surface->setFormat(shareContext->format());
+        _surface->create();
+
+        _context = new QOpenGLContext();
+        _context->setFormat(shareContext->format());
+        _context->setShareContext(shareContext);
+        _isValid = _context->create() && _context->shareContext() == shareContext && _surface->isValid();
+        if (!_isValid)
+        {
+            std::clog << __FUNCTION__ << ": No shared context, uploads stay on the viewer's.\n";
+            return;
+        }
+
+        //made current by run(), a context is only current on the thread it belongs to
+        _context->moveToThread(this);
+        start();
+    }
+
+    UploadWorker::~UploadWorker()
+    {
+        {
+            QMutexLocker locker(&_mutex);
+            _isStopping = true;
+            _condition.wakeAll();
+        }
+        wait();
+
+        delete _context;
+        delete _surface;
+    }
+
+    void UploadWorker::upload(const UploadJob &job)
+    {
+        QMutexLocker locker(&_mutex);
+        _queue.push_back(job);
+        _condition.wakeOne();
+    }
+
+    std::vector<Geometry*> UploadWorker::takeReady()
+    {
+        std::vector<Geometry*> geometries;
+        QMutexLocker locker(&_mutex);
+        while (!_ready.empty())
+        {
+            //zero timeout, the render thread never waits on the worker
+            GLenum result = glClientWaitSync(_ready.front().fence, 0, 0);
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+                break;
+
+            glDeleteSync(_ready.front().fence);
+            geometries.push_back(_ready.front().geometry);
+            _ready.pop_front();
+        }
+
+        return geometries;
+    }
+
+    bool UploadWorker::isPending()
+    {
+        QMutexLocker locker(&_mutex);
+        return !_queue.empty() || !_ready.empty();
+    }
+
+    void UploadWorker::run()
+    {
+        _context->makeCurrent(_surface);
+        glewExperimental = GL_TRUE;
+        glewInit();
+
+        while (true)
+        {
+            UploadJob job;
+            {
+                QMutexLocker locker(&_mutex);
+                while (_queue.empty() && !_isStopping)
+                    _condition.wait(&_mutex);
+                if (_isStopping)
+                    break;
+                job = _queue.front();
+                _queue.pop_front();
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+            Geometry *geometry = job();
+            if (geometry == NULL)
+                continue;
+            geometry->createBuffers();
+            geometry->createLodBuffers();
+            geometry->createOctreeBuffers();
+
+            //the fence has to reach the GPU, or the viewer would poll it forever
+            Upload upload;
+            upload.geometry = geometry;
+            upload.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+
+            std::clog << __FUNCTION__ << ": " << geometry->getFilename().toStdString() << " loaded and uploaded in "
+                      << timer.elapsed() << " ms.\n";
+
+            {
+                QMutexLocker locker(&_mutex);
+                _ready.push_back(upload);
+            }
+            emit uploaded();
+        }
+
+        //uploads nobody took, their buffers and fences go while a context of the share group is current
+        {
+            QMutexLocker locker(&_mutex);
+            for (size_t i = 0; i < _ready.size(); i++)
+            {
+                glDeleteSync(_ready[i].fence);
+                delete _ready[i].geometry;
+            }
+            _ready.clear();
+        }
+
+        _context->doneCurrent();
+    }
+
+}
@@ -0,0 +1,140 @@
+#include "vertexFormat.h"
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+namespace Tessellation
+{
+
+    static GLushort toUnorm16(const float value)
+    {
+        return static_cast<GLushort>(floor(glm::clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f));
+    }
+
+    static GLshort toSnorm16(const float value)
+    {
+        return static_cast<GLshort>(floor(glm::clamp(value, -1.0f, 1.0f) * 32767.0f + 0.5f));
+    }
+
+    VertexQuantization VertexFormat::getQuantization(const BoundingBox &box, const std::vector<glm::vec3> &displacements)
+    {
+        VertexQuantization quantization;
+        if (box.isEmpty())
+            return quantization;
+
+        //flat boxes keep a unit scale so that dequantization never divides by zero
+        glm::vec3 size = box.max - box.min;
+        for (int i = 0; i < 3; i++)
+            if (size[i] <= 0.0f)
+                size[i] = 1.0f;
+
+        float deltaScale = 0.0f;
+        for (size_t i = 0; i < displacements.size(); i++)
+            for (int k = 0; k < 3; k++)
+                deltaScale = std::max(deltaScale, std::abs(displacements[i][k]));
+
+        quantization.offset = glm::vec4(box.min, 0.0f);
+        quantization.scale = glm::vec4(size, (deltaScale > 0.0f) ? deltaScale : 1.0f);
+        return quantization;
+    }
+
+    std::vector<CompactVertex> VertexFormat::pack(const std::vector<glm::vec3> &positions, const std::vector<glm::vec3> &normals,
+                                                  const std::vector<glm::vec2> &textureCoordinates, const std::vector<glm::vec3> &displacements,
+                                                  const VertexQuantization &quantization)
+    {
+        std::vector<CompactVertex> vertices(positions.size());
+        bool hasNormals = normals.size() == positions.size();
+        bool hasTextureCoordinates = textureCoordinates.size() == positions.size();
+        bool hasDisplacements = displacements.size() == positions.size();
+        glm::vec3 offset(quantization.offset), scale(quantization.scale);
+
+        #pragma omp parallel for
+        for (int i = 0; i < static_cast<int>(positions.size()); i++)
+        {
+            CompactVertex &vertex = vertices[i];
+            memset(&vertex, 0, sizeof(CompactVertex));
+
+            glm::vec3 position = (positions[i] - offset) / scale;
+            for (int k = 0; k < 3; k++)
+                vertex.position[k] = toUnorm16(position[k]);
+            if (hasTextureCoordinates)
+                for (int k = 0; k < 2; k++)
+                    vertex.uv[k] = toHalf(textureCoordinates[i][k]);
+            if (hasNormals)
+            {
+                glm::vec2 normal = encodeOctahedral(normals[i]);
+                for (int k = 0; k < 2; k++)
+                    vertex.normal[k] = toSnorm16(normal[k]);
+            }
+            if (hasDisplacements)
+                vertex.delta = toSnorm1010102(displacements[i] / quantization.scale.w);
+        }
+
+        return vertices;
+    }
+
+    //"A Survey of Efficient Representations for Independent Unit Vectors" (Cigolle et al.)
+    glm::vec2 VertexFormat::encodeOctahedral(const glm::vec3 &normal)
+    {
+        float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (length <= 0.0f)
+            return glm::vec2(0.0f);
+
+        glm::vec3 n = normal / length;
+        if (n.z >= 0.0f)
+            return glm::vec2(n.x, n.y);
+
+        //lower hemisphere folded over the diagonals
+        return glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                         (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+
+    GLushort VertexFormat::toHalf(const float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(float));
+
+        uint32_t sign = (bits >> 16) & 0x8000;
+        int biased = (bits >> 23) & 0xff;
+        int exponent = biased - 127 + 15;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if (biased == 0xff) //infinity and NaN
+            return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+        if (exponent >= 31) //too large
+            return sign | 0x7c00;
+        if (exponent <= 0) //subnormal, or zero below its range
+        {
+            if (exponent < -10)
+                return sign;
+
+            mantissa |= 0x800000;
+            uint shift = 14 - exponent;
+            uint32_t half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1)
+                half++;
+            return sign | half;
+        }
+
+        //rounding may carry into the exponent, which is still the nearest value
+        uint32_t half = sign | (exponent << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000)
+            half++;
+        return half;
+    }
+
+    GLuint VertexFormat::toSnorm1010102(const glm::vec3 &value)
+    {
+        GLuint packed = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            int component = static_cast<int>(floor(glm::clamp(value[k], -1.0f, 1.0f) * 511.0f + 0.5f));
+            packed |= (static_cast<GLuint>(component) & 0x3ff) << (10 * k);
+        }
+
+        return packed;
+    }
+
+}
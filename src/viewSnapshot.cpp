@@ -0,0 +1,67 @@
+#include <GL/glew.h>
+#include "viewSnapshot.h"
+
+#include <QGLViewer/camera.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cmath>
+
+namespace Tessellation
+{
+
+    ViewSnapshot::ViewSnapshot():
+        view(1.0f),
+        projection(1.0f),
+        viewProjection(1.0f),
+        position(0.0f),
+        viewDirection(0.0f, 0.0f, -1.0f),
+        isPerspective(true),
+        fieldOfView(0.0f),
+        orthoHalfHeight(0.0f),
+        screenSize(1.0f)
+    {
+        for (int p = 0; p < 6; p++)
+            for (int c = 0; c < 4; c++)
+                frustumPlanes[p][c] = 0.0;
+    }
+
+    ViewSnapshot::ViewSnapshot(qglviewer::Camera *camera)
+    {
+        GLfloat matrix[16];
+        camera->getModelViewMatrix(matrix);
+        view = glm::make_mat4(matrix);
+        camera->getProjectionMatrix(matrix);
+        projection = glm::make_mat4(matrix);
+        camera->getModelViewProjectionMatrix(matrix);
+        viewProjection = glm::make_mat4(matrix);
+
+        qglviewer::Vec cameraPosition = camera->position();
+        qglviewer::Vec direction = camera->viewDirection();
+        position = glm::vec3(cameraPosition.x, cameraPosition.y, cameraPosition.z);
+        viewDirection = glm::vec3(direction.x, direction.y, direction.z);
+
+        isPerspective = (camera->type() == qglviewer::Camera::PERSPECTIVE);
+        fieldOfView = camera->fieldOfView();
+        GLdouble halfWidth, halfHeight;
+        camera->getOrthoWidthHeight(halfWidth, halfHeight);
+        orthoHalfHeight = halfHeight;
+        screenSize = glm::vec2(camera->screenWidth(), camera->screenHeight());
+        camera->getFrustumPlanesCoefficients(frustumPlanes);
+    }
+
+    float ViewSnapshot::getUnitsPerPixel(const glm::vec3 &point) const
+    {
+        //same as Camera::pixelGLRatio
+        if (screenSize.y <= 0.0f)
+            return 0.0f;
+        if (isPerspective)
+            return 2.0f * getDepth(point) * tan(0.5f * fieldOfView) / screenSize.y;
+        return 2.0f * orthoHalfHeight / screenSize.y;
+    }
+
+    float ViewSnapshot::getDepth(const glm::vec3 &point) const
+    {
+        return fabs(glm::dot(point - position, viewDirection));
+    }
+
+}